@@ -1,15 +1,45 @@
 #include "database.h"
+#include "database_catalog.h"
+#include "database_index.h"
+#include "database_sort.h"
 #include "logger.h"
 #include <assert.h>
+#include <inttypes.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 struct database {
+  // Holds the tables list, and the rows of all tables while no tablespaces
+  // are added
   struct paging_pager *pager;
+  // Pagers of the added data files, tablespace number i is at index i - 1.
+  // The main file is tablespace 0.
+  size_t tablespaces_count;
+  struct paging_pager **tablespaces;
+  // The tables list of the main file, read once when the database is opened
+  struct database_catalog *catalog;
+  // Free pages left by the last vacuum, which could not give them back
+  uint64_t vacuum_free_pages_count;
 };
 
+// The only record of the root chain of a tablespace file, so that a file
+// added in a wrong order is detected
+struct database_file_tablespace {
+  uint64_t tablespace_number;
+};
+
+// The file is vacuumed by a commit when more than half of it is free and at
+// least this many pages were freed since the last vacuum
+#define DATABASE_VACUUM_FREE_PAGES_MIN 256
+
+// Bytes of the rows of one table that a join keeps in memory, in the hash
+// table of a hash join or in one run of a sort
+#define DATABASE_JOIN_MEMORY_SIZE (16 << 20)
+
 struct database_file_table_header {
   uint64_t table_name_offset;
+  uint64_t rows_chain_root_page_number;
   uint64_t attributes_count;
 };
 
@@ -18,48 +48,265 @@ struct database_file_table_attribute {
   uint64_t attribute_type;
 };
 
-struct database_file_row_header {
-  uint64_t table_name_offset;
+// Follows the attributes of a table. Tables written before tablespaces
+// have their name right after the attributes and live in the main file.
+struct database_file_table_tablespace {
+  uint64_t tablespace_number;
+};
+
+// Follows the tablespace number, tables written before indexes have their
+// name right after it
+struct database_file_table_indexes {
+  uint64_t indexes_count;
+};
+
+struct database_file_table_index {
+  uint64_t index_name_offset;
+  uint64_t attribute_position;
+  uint64_t method;
+  uint64_t constraint;
+  uint64_t chain_root_page_number;
+  uint64_t root_page_number;
+  uint64_t root_slot_number;
+};
+
+// Longer strings, counting the terminating null, are stored in blobs so that
+// rows stay small and a string is read only when it is needed
+#define DATABASE_STRING_INLINE_SIZE_MAX 256
+
+// Set in the offset of a string stored in a blob, the rest of the offset
+// then points to a struct database_file_string_blob
+#define DATABASE_STRING_BLOB_FLAG (UINT64_C(1) << 63)
+
+struct database_file_string_blob {
+  uint64_t first_page_number;
+  uint64_t size;
 };
 
-struct database *database_init(FILE *file) {
+static bool database_catalog_load(struct database *database);
+static bool database_table_indexes_rebuild(struct database *database,
+                                           struct database_table table);
+static const struct database_table *
+database_index_table_find(const struct database *database,
+                          const char *index_name, size_t *index_position);
+
+struct database *database_init(FILE *file, struct paging_options options) {
   struct database *database = malloc(sizeof(struct database));
   if (database == NULL) {
     return NULL;
   }
 
-  struct paging_pager *pager = paging_pager_init(file);
+  struct paging_pager *pager = paging_pager_init(file, options);
   if (pager == NULL) {
     return NULL;
   }
 
   database->pager = pager;
+  database->tablespaces_count = 0;
+  database->tablespaces = NULL;
+  database->vacuum_free_pages_count = 0;
+  database->catalog = database_catalog_create();
+  if (database->catalog == NULL || !database_catalog_load(database)) {
+    warn("Catalog load error");
+    database_destroy(database);
+    return NULL;
+  }
   return database;
 }
 
-struct database *database_create_and_init(FILE *file) {
+struct database *database_create_and_init(FILE *file,
+                                          struct paging_options options) {
   struct database *database = malloc(sizeof(struct database));
   if (database == NULL) {
     return NULL;
   }
 
-  struct paging_pager *pager = paging_pager_create_and_init(file);
+  struct paging_pager *pager = paging_pager_create_and_init(file, options);
   if (pager == NULL) {
     return NULL;
   }
 
   database->pager = pager;
+  database->tablespaces_count = 0;
+  database->tablespaces = NULL;
+  database->vacuum_free_pages_count = 0;
+  database->catalog = database_catalog_create();
+  if (database->catalog == NULL) {
+    database_destroy(database);
+    return NULL;
+  }
   return database;
 }
 
+static bool database_tablespace_check(struct paging_pager *pager,
+                                      uint64_t tablespace_number) {
+  void *data = NULL;
+  const struct paging_read_result read_result =
+      paging_read_first(pager, paging_root_chain(pager), &data);
+  if (!read_result.success ||
+      read_result.size != sizeof(struct database_file_tablespace)) {
+    warn("File is not a tablespace");
+    return false;
+  }
+
+  struct database_file_tablespace tablespace;
+  memcpy(&tablespace, data, sizeof(tablespace));
+  if (read_result.is_data_owned) {
+    free(data);
+  }
+
+  if (tablespace.tablespace_number != tablespace_number) {
+    warn("Tablespace %" PRIu64 " is added as tablespace %" PRIu64,
+         tablespace.tablespace_number, tablespace_number);
+    return false;
+  }
+  return true;
+}
+
+struct database_add_tablespace_result
+database_add_tablespace(struct database *database, FILE *file,
+                        struct paging_options options) {
+  if (database == NULL || file == NULL) {
+    return (struct database_add_tablespace_result){.success = false};
+  }
+
+  struct paging_pager **tablespaces =
+      realloc(database->tablespaces, (database->tablespaces_count + 1) *
+                                         sizeof(struct paging_pager *));
+  if (tablespaces == NULL) {
+    warn("Tablespaces allocation error");
+    return (struct database_add_tablespace_result){.success = false};
+  }
+  database->tablespaces = tablespaces;
+
+  fseek(file, 0, SEEK_END);
+  const bool is_empty = ftell(file) == 0;
+  struct paging_pager *pager = is_empty
+                                   ? paging_pager_create_and_init(file, options)
+                                   : paging_pager_init(file, options);
+  if (pager == NULL) {
+    warn("Tablespace pager init error");
+    return (struct database_add_tablespace_result){.success = false};
+  }
+
+  const uint64_t tablespace_number = database->tablespaces_count + 1;
+  const struct database_file_tablespace tablespace = {
+      .tablespace_number = tablespace_number};
+  const bool success =
+      is_empty ? paging_write(pager, paging_root_chain(pager), &tablespace,
+                              sizeof(tablespace))
+                         .success &&
+                     paging_commit(pager).success
+               : database_tablespace_check(pager, tablespace_number);
+  if (!success) {
+    paging_pager_destroy(pager);
+    return (struct database_add_tablespace_result){.success = false};
+  }
+
+  database->tablespaces[database->tablespaces_count++] = pager;
+
+  // Tables of the tablespace get its pager. When they can not, the
+  // tablespace is not added and no table keeps its pager.
+  if (!database_catalog_load(database)) {
+    warn("Catalog load error");
+    database->tablespaces_count--;
+    if (!database_catalog_load(database)) {
+      database_catalog_clear(database->catalog);
+    }
+    paging_pager_destroy(pager);
+    return (struct database_add_tablespace_result){.success = false};
+  }
+  return (struct database_add_tablespace_result){
+      .success = true, .tablespace_number = tablespace_number};
+}
+
 void database_destroy(struct database *database) {
   if (database == NULL) {
     return;
   }
+  for (size_t i = 0; i < database->tablespaces_count; i++) {
+    paging_pager_destroy(database->tablespaces[i]);
+  }
+  free(database->tablespaces);
+  database_catalog_destroy(database->catalog);
   paging_pager_destroy(database->pager);
   free(database);
 }
 
+static struct paging_pager *
+database_tablespace_pager(const struct database *database,
+                          uint64_t tablespace_number) {
+  if (tablespace_number == 0) {
+    return database->pager;
+  }
+  if (tablespace_number > database->tablespaces_count) {
+    return NULL;
+  }
+  return database->tablespaces[tablespace_number - 1];
+}
+
+static uint64_t database_tablespace_number(const struct database *database,
+                                           const struct paging_pager *pager) {
+  for (size_t i = 0; i < database->tablespaces_count; i++) {
+    if (database->tablespaces[i] == pager) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+// New tables go to the added tablespace with the fewest pages in use
+static uint64_t database_tablespace_choose(const struct database *database) {
+  uint64_t tablespace_number = 0;
+  uint64_t used_pages_count_min = UINT64_MAX;
+  for (size_t i = 0; i < database->tablespaces_count; i++) {
+    const struct paging_usage usage = paging_usage(database->tablespaces[i]);
+    if (usage.pages_count - usage.free_pages_count < used_pages_count_min) {
+      used_pages_count_min = usage.pages_count - usage.free_pages_count;
+      tablespace_number = i + 1;
+    }
+  }
+  return tablespace_number;
+}
+
+struct database_commit_result database_commit(struct database *database) {
+  if (database == NULL) {
+    return (struct database_commit_result){.success = false};
+  }
+
+  // Rows are committed before the tables list, so a committed table always
+  // has its rows chain
+  struct paging_usage usage = paging_usage(database->pager);
+  for (size_t i = 0; i < database->tablespaces_count; i++) {
+    if (!paging_commit(database->tablespaces[i]).success) {
+      warn("Tablespace %zu commit error", i + 1);
+      return (struct database_commit_result){.success = false};
+    }
+
+    const struct paging_usage tablespace_usage =
+        paging_usage(database->tablespaces[i]);
+    usage.pages_count += tablespace_usage.pages_count;
+    usage.free_pages_count += tablespace_usage.free_pages_count;
+  }
+
+  const struct paging_commit_result result = paging_commit(database->pager);
+  if (!result.success) {
+    warn("Pager commit error");
+    return (struct database_commit_result){.success = false};
+  }
+
+  if (usage.free_pages_count * 2 > usage.pages_count &&
+      usage.free_pages_count >=
+          database->vacuum_free_pages_count + DATABASE_VACUUM_FREE_PAGES_MIN) {
+    if (!database_vacuum(database).success) {
+      warn("Vacuum error");
+      return (struct database_commit_result){.success = false};
+    }
+  }
+
+  return (struct database_commit_result){.success = true};
+}
+
 static uint64_t database_attribute_type_to_uint64[] = {
     [DATABASE_ATTRIBUTE_INTEGER] = 0,
     [DATABASE_ATTRIBUTE_FLOATING_POINT] = 1,
@@ -74,47 +321,156 @@ static enum database_attribute_type database_attribute_type_from_uint64[] = {
     [3] = DATABASE_ATTRIBUTE_STRING,
 };
 
-struct database_create_table_result
-database_create_table(struct database *database,
-                      struct database_create_table_request request) {
-  if (database == NULL) {
-    return (struct database_create_table_result){.success = false};
+static enum database_index_method database_index_method_from_uint64[] = {
+    [0] = DATABASE_INDEX_METHOD_BTREE,
+    [1] = DATABASE_INDEX_METHOD_HASH,
+};
+
+static uint64_t database_index_method_to_uint64[] = {
+    [DATABASE_INDEX_METHOD_BTREE] = 0,
+    [DATABASE_INDEX_METHOD_HASH] = 1,
+};
+
+static enum database_index_constraint
+    database_index_constraint_from_uint64[] = {
+        [0] = DATABASE_INDEX_CONSTRAINT_NONE,
+        [1] = DATABASE_INDEX_CONSTRAINT_UNIQUE,
+        [2] = DATABASE_INDEX_CONSTRAINT_PRIMARY_KEY,
+};
+
+static uint64_t database_index_constraint_to_uint64[] = {
+    [DATABASE_INDEX_CONSTRAINT_NONE] = 0,
+    [DATABASE_INDEX_CONSTRAINT_UNIQUE] = 1,
+    [DATABASE_INDEX_CONSTRAINT_PRIMARY_KEY] = 2,
+};
+
+// Takes the data of the table record
+static struct database_table
+database_table_from_file_data(const struct database *database,
+                              struct paging_info info, void *data) {
+  const struct database_file_table_header *header = data;
+  char *table_name = (char *)data + header->table_name_offset;
+
+  const struct database_file_table_attribute *file_attributes =
+      (struct database_file_table_attribute
+           *)((char *)data + sizeof(struct database_file_table_header));
+
+  struct database_file_table_tablespace tablespace = {.tablespace_number = 0};
+  const size_t tablespace_offset =
+      sizeof(struct database_file_table_header) +
+      header->attributes_count * sizeof(struct database_file_table_attribute);
+  if (header->table_name_offset >= tablespace_offset + sizeof(tablespace)) {
+    memcpy(&tablespace, (char *)data + tablespace_offset, sizeof(tablespace));
+  }
+
+  struct database_file_table_indexes indexes = {.indexes_count = 0};
+  const size_t indexes_offset = tablespace_offset + sizeof(tablespace);
+  if (header->table_name_offset >= indexes_offset + sizeof(indexes)) {
+    memcpy(&indexes, (char *)data + indexes_offset, sizeof(indexes));
+  }
+
+  struct database_attributes attributes =
+      database_attributes_create(header->attributes_count);
+  for (size_t i = 0; i < header->attributes_count; ++i) {
+    const struct database_attribute attribute = {
+        .name = (char *)data + file_attributes[i].attribute_name_offset,
+        .type = database_attribute_type_from_uint64[file_attributes[i]
+                                                        .attribute_type]};
+    database_attributes_set(attributes, i, attribute);
   }
 
+  const struct paging_chain rows_chain = {
+      .root_page_number = header->rows_chain_root_page_number};
+
+  struct paging_pager *pager =
+      database_tablespace_pager(database, tablespace.tablespace_number);
+
+  return (struct database_table){.data = data,
+                                 .is_data_owned = true,
+                                 .name = table_name,
+                                 .page_info = info,
+                                 .pager = pager,
+                                 .rows_chain = rows_chain,
+                                 .attributes = attributes,
+                                 .indexes_count = indexes.indexes_count,
+                                 .indexes_offset =
+                                     indexes_offset + sizeof(indexes)};
+}
+
+static struct database_index
+database_table_index_get(struct database_table table, size_t position) {
+  struct database_file_table_index file_index;
+  memcpy(&file_index,
+         (char *)table.data + table.indexes_offset +
+             position * sizeof(struct database_file_table_index),
+         sizeof(struct database_file_table_index));
+
+  const struct paging_chain chain = {.root_page_number =
+                                         file_index.chain_root_page_number};
+  const struct paging_record_id root_record_id = {
+      .page_number = file_index.root_page_number,
+      .slot_number = (uint16_t)file_index.root_slot_number};
+  return (struct database_index){
+      .name = (char *)table.data + file_index.index_name_offset,
+      .attribute_position = file_index.attribute_position,
+      .type = database_attributes_get(table.attributes,
+                                      file_index.attribute_position)
+                  .type,
+      .method = database_index_method_from_uint64[file_index.method],
+      .constraint =
+          database_index_constraint_from_uint64[file_index.constraint],
+      .chain = chain,
+      .root_record_id = root_record_id};
+}
+
+// Serializes a table record: the header, the attributes, the tablespace
+// number and the indexes, then the strings they refer to by offsets from the
+// start of the record
+static void *database_table_data_make(
+    const char *name, struct database_attributes attributes,
+    struct paging_chain rows_chain, uint64_t tablespace_number,
+    const struct database_index *indexes, size_t indexes_count, size_t *size) {
   const size_t header_size = sizeof(struct database_file_table_header);
   const size_t attribute_size = sizeof(struct database_file_table_attribute);
+  const size_t tablespace_size = sizeof(struct database_file_table_tablespace);
+  const size_t indexes_size = sizeof(struct database_file_table_indexes);
+  const size_t index_size = sizeof(struct database_file_table_index);
   const size_t data_size_without_strings =
-      header_size + request.attributes.count * attribute_size;
+      header_size + attributes.count * attribute_size + tablespace_size +
+      indexes_size + indexes_count * index_size;
 
-  const size_t table_name_data_size = strlen(request.name) + 1;
+  const size_t table_name_data_size = strlen(name) + 1;
   size_t strings_data_size = table_name_data_size;
-  for (size_t i = 0; i < request.attributes.count; ++i) {
+  for (size_t i = 0; i < attributes.count; ++i) {
     strings_data_size +=
-        strlen(database_attributes_get(request.attributes, i).name) + 1;
+        strlen(database_attributes_get(attributes, i).name) + 1;
+  }
+  for (size_t i = 0; i < indexes_count; ++i) {
+    strings_data_size += strlen(indexes[i].name) + 1;
   }
 
   const size_t data_size = data_size_without_strings + strings_data_size;
   void *data = malloc(data_size);
   if (data == NULL) {
     warn("Data allocation error");
-    return (struct database_create_table_result){.success = false};
+    return NULL;
   }
 
   size_t data_offset = 0;
   size_t data_strings_offset = data_size_without_strings;
 
   const struct database_file_table_header header = {
-      .attributes_count = request.attributes.count,
+      .attributes_count = attributes.count,
+      .rows_chain_root_page_number = rows_chain.root_page_number,
       .table_name_offset = data_strings_offset};
   memcpy((char *)data + data_offset, &header, header_size);
-  memcpy((char *)data + data_strings_offset, request.name,
-         table_name_data_size);
+  memcpy((char *)data + data_strings_offset, name, table_name_data_size);
   data_offset += header_size;
   data_strings_offset += table_name_data_size;
 
-  for (size_t i = 0; i < request.attributes.count; ++i) {
+  for (size_t i = 0; i < attributes.count; ++i) {
     const struct database_attribute attribute =
-        database_create_table_request_get_attribute(request, i);
+        database_attributes_get(attributes, i);
     const struct database_file_table_attribute file_attribute = {
         .attribute_name_offset = data_strings_offset,
         .attribute_type = database_attribute_type_to_uint64[attribute.type]};
@@ -126,45 +482,214 @@ database_create_table(struct database *database,
     data_strings_offset += attribute_name_size;
   }
 
+  const struct database_file_table_tablespace tablespace = {
+      .tablespace_number = tablespace_number};
+  memcpy((char *)data + data_offset, &tablespace, tablespace_size);
+  data_offset += tablespace_size;
+
+  const struct database_file_table_indexes file_indexes = {
+      .indexes_count = indexes_count};
+  memcpy((char *)data + data_offset, &file_indexes, indexes_size);
+  data_offset += indexes_size;
+
+  for (size_t i = 0; i < indexes_count; ++i) {
+    const struct database_file_table_index file_index = {
+        .index_name_offset = data_strings_offset,
+        .attribute_position = indexes[i].attribute_position,
+        .method = database_index_method_to_uint64[indexes[i].method],
+        .constraint =
+            database_index_constraint_to_uint64[indexes[i].constraint],
+        .chain_root_page_number = indexes[i].chain.root_page_number,
+        .root_page_number = indexes[i].root_record_id.page_number,
+        .root_slot_number = indexes[i].root_record_id.slot_number};
+    const size_t index_name_size = strlen(indexes[i].name) + 1;
+    memcpy((char *)data + data_offset, &file_index, index_size);
+    memcpy((char *)data + data_strings_offset, indexes[i].name,
+           index_name_size);
+    data_offset += index_size;
+    data_strings_offset += index_name_size;
+  }
+
   assert(data_offset == data_size_without_strings);
   assert(data_strings_offset == data_size);
 
-  struct paging_write_result write_result =
-      paging_write(database->pager, PAGING_TYPE_1, data, data_size);
-  if (!write_result.success) {
-    warn("Write data to pager error");
-    free(data);
-    return (struct database_create_table_result){.success = false};
+  *size = data_size;
+  return data;
+}
+
+static void database_constraint_indexes_destroy(struct paging_pager *pager,
+                                                struct database_index *indexes,
+                                                size_t indexes_count,
+                                                bool is_removed) {
+  for (size_t i = 0; i < indexes_count; i++) {
+    if (is_removed) {
+      paging_chain_remove(pager, indexes[i].chain);
+    }
+    free((char *)indexes[i].name);
   }
+  free(indexes);
+}
 
-  free(data);
+// Key constraints have no names of their own, so their indexes are named
+// after the table and the attribute
+static char *database_constraint_index_name_make(
+    const char *table_name, const char *attribute_name,
+    enum database_index_constraint constraint) {
+  const char *primary_key_suffix = "_pkey";
+  const char *unique_suffix = "_key";
+  char *name = malloc(strlen(table_name) + strlen(attribute_name) +
+                      strlen(primary_key_suffix) + 2);
+  if (name == NULL) {
+    warn("Index name allocation error");
+    return NULL;
+  }
 
-  return (struct database_create_table_result){.success = true};
+  if (constraint == DATABASE_INDEX_CONSTRAINT_PRIMARY_KEY) {
+    sprintf(name, "%s%s", table_name, primary_key_suffix);
+  } else {
+    sprintf(name, "%s_%s%s", table_name, attribute_name, unique_suffix);
+  }
+  return name;
 }
 
-static struct database_table
-database_table_from_file_data(struct paging_info page_info, void *data) {
-  const struct database_file_table_header *header = data;
-  char *table_name = (char *)data + header->table_name_offset;
+// Creates the empty indexes of the key constraints of the requested table
+static bool database_constraint_indexes_create(
+    const struct database *database, struct paging_pager *pager,
+    struct database_create_table_request request,
+    struct database_index **indexes, size_t *indexes_count) {
+  *indexes = NULL;
+  *indexes_count = 0;
+
+  size_t constraints_count = 0;
+  size_t primary_keys_count = 0;
+  for (size_t i = 0; i < request.attributes.count; i++) {
+    const enum database_index_constraint constraint =
+        database_create_table_request_get_constraint(request, i);
+    constraints_count += constraint != DATABASE_INDEX_CONSTRAINT_NONE;
+    primary_keys_count += constraint == DATABASE_INDEX_CONSTRAINT_PRIMARY_KEY;
+  }
+  if (primary_keys_count > 1) {
+    warn("Table %s has more than one primary key", request.name);
+    return false;
+  }
+  if (constraints_count == 0) {
+    return true;
+  }
 
-  const struct database_file_table_attribute *file_attributes =
-      (struct database_file_table_attribute
-           *)((char *)data + sizeof(struct database_file_table_header));
+  *indexes = malloc(constraints_count * sizeof(struct database_index));
+  if (*indexes == NULL) {
+    warn("Indexes allocation error");
+    return false;
+  }
 
-  struct database_attributes attributes =
-      database_attributes_create(header->attributes_count);
-  for (size_t i = 0; i < header->attributes_count; ++i) {
-    const struct database_attribute attribute = {
-        .name = (char *)data + file_attributes[i].attribute_name_offset,
-        .type = database_attribute_type_from_uint64[file_attributes[i]
-                                                        .attribute_type]};
-    database_attributes_set(attributes, i, attribute);
+  for (size_t i = 0; i < request.attributes.count; i++) {
+    const enum database_index_constraint constraint =
+        database_create_table_request_get_constraint(request, i);
+    if (constraint == DATABASE_INDEX_CONSTRAINT_NONE) {
+      continue;
+    }
+
+    const struct database_attribute attribute =
+        database_create_table_request_get_attribute(request, i);
+    char *name = database_constraint_index_name_make(
+        request.name, attribute.name, constraint);
+    size_t index_position;
+    if (name != NULL &&
+        database_index_table_find(database, name, &index_position) != NULL) {
+      warn("Index %s already exists", name);
+      free(name);
+      name = NULL;
+    }
+
+    const struct database_index_create_result create_result =
+        name == NULL
+            ? (struct database_index_create_result){.success = false}
+            : database_index_create(pager, DATABASE_INDEX_METHOD_BTREE);
+    if (!create_result.success) {
+      free(name);
+      database_constraint_indexes_destroy(pager, *indexes, *indexes_count,
+                                          true);
+      *indexes = NULL;
+      *indexes_count = 0;
+      return false;
+    }
+
+    (*indexes)[(*indexes_count)++] = (struct database_index){
+        .name = name,
+        .attribute_position = i,
+        .type = attribute.type,
+        .method = DATABASE_INDEX_METHOD_BTREE,
+        .constraint = constraint,
+        .chain = create_result.chain,
+        .root_record_id = create_result.root_record_id};
   }
 
-  return (struct database_table){.data = data,
-                                 .name = table_name,
-                                 .page_info = page_info,
-                                 .attributes = attributes};
+  return true;
+}
+
+struct database_create_table_result
+database_create_table(struct database *database,
+                      struct database_create_table_request request) {
+  if (database == NULL) {
+    return (struct database_create_table_result){.success = false};
+  }
+
+  if (database_catalog_find(database->catalog, request.name) != NULL) {
+    warn("Table %s already exists", request.name);
+    return (struct database_create_table_result){.success = false};
+  }
+
+  const uint64_t tablespace_number = database_tablespace_choose(database);
+  struct paging_pager *pager =
+      database_tablespace_pager(database, tablespace_number);
+  const struct paging_chain_create_result chain_result =
+      paging_chain_create(pager);
+  if (!chain_result.success) {
+    warn("Rows chain creation error");
+    return (struct database_create_table_result){.success = false};
+  }
+
+  struct database_index *indexes;
+  size_t indexes_count;
+  if (!database_constraint_indexes_create(database, pager, request, &indexes,
+                                          &indexes_count)) {
+    paging_chain_remove(pager, chain_result.chain);
+    return (struct database_create_table_result){.success = false};
+  }
+
+  size_t data_size;
+  void *data = database_table_data_make(
+      request.name, request.attributes, chain_result.chain, tablespace_number,
+      indexes, indexes_count, &data_size);
+  if (data == NULL) {
+    database_constraint_indexes_destroy(pager, indexes, indexes_count, true);
+    paging_chain_remove(pager, chain_result.chain);
+    return (struct database_create_table_result){.success = false};
+  }
+
+  struct paging_write_result write_result = paging_write(
+      database->pager, paging_root_chain(database->pager), data, data_size);
+  if (!write_result.success) {
+    warn("Write data to pager error");
+    database_constraint_indexes_destroy(pager, indexes, indexes_count, true);
+    paging_chain_remove(pager, chain_result.chain);
+    free(data);
+    return (struct database_create_table_result){.success = false};
+  }
+
+  const struct database_table table =
+      database_table_from_file_data(database, write_result.info, data);
+  if (!database_catalog_insert(database->catalog, table)) {
+    warn("Catalog insert error");
+    paging_remove(database->pager, write_result.info);
+    database_constraint_indexes_destroy(pager, indexes, indexes_count, true);
+    paging_chain_remove(pager, chain_result.chain);
+    database_table_destroy(table);
+    return (struct database_create_table_result){.success = false};
+  }
+  database_constraint_indexes_destroy(pager, indexes, indexes_count, false);
+
+  return (struct database_create_table_result){.success = true};
 }
 
 struct database_get_table_result
@@ -174,131 +699,467 @@ database_get_table_with_name(const struct database *database,
     return (struct database_get_table_result){.success = false};
   }
 
-  void *data = NULL;
-  struct paging_read_result read_result =
-      paging_read_first(database->pager, PAGING_TYPE_1, &data);
+  const struct database_table *table =
+      database_catalog_find(database->catalog, name);
+  if (table == NULL) {
+    return (struct database_get_table_result){.success = false};
+  }
+  if (table->pager == NULL) {
+    warn("Tablespace of table %s is not added", name);
+    return (struct database_get_table_result){.success = false};
+  }
+
+  struct database_table borrowed_table = *table;
+  borrowed_table.is_data_owned = false;
+  return (struct database_get_table_result){.success = true,
+                                            .table = borrowed_table};
+}
+
+// Reads the tables list of the main file into the catalog. Tables of
+// tablespaces that are not added get no pager.
+static bool database_catalog_load(struct database *database) {
+  database_catalog_clear(database->catalog);
 
+  void *data = NULL;
+  struct paging_read_result read_result = paging_read_first(
+      database->pager, paging_root_chain(database->pager), &data);
   while (read_result.success) {
+    if (!read_result.is_data_owned) {
+      void *data_copy = malloc(read_result.size);
+      if (data_copy == NULL) {
+        warn("Table data allocation error");
+        return false;
+      }
+      memcpy(data_copy, data, read_result.size);
+      data = data_copy;
+    }
+
     const struct database_table table =
-        database_table_from_file_data(read_result.info, data);
-    if (strcmp(table.name, name) == 0) {
-      return (struct database_get_table_result){.success = true,
-                                                .table = table};
+        database_table_from_file_data(database, read_result.info, data);
+    // Older files may list a name twice, only the first table was found
+    const bool success =
+        database_catalog_find(database->catalog, table.name) == NULL &&
+        database_catalog_insert(database->catalog, table);
+    if (!success) {
+      database_table_destroy(table);
     }
 
-    free(data);
     read_result = paging_read_next(database->pager, read_result.info, &data);
   }
 
-  return (struct database_get_table_result){.success = false};
+  return true;
 }
 
-struct database_drop_table_result
-database_drop_table(struct database *database, struct database_table table) {
-  struct database_select_row_result select_result =
-      database_select_row_first(database, table, DATABASE_WHERE_ALWAYS);
-  while (select_result.success) {
-    const struct database_remove_row_result remove_row_result =
-        database_remove_row(database, select_result.row);
-    if (!remove_row_result.success) {
-      warn("Row removing error");
-      database_row_destroy(select_result.row);
-      return (struct database_drop_table_result){.success = false};
+static bool database_table_has_strings(struct database_table table) {
+  for (size_t i = 0; i < table.attributes.count; i++) {
+    if (database_attributes_get(table.attributes, i).type ==
+        DATABASE_ATTRIBUTE_STRING) {
+      return true;
     }
-
-    select_result =
-        database_select_row_first(database, table, DATABASE_WHERE_ALWAYS);
-  }
-
-  const struct paging_remove_result remove_table_result =
-      paging_remove(database->pager, table.page_info);
-  if (!remove_table_result.success) {
-    warn("Table removing error");
-    return (struct database_drop_table_result){.success = false};
   }
 
-  database_table_destroy(table);
-  return (struct database_drop_table_result){.success = true};
+  return false;
 }
 
-struct database_insert_row_result
-database_insert_row(struct database *database, struct database_table table,
-                    struct database_insert_row_request request) {
-  const size_t header_data_size = sizeof(struct database_file_row_header);
-  const size_t integer_data_size = sizeof(int64_t);
-  const size_t floating_point_data_size = sizeof(double);
-  const size_t boolean_data_size = sizeof(uint64_t);
-  const size_t table_name_data_size = strlen(table.name) + 1;
-
-  size_t data_size_without_strings = header_data_size;
-  size_t strings_data_size = table_name_data_size;
-  for (size_t i = 0; i < table.attributes.count; i++) {
+static size_t database_row_attribute_offset(struct database_table table,
+                                            size_t position) {
+  size_t data_offset = 0;
+  for (size_t i = 0; i < position; i++) {
     switch (database_attributes_get(table.attributes, i).type) {
     case DATABASE_ATTRIBUTE_INTEGER:
-      data_size_without_strings += integer_data_size;
+      data_offset += sizeof(int64_t);
       break;
     case DATABASE_ATTRIBUTE_FLOATING_POINT:
-      data_size_without_strings += floating_point_data_size;
+      data_offset += sizeof(double);
       break;
     case DATABASE_ATTRIBUTE_BOOLEAN:
-      data_size_without_strings += boolean_data_size;
-      break;
     case DATABASE_ATTRIBUTE_STRING:
-      data_size_without_strings += sizeof(uint64_t);
-      strings_data_size +=
-          strlen(database_insert_row_request_get_value(request, i).string) + 1;
+      data_offset += sizeof(uint64_t);
       break;
     default:
       break;
     }
   }
 
-  const size_t data_size = data_size_without_strings + strings_data_size;
-  void *data = malloc(data_size);
-  if (data == NULL) {
-    warn("Alloc data error");
-    return (struct database_insert_row_result){.success = false};
+  return data_offset;
+}
+
+// Returns false when the string attribute is stored in the row itself
+static bool database_row_string_blob(struct database_table table,
+                                     const void *data, size_t position,
+                                     struct paging_blob *blob) {
+  uint64_t string_offset;
+  memcpy(&string_offset,
+         (const char *)data + database_row_attribute_offset(table, position),
+         sizeof(uint64_t));
+  if ((string_offset & DATABASE_STRING_BLOB_FLAG) == 0) {
+    return false;
   }
 
-  size_t data_offset = 0;
-  size_t data_strings_offset = data_size_without_strings;
+  struct database_file_string_blob file_blob;
+  memcpy(&file_blob,
+         (const char *)data + (string_offset & ~DATABASE_STRING_BLOB_FLAG),
+         sizeof(struct database_file_string_blob));
+  *blob = (struct paging_blob){.first_page_number = file_blob.first_page_number,
+                               .size = file_blob.size};
+  return true;
+}
 
-  const struct database_file_row_header header = {.table_name_offset =
-                                                      data_strings_offset};
-  memcpy((char *)data + data_offset, &header, header_data_size);
-  memcpy((char *)data + data_strings_offset, table.name, table_name_data_size);
-  data_offset += header_data_size;
-  data_strings_offset += table_name_data_size;
+// Frees the blobs of the first attributes_count attributes of the row
+static bool database_row_blobs_remove_first(struct database_table table,
+                                            const void *data,
+                                            size_t attributes_count) {
+  bool success = true;
+  for (size_t i = 0; i < attributes_count; i++) {
+    struct paging_blob blob;
+    if (database_attributes_get(table.attributes, i).type ==
+            DATABASE_ATTRIBUTE_STRING &&
+        database_row_string_blob(table, data, i, &blob) &&
+        !paging_blob_remove(table.pager, blob).success) {
+      warn("String blob removing error");
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+static bool database_row_blobs_remove(struct database_table table,
+                                      const void *data) {
+  return database_row_blobs_remove_first(table, data, table.attributes.count);
+}
+
+// Collects the blobs of the stored row, so that they can be freed after the
+// row itself is changed
+static bool database_row_blobs_fetch(struct database_table table,
+                                     struct paging_info info,
+                                     struct paging_blob **blobs,
+                                     size_t *count) {
+  *blobs = NULL;
+  *count = 0;
+  if (!database_table_has_strings(table)) {
+    return true;
+  }
+
+  void *data = NULL;
+  const struct paging_read_result read_result =
+      paging_fetch(table.pager, info, &data);
+  if (!read_result.success) {
+    return false;
+  }
+
+  *blobs = malloc(table.attributes.count * sizeof(struct paging_blob));
+  if (*blobs == NULL) {
+    warn("Alloc blobs error");
+    if (read_result.is_data_owned) {
+      free(data);
+    }
+    return false;
+  }
+
+  for (size_t i = 0; i < table.attributes.count; i++) {
+    if (database_attributes_get(table.attributes, i).type ==
+            DATABASE_ATTRIBUTE_STRING &&
+        database_row_string_blob(table, data, i, &(*blobs)[*count])) {
+      *count += 1;
+    }
+  }
+
+  if (read_result.is_data_owned) {
+    free(data);
+  }
+  return true;
+}
+
+static bool database_blobs_remove(struct database_table table,
+                                  struct paging_blob *blobs, size_t count) {
+  bool success = true;
+  for (size_t i = 0; i < count; i++) {
+    if (!paging_blob_remove(table.pager, blobs[i]).success) {
+      warn("String blob removing error");
+      success = false;
+    }
+  }
+
+  free(blobs);
+  return success;
+}
+
+// Moves the blobs of the row to free pages nearer to the start of the file
+// and updates the row in place when any of them moved
+static bool database_row_blobs_relocate(struct database_table table,
+                                        struct paging_read_result read_result,
+                                        const void *data) {
+  void *new_data = NULL;
+  for (size_t i = 0; i < table.attributes.count; i++) {
+    struct paging_blob blob;
+    if (database_attributes_get(table.attributes, i).type !=
+            DATABASE_ATTRIBUTE_STRING ||
+        !database_row_string_blob(table, data, i, &blob)) {
+      continue;
+    }
+
+    const struct paging_blob_relocate_result relocate_result =
+        paging_blob_relocate(table.pager, blob);
+    if (!relocate_result.success) {
+      free(new_data);
+      return false;
+    }
+    if (relocate_result.blob.first_page_number == blob.first_page_number) {
+      continue;
+    }
+
+    if (new_data == NULL) {
+      new_data = malloc(read_result.size);
+      if (new_data == NULL) {
+        warn("Row data allocation error");
+        return false;
+      }
+      memcpy(new_data, data, read_result.size);
+    }
+
+    uint64_t string_offset;
+    memcpy(&string_offset,
+           (char *)new_data + database_row_attribute_offset(table, i),
+           sizeof(uint64_t));
+    const struct database_file_string_blob file_blob = {
+        .first_page_number = relocate_result.blob.first_page_number,
+        .size = relocate_result.blob.size};
+    memcpy((char *)new_data + (string_offset & ~DATABASE_STRING_BLOB_FLAG),
+           &file_blob, sizeof(struct database_file_string_blob));
+  }
+
+  if (new_data == NULL) {
+    return true;
+  }
+
+  const struct paging_update_result update_result = paging_update(
+      table.pager, read_result.info, new_data, read_result.size);
+  free(new_data);
+  return update_result.success;
+}
+
+static bool database_table_vacuum(struct database *database,
+                                  struct database_table table) {
+  if (database_table_has_strings(table)) {
+    void *data = NULL;
+    struct paging_read_result read_result =
+        paging_read_first(table.pager, table.rows_chain, &data);
+    while (read_result.success) {
+      const bool success =
+          database_row_blobs_relocate(table, read_result, data);
+      if (read_result.is_data_owned) {
+        free(data);
+      }
+      if (!success) {
+        warn("Row blobs relocation error");
+        return false;
+      }
+
+      read_result = paging_read_next(table.pager, read_result.info, &data);
+    }
+  }
+
+  // Rows moved, so their indexes are built again
+  return paging_chain_vacuum(table.pager, table.rows_chain).success &&
+         database_table_indexes_rebuild(database, table);
+}
+
+struct database_vacuum_result database_vacuum(struct database *database) {
+  if (database == NULL) {
+    return (struct database_vacuum_result){.success = false};
+  }
+
+  for (size_t i = 0; i < database_catalog_count(database->catalog); i++) {
+    const struct database_table *table =
+        database_catalog_get(database->catalog, i);
+    if (table->pager != NULL && !database_table_vacuum(database, *table)) {
+      warn("Table vacuum error");
+      return (struct database_vacuum_result){.success = false};
+    }
+  }
+
+  const struct paging_vacuum_result vacuum_result = paging_chain_vacuum(
+      database->pager, paging_root_chain(database->pager));
+  // Records of the tables list moved, so they are read again
+  if (!database_catalog_load(database) || !vacuum_result.success ||
+      !paging_truncate(database->pager).success) {
+    return (struct database_vacuum_result){.success = false};
+  }
+
+  database->vacuum_free_pages_count =
+      paging_usage(database->pager).free_pages_count;
+  for (size_t i = 0; i < database->tablespaces_count; i++) {
+    if (!paging_truncate(database->tablespaces[i]).success) {
+      return (struct database_vacuum_result){.success = false};
+    }
+    database->vacuum_free_pages_count +=
+        paging_usage(database->tablespaces[i]).free_pages_count;
+  }
+  return (struct database_vacuum_result){.success = true};
+}
+
+static bool database_table_rows_remove(struct database_table table) {
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    if (!paging_chain_remove(table.pager,
+                             database_table_index_get(table, i).chain)
+             .success) {
+      warn("Index removing error");
+      return false;
+    }
+  }
+
+  if (database_table_has_strings(table)) {
+    void *data = NULL;
+    struct paging_read_result read_result =
+        paging_read_first(table.pager, table.rows_chain, &data);
+    while (read_result.success) {
+      const bool success = database_row_blobs_remove(table, data);
+      if (read_result.is_data_owned) {
+        free(data);
+      }
+      if (!success) {
+        return false;
+      }
+
+      read_result = paging_read_next(table.pager, read_result.info, &data);
+    }
+  }
+
+  const struct paging_chain_remove_result remove_rows_result =
+      paging_chain_remove(table.pager, table.rows_chain);
+  if (!remove_rows_result.success) {
+    warn("Rows removing error");
+    return false;
+  }
+  return true;
+}
+
+struct database_drop_table_result
+database_drop_table(struct database *database, struct database_table table) {
+  if (database == NULL) {
+    return (struct database_drop_table_result){.success = false};
+  }
+
+  // The table leaves the tables list before its chains are freed, so a
+  // failure after that only leaves unreachable pages behind. A table in a
+  // tablespace commits the list first, as its pages are in another file.
+  const bool is_in_tablespace = table.pager != database->pager;
+  if (!paging_remove(database->pager, table.page_info).success ||
+      (is_in_tablespace && !paging_commit(database->pager).success)) {
+    warn("Table removing error");
+    return (struct database_drop_table_result){.success = false};
+  }
+
+  // A tablespace that held only this table shrinks to its first pages. The
+  // table is borrowed from the catalog, so it leaves the catalog last.
+  const bool success =
+      database_table_rows_remove(table) &&
+      (!is_in_tablespace || paging_truncate(table.pager).success);
+  database_catalog_remove(database->catalog, table.name);
+  if (!success) {
+    warn("Table removing error");
+    return (struct database_drop_table_result){.success = false};
+  }
+
+  return (struct database_drop_table_result){.success = true};
+}
+
+// Serializes the values of a row: fixed size attributes first, strings are
+// stored after them and referenced by offsets from the start of the row.
+// Long strings are written to blobs and only their blobs are stored.
+static void *database_row_data_make(struct database_table table,
+                                    struct database_attribute_values values,
+                                    size_t *size) {
+  const size_t integer_data_size = sizeof(int64_t);
+  const size_t floating_point_data_size = sizeof(double);
+  const size_t boolean_data_size = sizeof(uint64_t);
+
+  size_t data_size_without_strings = 0;
+  size_t strings_data_size = 0;
+  for (size_t i = 0; i < table.attributes.count; i++) {
+    switch (database_attributes_get(table.attributes, i).type) {
+    case DATABASE_ATTRIBUTE_INTEGER:
+      data_size_without_strings += integer_data_size;
+      break;
+    case DATABASE_ATTRIBUTE_FLOATING_POINT:
+      data_size_without_strings += floating_point_data_size;
+      break;
+    case DATABASE_ATTRIBUTE_BOOLEAN:
+      data_size_without_strings += boolean_data_size;
+      break;
+    case DATABASE_ATTRIBUTE_STRING: {
+      const size_t string_data_size =
+          strlen(database_attribute_values_get(values, i).string) + 1;
+      data_size_without_strings += sizeof(uint64_t);
+      strings_data_size += string_data_size > DATABASE_STRING_INLINE_SIZE_MAX
+                               ? sizeof(struct database_file_string_blob)
+                               : string_data_size;
+    } break;
+    default:
+      break;
+    }
+  }
+
+  const size_t data_size = data_size_without_strings + strings_data_size;
+  void *data = malloc(data_size);
+  if (data == NULL) {
+    warn("Alloc data error");
+    return NULL;
+  }
+
+  size_t data_offset = 0;
+  size_t data_strings_offset = data_size_without_strings;
 
   for (size_t i = 0; i < table.attributes.count; i++) {
     switch (database_attributes_get(table.attributes, i).type) {
     case DATABASE_ATTRIBUTE_INTEGER: {
-      const int64_t value =
-          database_insert_row_request_get_value(request, i).integer;
+      const int64_t value = database_attribute_values_get(values, i).integer;
       memcpy((char *)data + data_offset, &value, integer_data_size);
       data_offset += integer_data_size;
     } break;
     case DATABASE_ATTRIBUTE_FLOATING_POINT: {
       const double value =
-          database_insert_row_request_get_value(request, i).floating_point;
+          database_attribute_values_get(values, i).floating_point;
       memcpy((char *)data + data_offset, &value, floating_point_data_size);
       data_offset += floating_point_data_size;
     } break;
     case DATABASE_ATTRIBUTE_BOOLEAN: {
-      const uint64_t value =
-          database_insert_row_request_get_value(request, i).boolean;
+      const uint64_t value = database_attribute_values_get(values, i).boolean;
       memcpy((char *)data + data_offset, &value, boolean_data_size);
       data_offset += boolean_data_size;
     } break;
     case DATABASE_ATTRIBUTE_STRING: {
-      const char *value =
-          database_insert_row_request_get_value(request, i).string;
+      const char *value = database_attribute_values_get(values, i).string;
       const size_t string_data_size = strlen(value) + 1;
-      memcpy((char *)data + data_offset, &data_strings_offset,
-             sizeof(uint64_t));
-      memcpy((char *)data + data_strings_offset, value, string_data_size);
+      if (string_data_size <= DATABASE_STRING_INLINE_SIZE_MAX) {
+        memcpy((char *)data + data_offset, &data_strings_offset,
+               sizeof(uint64_t));
+        memcpy((char *)data + data_strings_offset, value, string_data_size);
+        data_offset += sizeof(uint64_t);
+        data_strings_offset += string_data_size;
+        break;
+      }
+
+      const struct paging_blob_write_result write_result =
+          paging_blob_write(table.pager, value, string_data_size);
+      if (!write_result.success) {
+        warn("String blob write error");
+        database_row_blobs_remove_first(table, data, i);
+        free(data);
+        return NULL;
+      }
+
+      const uint64_t string_offset =
+          data_strings_offset | DATABASE_STRING_BLOB_FLAG;
+      const struct database_file_string_blob file_blob = {
+          .first_page_number = write_result.blob.first_page_number,
+          .size = write_result.blob.size};
+      memcpy((char *)data + data_offset, &string_offset, sizeof(uint64_t));
+      memcpy((char *)data + data_strings_offset, &file_blob,
+             sizeof(struct database_file_string_blob));
       data_offset += sizeof(uint64_t);
-      data_strings_offset += string_data_size;
+      data_strings_offset += sizeof(struct database_file_string_blob);
     } break;
     default:
       break;
@@ -308,10 +1169,209 @@ database_insert_row(struct database *database, struct database_table table,
   assert(data_offset == data_size_without_strings);
   assert(data_strings_offset == data_size);
 
+  *size = data_size;
+  return data;
+}
+
+static struct database_index_key
+database_row_index_key(struct database_index index,
+                       struct database_attribute_values values) {
+  return database_index_key_make(
+      index.type,
+      database_attribute_values_get(values, index.attribute_position));
+}
+
+// Adds the row to all indexes of the table or to none of them
+static bool database_row_indexes_insert(struct database_table table,
+                                        struct database_attribute_values values,
+                                        struct paging_record_id record_id) {
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    const struct database_index index = database_table_index_get(table, i);
+    if (database_index_insert(table.pager, index,
+                              database_row_index_key(index, values),
+                              record_id)) {
+      continue;
+    }
+
+    warn("Index insert error");
+    while (i-- > 0) {
+      const struct database_index inserted_index =
+          database_table_index_get(table, i);
+      database_index_remove(table.pager, inserted_index,
+                            database_row_index_key(inserted_index, values),
+                            record_id);
+    }
+    return false;
+  }
+
+  return true;
+}
+
+static bool database_row_indexes_remove(struct database_table table,
+                                        const struct database_index_key *keys,
+                                        struct paging_record_id record_id) {
+  bool success = true;
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    if (!database_index_remove(table.pager, database_table_index_get(table, i),
+                               keys[i], record_id)) {
+      warn("Index remove error");
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+// Collects the keys of the stored row in the indexes of the table, so that
+// the row can be found in them after it is changed
+static bool database_row_index_keys_fetch(const struct database *database,
+                                          struct database_table table,
+                                          struct paging_info info,
+                                          struct database_index_key **keys) {
+  *keys = NULL;
+  if (table.indexes_count == 0) {
+    return true;
+  }
+
+  const struct database_select_row_result select_result =
+      database_select_row_with_info(database, table, info,
+                                    DATABASE_WHERE_ALWAYS);
+  if (!select_result.success) {
+    return false;
+  }
+
+  *keys = malloc(table.indexes_count * sizeof(struct database_index_key));
+  if (*keys == NULL) {
+    warn("Alloc index keys error");
+    database_row_destroy(select_result.row);
+    return false;
+  }
+
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    (*keys)[i] = database_row_index_key(database_table_index_get(table, i),
+                                        select_result.row.values);
+  }
+
+  database_row_destroy(select_result.row);
+  return true;
+}
+
+static int database_record_id_compare(const void *left, const void *right) {
+  const struct paging_record_id *left_record_id = left;
+  const struct paging_record_id *right_record_id = right;
+  if (left_record_id->page_number != right_record_id->page_number) {
+    return left_record_id->page_number < right_record_id->page_number ? -1
+                                                                      : 1;
+  }
+  return (left_record_id->slot_number > right_record_id->slot_number) -
+         (left_record_id->slot_number < right_record_id->slot_number);
+}
+
+// Looks for another row with the value of the row in the attribute of the
+// key constraint of the index. The rows with the skipped record ids, which
+// are sorted, are not compared. Strings are indexed by their prefixes, so
+// the rows found by a string key are compared by their values.
+static bool database_row_constraint_check(
+    const struct database *database, struct database_table table,
+    struct database_index index, struct database_attribute_values values,
+    const struct paging_record_id *skipped_record_ids,
+    size_t skipped_record_ids_count, bool *is_violated) {
+  *is_violated = false;
+  const struct database_index_key key = database_row_index_key(index, values);
+  const struct database_index_find_result find_result = database_index_find(
+      table.pager, index,
+      (struct database_index_range){
+          .has_lower = true, .lower = key, .has_upper = true, .upper = key});
+  if (!find_result.success) {
+    return false;
+  }
+
+  bool success = true;
+  for (size_t i = 0; success && !*is_violated && i < find_result.count; i++) {
+    const struct paging_record_id record_id = find_result.record_ids[i];
+    if (skipped_record_ids_count > 0 &&
+        bsearch(&record_id, skipped_record_ids, skipped_record_ids_count,
+                sizeof(struct paging_record_id),
+                database_record_id_compare) != NULL) {
+      continue;
+    }
+    if (index.type != DATABASE_ATTRIBUTE_STRING) {
+      *is_violated = true;
+      break;
+    }
+
+    const struct database_select_row_result select_result =
+        database_select_row_with_info(
+            database, table,
+            (struct paging_info){.chain = table.rows_chain,
+                                 .record_id = record_id},
+            DATABASE_WHERE_ALWAYS);
+    success = select_result.success;
+    if (success) {
+      *is_violated =
+          strcmp(database_attribute_values_get(select_result.row.values,
+                                               index.attribute_position)
+                     .string,
+                 database_attribute_values_get(values,
+                                               index.attribute_position)
+                     .string) == 0;
+      database_row_destroy(select_result.row);
+    }
+  }
+  free(find_result.record_ids);
+  if (success && *is_violated) {
+    warn("Key constraint of index %s violated", index.name);
+  }
+
+  return success;
+}
+
+static bool database_row_constraints_check(
+    const struct database *database, struct database_table table,
+    struct database_attribute_values values, bool *is_violated) {
+  *is_violated = false;
+  for (size_t i = 0; !*is_violated && i < table.indexes_count; i++) {
+    const struct database_index index = database_table_index_get(table, i);
+    if (index.constraint != DATABASE_INDEX_CONSTRAINT_NONE &&
+        !database_row_constraint_check(database, table, index, values, NULL,
+                                       0, is_violated)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+struct database_insert_row_result
+database_insert_row(struct database *database, struct database_table table,
+                    struct database_insert_row_request request) {
+  bool is_constraint_violated;
+  if (!database_row_constraints_check(database, table, request.values,
+                                      &is_constraint_violated) ||
+      is_constraint_violated) {
+    return (struct database_insert_row_result){
+        .success = false, .is_constraint_violated = is_constraint_violated};
+  }
+
+  size_t data_size;
+  void *data = database_row_data_make(table, request.values, &data_size);
+  if (data == NULL) {
+    return (struct database_insert_row_result){.success = false};
+  }
+
   struct paging_write_result write_result =
-      paging_write(database->pager, PAGING_TYPE_2, data, data_size);
+      paging_write(table.pager, table.rows_chain, data, data_size);
   if (!write_result.success) {
     warn("Write data to pager error");
+    database_row_blobs_remove(table, data);
+    free(data);
+    return (struct database_insert_row_result){.success = false};
+  }
+
+  if (!database_row_indexes_insert(table, request.values,
+                                   write_result.info.record_id)) {
+    paging_remove(table.pager, write_result.info);
+    database_row_blobs_remove(table, data);
     free(data);
     return (struct database_insert_row_result){.success = false};
   }
@@ -321,24 +1381,305 @@ database_insert_row(struct database *database, struct database_table table,
   return (struct database_insert_row_result){.success = true};
 }
 
+struct database_key_value {
+  enum database_attribute_type type;
+  union database_attribute_value value;
+};
+
+static int database_key_value_compare(const void *left, const void *right) {
+  const struct database_key_value *left_value = left;
+  const struct database_key_value *right_value = right;
+  return database_sort_values_compare(left_value->type, left_value->value,
+                                      right_value->value);
+}
+
+// Checks the new values of all updated rows before any of them is written.
+// A key may be kept neither by a row that is not updated nor by two updated
+// rows, the old keys of the updated rows do not count.
+static bool database_rows_constraints_check(
+    const struct database *database, struct database_table table,
+    const struct paging_info *infos,
+    const struct database_attribute_values *values, size_t count,
+    bool *is_violated) {
+  *is_violated = false;
+  if (count == 0) {
+    return true;
+  }
+
+  struct paging_record_id *record_ids =
+      malloc(count * sizeof(struct paging_record_id));
+  struct database_key_value *keys =
+      malloc(count * sizeof(struct database_key_value));
+  if (record_ids == NULL || keys == NULL) {
+    free(record_ids);
+    free(keys);
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    record_ids[i] = infos[i].record_id;
+  }
+  qsort(record_ids, count, sizeof(struct paging_record_id),
+        database_record_id_compare);
+
+  bool success = true;
+  for (size_t i = 0; success && !*is_violated && i < table.indexes_count;
+       i++) {
+    const struct database_index index = database_table_index_get(table, i);
+    if (index.constraint == DATABASE_INDEX_CONSTRAINT_NONE) {
+      continue;
+    }
+
+    for (size_t j = 0; j < count; j++) {
+      keys[j] = (struct database_key_value){
+          .type = index.type,
+          .value = database_attribute_values_get(values[j],
+                                                 index.attribute_position)};
+    }
+    qsort(keys, count, sizeof(struct database_key_value),
+          database_key_value_compare);
+    for (size_t j = 1; !*is_violated && j < count; j++) {
+      *is_violated = database_key_value_compare(&keys[j - 1], &keys[j]) == 0;
+    }
+    if (*is_violated) {
+      warn("Key constraint of index %s violated", index.name);
+      break;
+    }
+
+    for (size_t j = 0; success && !*is_violated && j < count; j++) {
+      success = database_row_constraint_check(
+          database, table, index, values[j], record_ids, count, is_violated);
+    }
+  }
+
+  free(record_ids);
+  free(keys);
+  return success;
+}
+
+// A row of an update, staged with its new record before any row is
+// written, and with a copy of its old record to write back on a failure
+struct database_row_update {
+  struct paging_info info;
+  bool is_written;
+  void *data;
+  size_t data_size;
+  void *old_data;
+  size_t old_data_size;
+  struct database_index_key *keys;
+  struct database_index_key *old_keys;
+  struct paging_blob *old_blobs;
+  size_t old_blobs_count;
+};
+
+// Frees the staged row, the blobs of its new record too unless it is written
+static void database_row_update_destroy(struct database_table table,
+                                        struct database_row_update *update) {
+  if (!update->is_written && update->data != NULL) {
+    database_row_blobs_remove(table, update->data);
+  }
+  free(update->data);
+  free(update->old_data);
+  free(update->keys);
+  free(update->old_keys);
+  free(update->old_blobs);
+}
+
+// Makes the new record and the index keys of the row. Strings of the values
+// may point into pages that writing other rows compacts, so everything the
+// write needs is copied from them here.
+static bool database_row_update_stage(const struct database *database,
+                                      struct database_table table,
+                                      struct paging_info info,
+                                      struct database_attribute_values values,
+                                      struct database_row_update *update) {
+  *update = (struct database_row_update){.info = info};
+
+  void *old_data = NULL;
+  const struct paging_read_result read_result =
+      paging_fetch(table.pager, info, &old_data);
+  if (!read_result.success) {
+    return false;
+  }
+  update->old_data_size = read_result.size;
+  if (read_result.is_data_owned) {
+    update->old_data = old_data;
+  } else {
+    update->old_data = malloc(read_result.size);
+    if (update->old_data == NULL) {
+      warn("Alloc row data error");
+      return false;
+    }
+    memcpy(update->old_data, old_data, read_result.size);
+  }
+
+  if (table.indexes_count > 0) {
+    update->keys =
+        malloc(table.indexes_count * sizeof(struct database_index_key));
+    if (update->keys == NULL) {
+      warn("Alloc index keys error");
+      database_row_update_destroy(table, update);
+      return false;
+    }
+    for (size_t i = 0; i < table.indexes_count; i++) {
+      update->keys[i] =
+          database_row_index_key(database_table_index_get(table, i), values);
+    }
+  }
+
+  if (!database_row_index_keys_fetch(database, table, info,
+                                     &update->old_keys) ||
+      !database_row_blobs_fetch(table, info, &update->old_blobs,
+                                &update->old_blobs_count)) {
+    database_row_update_destroy(table, update);
+    return false;
+  }
+
+  update->data = database_row_data_make(table, values, &update->data_size);
+  if (update->data == NULL) {
+    database_row_update_destroy(table, update);
+    return false;
+  }
+  return true;
+}
+
+// Moves the changed keys of the written row and frees its old blobs. The
+// row keeps its record id.
+static bool database_row_update_finish(struct database_table table,
+                                       struct database_row_update *update) {
+  bool indexes_success = true;
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    const struct database_index index = database_table_index_get(table, i);
+    const struct database_index_key key = update->keys[i];
+    const struct database_index_key old_key = update->old_keys[i];
+    if ((old_key.size != key.size ||
+         memcmp(old_key.bytes, key.bytes, key.size) != 0) &&
+        (!database_index_remove(table.pager, index, old_key,
+                                update->info.record_id) ||
+         !database_index_insert(table.pager, index, key,
+                                update->info.record_id))) {
+      warn("Index update error");
+      indexes_success = false;
+    }
+  }
+
+  const bool blobs_success = database_blobs_remove(
+      table, update->old_blobs, update->old_blobs_count);
+  update->old_blobs = NULL;
+  return blobs_success && indexes_success;
+}
+
+struct database_update_rows_result
+database_update_rows(struct database *database, struct database_table table,
+                     const struct paging_info *infos,
+                     const struct database_attribute_values *values,
+                     size_t count) {
+  if (database == NULL) {
+    return (struct database_update_rows_result){.success = false};
+  }
+
+  bool is_constraint_violated;
+  if (!database_rows_constraints_check(database, table, infos, values, count,
+                                       &is_constraint_violated) ||
+      is_constraint_violated) {
+    return (struct database_update_rows_result){
+        .success = false, .is_constraint_violated = is_constraint_violated};
+  }
+  if (count == 0) {
+    return (struct database_update_rows_result){.success = true};
+  }
+
+  struct database_row_update *updates =
+      malloc(count * sizeof(struct database_row_update));
+  if (updates == NULL) {
+    warn("Alloc row updates error");
+    return (struct database_update_rows_result){.success = false};
+  }
+
+  size_t staged_count = 0;
+  while (staged_count < count &&
+         database_row_update_stage(database, table, infos[staged_count],
+                                   values[staged_count],
+                                   &updates[staged_count])) {
+    staged_count++;
+  }
+
+  bool success = staged_count == count;
+  for (size_t i = 0; success && i < count; i++) {
+    success = paging_update(table.pager, updates[i].info, updates[i].data,
+                            updates[i].data_size)
+                  .success;
+    updates[i].is_written = success;
+    if (!success) {
+      warn("Update data in pager error");
+    }
+  }
+
+  // The rows written before a failure get their old records back, their old
+  // blobs and index keys are still in place
+  for (size_t i = 0; !success && i < staged_count; i++) {
+    if (updates[i].is_written &&
+        !paging_update(table.pager, updates[i].info, updates[i].old_data,
+                       updates[i].old_data_size)
+             .success) {
+      warn("Restore row data in pager error");
+    } else {
+      updates[i].is_written = false;
+    }
+  }
+
+  for (size_t i = 0; i < staged_count; i++) {
+    if (updates[i].is_written &&
+        !database_row_update_finish(table, &updates[i])) {
+      success = false;
+    }
+    database_row_update_destroy(table, &updates[i]);
+  }
+  free(updates);
+
+  return (struct database_update_rows_result){.success = success};
+}
+
+// Reads the string of the attribute from its blob unless it is already read
+static bool database_row_blob_string_load(struct database_table table,
+                                          struct database_row *row,
+                                          size_t position) {
+  struct paging_blob blob;
+  if (database_attributes_get(table.attributes, position).type !=
+          DATABASE_ATTRIBUTE_STRING ||
+      database_attribute_values_get(row->values, position).string != NULL ||
+      !database_row_string_blob(table, row->data, position, &blob)) {
+    return true;
+  }
+
+  void *string = NULL;
+  const struct paging_blob_read_result read_result =
+      paging_blob_read(table.pager, blob, &string);
+  if (!read_result.success) {
+    warn("String blob read error");
+    return false;
+  }
+
+  if (read_result.is_data_owned) {
+    row->blob_strings[position] = string;
+  }
+  const union database_attribute_value value = {.string = string};
+  database_attribute_values_set(row->values, position, value);
+  return true;
+}
+
+// Strings stored in blobs are read only when the condition needs them, and
+// the rest of them only when the row satisfies the condition
 struct database_select_row_result
 database_row_values_from_file_data(struct database_table table,
                                    struct database_where where,
-                                   struct paging_info paging_info, void *data) {
-  const size_t header_data_size = sizeof(struct database_file_row_header);
+                                   struct paging_read_result read_result,
+                                   void *data) {
   const size_t integer_data_size = sizeof(int64_t);
   const size_t floating_point_data_size = sizeof(double);
   const size_t boolean_data_size = sizeof(uint64_t);
 
   size_t data_offset = 0;
-
-  const struct database_file_row_header *header = data;
-  data_offset += header_data_size;
-
-  const char *table_name = (char *)data + header->table_name_offset;
-  if (strcmp(table_name, table.name) != 0) {
-    return (struct database_select_row_result){.success = false};
-  }
+  bool has_blob_strings = false;
 
   struct database_attribute_values values =
       database_attribute_values_create(table.attributes.count);
@@ -366,9 +1707,11 @@ database_row_values_from_file_data(struct database_table table,
     case DATABASE_ATTRIBUTE_STRING: {
       const uint64_t string_offset =
           *((uint64_t *)((char *)data + data_offset));
-      const union database_attribute_value value = {.string = (char *)data +
-                                                              string_offset};
+      const bool is_blob = (string_offset & DATABASE_STRING_BLOB_FLAG) != 0;
+      const union database_attribute_value value = {
+          .string = is_blob ? NULL : (char *)data + string_offset};
       database_attribute_values_set(values, i, value);
+      has_blob_strings = has_blob_strings || is_blob;
       data_offset += sizeof(uint64_t);
     } break;
     default:
@@ -376,11 +1719,36 @@ database_row_values_from_file_data(struct database_table table,
     }
   }
 
-  const struct database_row row = {
-      .data = data, .paging_info = paging_info, .values = values};
-  if (!database_where_is_satisfied(table, row, where)) {
-    database_attribute_values_destroy(values);
-    return (struct database_select_row_result){.success = false};
+  struct database_row row = {.data = data,
+                             .is_data_owned = read_result.is_data_owned,
+                             .paging_info = read_result.info,
+                             .values = values};
+  if (!has_blob_strings) {
+    if (!database_where_is_satisfied(table, row, where)) {
+      database_attribute_values_destroy(values);
+      return (struct database_select_row_result){.success = false};
+    }
+
+    return (struct database_select_row_result){.success = true, .row = row};
+  }
+
+  row.blob_strings = calloc(table.attributes.count, sizeof(char *));
+  bool success = row.blob_strings != NULL;
+  for (size_t i = 0; success && i < table.attributes.count; i++) {
+    success = !database_where_uses_attribute(where, i) ||
+              database_row_blob_string_load(table, &row, i);
+  }
+
+  success = success && database_where_is_satisfied(table, row, where);
+  for (size_t i = 0; success && i < table.attributes.count; i++) {
+    success = database_row_blob_string_load(table, &row, i);
+  }
+
+  if (!success) {
+    // The data is freed by the caller
+    row.data = NULL;
+    database_row_destroy(row);
+    return (struct database_select_row_result){.success = false};
   }
 
   return (struct database_select_row_result){.success = true, .row = row};
@@ -396,148 +1764,1118 @@ database_select_row_first(const struct database *database,
 
   void *data = NULL;
   struct paging_read_result read_result =
-      paging_read_first(database->pager, PAGING_TYPE_2, &data);
+      paging_read_first(table.pager, table.rows_chain, &data);
 
   while (read_result.success) {
     const struct database_select_row_result select_result =
-        database_row_values_from_file_data(table, where, read_result.info,
-                                           data);
+        database_row_values_from_file_data(table, where, read_result, data);
     if (select_result.success) {
       return select_result;
     }
 
-    free(data);
-    read_result = paging_read_next(database->pager, read_result.info, &data);
+    if (read_result.is_data_owned) {
+      free(data);
+    }
+    read_result = paging_read_next(table.pager, read_result.info, &data);
   }
 
   return (struct database_select_row_result){.success = false};
 }
 
-struct database_select_row_result database_select_row_next(
-    const struct database *database, struct database_table table,
-    struct database_where where, struct database_row previous) {
+struct database_select_row_result
+database_select_row_with_info(const struct database *database,
+                              struct database_table table,
+                              struct paging_info info,
+                              struct database_where where) {
   if (database == NULL) {
     return (struct database_select_row_result){.success = false};
   }
 
   void *data = NULL;
-  struct paging_read_result read_result =
-      paging_read_next(database->pager, previous.paging_info, &data);
+  const struct paging_read_result read_result =
+      paging_fetch(table.pager, info, &data);
+  if (!read_result.success) {
+    return (struct database_select_row_result){.success = false};
+  }
 
-  database_row_destroy(previous);
+  const struct database_select_row_result select_result =
+      database_row_values_from_file_data(table, where, read_result, data);
+  if (!select_result.success && read_result.is_data_owned) {
+    free(data);
+  }
+  return select_result;
+}
+
+// Reads the rows after the row with the paging info
+static struct database_select_row_result
+database_select_row_after(struct database_table table,
+                          struct database_where where,
+                          struct paging_info info) {
+  void *data = NULL;
+  struct paging_read_result read_result =
+      paging_read_next(table.pager, info, &data);
 
   while (read_result.success) {
     const struct database_select_row_result select_result =
-        database_row_values_from_file_data(table, where, read_result.info,
-                                           data);
+        database_row_values_from_file_data(table, where, read_result, data);
     if (select_result.success) {
       return select_result;
     }
 
-    free(data);
-    read_result = paging_read_next(database->pager, read_result.info, &data);
+    if (read_result.is_data_owned) {
+      free(data);
+    }
+    read_result = paging_read_next(table.pager, read_result.info, &data);
   }
 
   return (struct database_select_row_result){.success = false};
 }
 
-struct database_select_join_result database_select_join_first(
-    const struct database *database, struct database_table left_table,
-    struct database_table right_table, struct database_join join,
-    struct database_where_joined where) {
+struct database_select_row_result database_select_row_next(
+    const struct database *database, struct database_table table,
+    struct database_where where, struct database_row previous) {
   if (database == NULL) {
-    return (struct database_select_join_result){.success = false};
+    return (struct database_select_row_result){.success = false};
   }
 
-  struct database_select_row_result left_result =
-      database_select_row_first(database, left_table, DATABASE_WHERE_ALWAYS);
-  while (left_result.success) {
-    struct database_select_row_result right_result =
-        database_select_row_first(database, right_table, DATABASE_WHERE_ALWAYS);
-    while (right_result.success) {
-      if (database_join_is_satisfied(left_table, left_result.row, right_table,
-                                     right_result.row, join) &&
-          database_where_joined_is_satisfied(left_table, right_table,
-                                             left_result.row, right_result.row,
-                                             where)) {
+  const struct paging_info info = previous.paging_info;
+  database_row_destroy(previous);
+  return database_select_row_after(table, where, info);
+}
+
+// Rows of one table of a merge join in the order of the join attribute
+struct database_join_input {
+  struct database_table table;
+  // Record ids in the order of a B+tree index of the attribute, the rows are
+  // fetched one by one. NULL when the rows are sorted instead.
+  size_t record_ids_count;
+  size_t record_ids_position;
+  struct paging_record_id *record_ids;
+  struct database_sort *sort;
+};
+
+enum database_select_join_method {
+  DATABASE_SELECT_JOIN_METHOD_HASH,
+  DATABASE_SELECT_JOIN_METHOD_MERGE,
+  DATABASE_SELECT_JOIN_METHOD_INDEX,
+};
+
+// When the join attribute of the right table is indexed, the index is
+// looked up with the value of every left row and the right table is not
+// read otherwise. Else the tables are read side by side until one of them
+// ends. When the rows of that table fit into the join memory, they are kept
+// in the hash table and the rows of the other table are probed in the order
+// they are read, those read before the hash table was complete first. When
+// neither table fits, both are read in the order of the join attribute and
+// merged.
+struct database_select_join {
+  struct database_table left_table;
+  struct database_table right_table;
+  struct database_join join;
+  struct database_where_joined where;
+  enum database_select_join_method method;
+  bool is_left_built;
+  struct database_join_hash_table *built_rows;
+  size_t read_rows_count;
+  size_t read_rows_position;
+  struct database_row *read_rows;
+  bool is_probe_table_read;
+  bool has_probe_row;
+  struct database_row probe_row;
+  size_t match_position;
+  // The right rows with the value of the left row are grouped, so that the
+  // following left rows with the value are paired with them as well
+  struct database_join_input inputs[2];
+  bool has_left_row;
+  struct database_row left_row;
+  bool has_right_row;
+  struct database_row right_row;
+  size_t group_rows_count;
+  size_t group_rows_capacity;
+  size_t group_rows_position;
+  struct database_row *group_rows;
+  // Record ids of the right rows found by the value of the left row
+  struct database_index right_index;
+  bool is_left_row_looked_up;
+  size_t right_record_ids_count;
+  size_t right_record_ids_position;
+  struct paging_record_id *right_record_ids;
+};
+
+static bool database_rows_reserve(struct database_row **rows, size_t count,
+                                  size_t *capacity) {
+  if (count < *capacity) {
+    return true;
+  }
+
+  const size_t new_capacity = *capacity == 0 ? 64 : *capacity * 2;
+  struct database_row *new_rows =
+      realloc(*rows, new_capacity * sizeof(struct database_row));
+  if (new_rows == NULL) {
+    warn("Rows allocation error");
+    return false;
+  }
+  *rows = new_rows;
+  *capacity = new_capacity;
+  return true;
+}
+
+static void database_rows_destroy(struct database_row *rows, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    database_row_destroy(rows[i]);
+  }
+  free(rows);
+}
+
+// Takes the rows read so far and the result of reading the next row, the
+// rest of the table is read here unless an index orders it
+static bool database_join_input_open(struct database_join_input *input,
+                                     struct database_table table,
+                                     size_t attribute_position,
+                                     struct database_row *rows,
+                                     size_t rows_count,
+                                     struct database_select_row_result result) {
+  input->table = table;
+
+  // Strings are indexed by their prefixes, which do not order them
+  const bool is_index_order_usable =
+      database_attributes_get(table.attributes, attribute_position).type !=
+      DATABASE_ATTRIBUTE_STRING;
+  for (size_t i = 0; is_index_order_usable && i < table.indexes_count; i++) {
+    const struct database_index index = database_table_index_get(table, i);
+    if (index.attribute_position != attribute_position ||
+        index.method != DATABASE_INDEX_METHOD_BTREE) {
+      continue;
+    }
+
+    const struct database_index_find_result find_result = database_index_find(
+        table.pager, index, (struct database_index_range){.has_lower = false});
+    if (!find_result.success) {
+      break;
+    }
+
+    database_rows_destroy(rows, rows_count);
+    if (result.success) {
+      database_row_destroy(result.row);
+    }
+    input->record_ids_count = find_result.count;
+    input->record_ids = find_result.record_ids;
+    return true;
+  }
+
+  input->sort = database_sort_create(table.pager, table.attributes,
+                                     attribute_position,
+                                     DATABASE_JOIN_MEMORY_SIZE);
+  bool success = input->sort != NULL;
+  for (size_t i = 0; i < rows_count; i++) {
+    if (success) {
+      success = database_sort_add(input->sort, rows[i]);
+    } else {
+      database_row_destroy(rows[i]);
+    }
+  }
+  free(rows);
+
+  if (!success && result.success) {
+    database_row_destroy(result.row);
+  }
+  while (success && result.success) {
+    const struct paging_info info = result.row.paging_info;
+    success = database_sort_add(input->sort, result.row);
+    if (success) {
+      result = database_select_row_after(table, DATABASE_WHERE_ALWAYS, info);
+    }
+  }
+
+  return success && database_sort_finish(input->sort);
+}
+
+static bool database_join_input_read(const struct database *database,
+                                     struct database_join_input *input,
+                                     struct database_row *row) {
+  if (input->sort != NULL) {
+    const struct database_sort_read_result read_result =
+        database_sort_next(input->sort);
+    *row = read_result.row;
+    return read_result.success;
+  }
+
+  while (input->record_ids_position < input->record_ids_count) {
+    const struct database_select_row_result select_result =
+        database_select_row_with_info(
+            database, input->table,
+            (struct paging_info){
+                .chain = input->table.rows_chain,
+                .record_id = input->record_ids[input->record_ids_position++]},
+            DATABASE_WHERE_ALWAYS);
+    if (select_result.success) {
+      *row = select_result.row;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void database_join_input_close(struct database_join_input input) {
+  free(input.record_ids);
+  database_sort_destroy(input.sort);
+}
+
+// Reads the tables side by side, a table stops being read once its rows do
+// not fit into the join memory
+static bool
+database_select_join_build(const struct database *database,
+                           struct database_select_join *select_join) {
+  const struct database_table tables[] = {select_join->left_table,
+                                          select_join->right_table};
+  const size_t attribute_positions[] = {
+      select_join->join.left_attribute_position,
+      select_join->join.right_attribute_position};
+  struct database_row *rows[] = {NULL, NULL};
+  size_t counts[] = {0, 0};
+  size_t capacities[] = {0, 0};
+  size_t sizes[] = {0, 0};
+  struct database_select_row_result results[] = {
+      database_select_row_first(database, tables[0], DATABASE_WHERE_ALWAYS),
+      database_select_row_first(database, tables[1], DATABASE_WHERE_ALWAYS)};
+
+  bool success = true;
+  while (success && results[0].success && results[1].success &&
+         (sizes[0] <= DATABASE_JOIN_MEMORY_SIZE ||
+          sizes[1] <= DATABASE_JOIN_MEMORY_SIZE)) {
+    for (size_t i = 0;
+         i < 2 && success && results[0].success && results[1].success; i++) {
+      if (sizes[i] > DATABASE_JOIN_MEMORY_SIZE) {
+        continue;
+      }
+
+      success = database_rows_reserve(&rows[i], counts[i], &capacities[i]);
+      if (success) {
+        rows[i][counts[i]++] = results[i].row;
+        sizes[i] += database_row_size(tables[i].attributes, results[i].row);
+        results[i] = database_select_row_after(
+            tables[i], DATABASE_WHERE_ALWAYS, results[i].row.paging_info);
+      }
+    }
+  }
+
+  if (!success) {
+    for (size_t i = 0; i < 2; i++) {
+      database_rows_destroy(rows[i], counts[i]);
+      if (results[i].success) {
+        database_row_destroy(results[i].row);
+      }
+    }
+    return false;
+  }
+
+  if (results[0].success && results[1].success) {
+    select_join->method = DATABASE_SELECT_JOIN_METHOD_MERGE;
+    for (size_t i = 0; i < 2; i++) {
+      success = database_join_input_open(&select_join->inputs[i], tables[i],
+                                         attribute_positions[i], rows[i],
+                                         counts[i], results[i]) &&
+                success;
+    }
+    if (!success) {
+      warn("Join input read error");
+    }
+    return success;
+  }
+
+  select_join->method = DATABASE_SELECT_JOIN_METHOD_HASH;
+  select_join->is_left_built = !results[0].success;
+  const size_t built = select_join->is_left_built ? 0 : 1;
+  const size_t probed = 1 - built;
+  select_join->is_probe_table_read = !results[probed].success;
+  if (results[probed].success) {
+    success = database_rows_reserve(&rows[probed], counts[probed],
+                                    &capacities[probed]);
+    if (success) {
+      rows[probed][counts[probed]++] = results[probed].row;
+    } else {
+      database_row_destroy(results[probed].row);
+    }
+  }
+  select_join->read_rows = rows[probed];
+  select_join->read_rows_count = counts[probed];
+
+  if (success) {
+    select_join->built_rows = database_join_hash_table_create(
+        attribute_positions[built],
+        database_attributes_get(tables[built].attributes,
+                                attribute_positions[built])
+            .type);
+    success = select_join->built_rows != NULL;
+  }
+  size_t inserted_count = 0;
+  while (success && inserted_count < counts[built]) {
+    success = database_join_hash_table_insert(select_join->built_rows,
+                                              rows[built][inserted_count]);
+    inserted_count += success;
+  }
+  for (size_t i = inserted_count; i < counts[built]; i++) {
+    database_row_destroy(rows[built][i]);
+  }
+  free(rows[built]);
+
+  if (!success) {
+    warn("Join hash table build error");
+  }
+  return success;
+}
+
+// Takes the next row of the probed table
+static void
+database_select_join_probe_next(struct database_select_join *select_join) {
+  const bool had_probe_row = select_join->has_probe_row;
+  const struct paging_info info = select_join->probe_row.paging_info;
+  if (had_probe_row) {
+    database_row_destroy(select_join->probe_row);
+  }
+  select_join->has_probe_row = false;
+  select_join->match_position = DATABASE_JOIN_NO_ROW;
+
+  if (select_join->read_rows_position < select_join->read_rows_count) {
+    select_join->probe_row =
+        select_join->read_rows[select_join->read_rows_position++];
+    select_join->has_probe_row = true;
+    return;
+  }
+  if (select_join->is_probe_table_read || !had_probe_row) {
+    return;
+  }
+
+  const struct database_select_row_result result = database_select_row_after(
+      select_join->is_left_built ? select_join->right_table
+                                 : select_join->left_table,
+      DATABASE_WHERE_ALWAYS, info);
+  select_join->has_probe_row = result.success;
+  select_join->is_probe_table_read = !result.success;
+  if (result.success) {
+    select_join->probe_row = result.row;
+  }
+}
+
+static struct database_select_join_result
+database_select_join_hash_find(struct database_select_join *select_join) {
+  const size_t probe_attribute_position =
+      select_join->is_left_built ? select_join->join.right_attribute_position
+                                 : select_join->join.left_attribute_position;
+  while (select_join->has_probe_row) {
+    select_join->match_position =
+        select_join->match_position == DATABASE_JOIN_NO_ROW
+            ? database_join_hash_table_find_first(
+                  select_join->built_rows,
+                  database_attribute_values_get(select_join->probe_row.values,
+                                                probe_attribute_position))
+            : database_join_hash_table_find_next(select_join->built_rows,
+                                                 select_join->match_position);
+    if (select_join->match_position == DATABASE_JOIN_NO_ROW) {
+      database_select_join_probe_next(select_join);
+      continue;
+    }
+
+    const struct database_row built_row = database_join_hash_table_get(
+        select_join->built_rows, select_join->match_position);
+    const struct database_row left_row =
+        select_join->is_left_built ? built_row : select_join->probe_row;
+    const struct database_row right_row =
+        select_join->is_left_built ? select_join->probe_row : built_row;
+    if (database_where_joined_is_satisfied(select_join->left_table,
+                                           select_join->right_table, left_row,
+                                           right_row, select_join->where)) {
+      return (struct database_select_join_result){
+          .success = true, .left_row = left_row, .right_row = right_row};
+    }
+  }
+
+  return (struct database_select_join_result){.success = false};
+}
+
+static bool database_join_value_is_nan(enum database_attribute_type type,
+                                       union database_attribute_value value) {
+  return type == DATABASE_ATTRIBUTE_FLOATING_POINT &&
+         isnan(value.floating_point);
+}
+
+static void
+database_select_join_left_next(const struct database *database,
+                               struct database_select_join *select_join) {
+  database_row_destroy(select_join->left_row);
+  select_join->has_left_row = database_join_input_read(
+      database, &select_join->inputs[0], &select_join->left_row);
+}
+
+static void
+database_select_join_right_next(const struct database *database,
+                                struct database_select_join *select_join) {
+  select_join->has_right_row = database_join_input_read(
+      database, &select_join->inputs[1], &select_join->right_row);
+}
+
+static struct database_select_join_result
+database_select_join_merge_find(const struct database *database,
+                                struct database_select_join *select_join) {
+  const size_t left_position = select_join->join.left_attribute_position;
+  const size_t right_position = select_join->join.right_attribute_position;
+  const enum database_attribute_type type =
+      database_attributes_get(select_join->left_table.attributes,
+                              left_position)
+          .type;
+  while (select_join->has_left_row) {
+    const union database_attribute_value left_value =
+        database_attribute_values_get(select_join->left_row.values,
+                                      left_position);
+    if (select_join->group_rows_count > 0 &&
+        database_sort_values_compare(
+            type, left_value,
+            database_attribute_values_get(select_join->group_rows[0].values,
+                                          right_position)) == 0) {
+      while (select_join->group_rows_position <
+             select_join->group_rows_count) {
+        const struct database_row right_row =
+            select_join->group_rows[select_join->group_rows_position++];
+        if (database_where_joined_is_satisfied(
+                select_join->left_table, select_join->right_table,
+                select_join->left_row, right_row, select_join->where)) {
+          return (struct database_select_join_result){
+              .success = true,
+              .left_row = select_join->left_row,
+              .right_row = right_row};
+        }
+      }
+
+      select_join->group_rows_position = 0;
+      database_select_join_left_next(database, select_join);
+      continue;
+    }
+
+    for (size_t i = 0; i < select_join->group_rows_count; i++) {
+      database_row_destroy(select_join->group_rows[i]);
+    }
+    select_join->group_rows_count = 0;
+    select_join->group_rows_position = 0;
+
+    // NaN equals nothing, and indexes order it before or after all numbers
+    // by its sign, so it is skipped on both sides
+    if (database_join_value_is_nan(type, left_value)) {
+      database_select_join_left_next(database, select_join);
+      continue;
+    }
+    while (select_join->has_right_row) {
+      const union database_attribute_value right_value =
+          database_attribute_values_get(select_join->right_row.values,
+                                        right_position);
+      if (!database_join_value_is_nan(type, right_value) &&
+          database_sort_values_compare(type, right_value, left_value) >= 0) {
+        break;
+      }
+      database_row_destroy(select_join->right_row);
+      database_select_join_right_next(database, select_join);
+    }
+
+    while (select_join->has_right_row &&
+           database_sort_values_compare(
+               type,
+               database_attribute_values_get(select_join->right_row.values,
+                                             right_position),
+               left_value) == 0) {
+      if (!database_rows_reserve(&select_join->group_rows,
+                                 select_join->group_rows_count,
+                                 &select_join->group_rows_capacity)) {
+        return (struct database_select_join_result){.success = false};
+      }
+      select_join->group_rows[select_join->group_rows_count++] =
+          select_join->right_row;
+      database_select_join_right_next(database, select_join);
+    }
+
+    if (select_join->group_rows_count == 0) {
+      if (!select_join->has_right_row) {
+        break;
+      }
+      database_select_join_left_next(database, select_join);
+    }
+  }
+
+  return (struct database_select_join_result){.success = false};
+}
+
+// A hash table finds one key in fewer page reads than a tree
+static bool
+database_select_join_index_choose(struct database_select_join *select_join) {
+  bool is_index_found = false;
+  for (size_t i = 0; i < select_join->right_table.indexes_count; i++) {
+    const struct database_index index =
+        database_table_index_get(select_join->right_table, i);
+    if (index.attribute_position ==
+            select_join->join.right_attribute_position &&
+        (!is_index_found || index.method == DATABASE_INDEX_METHOD_HASH)) {
+      is_index_found = true;
+      select_join->right_index = index;
+    }
+  }
+  return is_index_found;
+}
+
+static void
+database_select_join_index_left_next(struct database_select_join *select_join) {
+  const struct paging_info info = select_join->left_row.paging_info;
+  database_row_destroy(select_join->left_row);
+  const struct database_select_row_result result =
+      database_select_row_after(select_join->left_table, DATABASE_WHERE_ALWAYS,
+                                info);
+  select_join->has_left_row = result.success;
+  select_join->left_row = result.row;
+  select_join->is_left_row_looked_up = false;
+}
+
+static struct database_select_join_result
+database_select_join_index_find(const struct database *database,
+                                struct database_select_join *select_join) {
+  const struct database_index index = select_join->right_index;
+  while (select_join->has_left_row) {
+    if (!select_join->is_left_row_looked_up) {
+      const struct database_index_key key = database_index_key_make(
+          index.type,
+          database_attribute_values_get(
+              select_join->left_row.values,
+              select_join->join.left_attribute_position));
+      const struct database_index_find_result find_result =
+          database_index_find(select_join->right_table.pager, index,
+                              (struct database_index_range){.has_lower = true,
+                                                            .lower = key,
+                                                            .has_upper = true,
+                                                            .upper = key});
+      if (!find_result.success) {
+        warn("Join index %s find error", index.name);
+        return (struct database_select_join_result){.success = false};
+      }
+
+      free(select_join->right_record_ids);
+      select_join->right_record_ids_count = find_result.count;
+      select_join->right_record_ids_position = 0;
+      select_join->right_record_ids = find_result.record_ids;
+      select_join->is_left_row_looked_up = true;
+    }
+
+    if (select_join->has_right_row) {
+      database_row_destroy(select_join->right_row);
+      select_join->has_right_row = false;
+    }
+
+    // Strings are indexed by their prefixes, so the whole values are
+    // compared again
+    while (select_join->right_record_ids_position <
+           select_join->right_record_ids_count) {
+      const struct database_select_row_result result =
+          database_select_row_with_info(
+              database, select_join->right_table,
+              (struct paging_info){
+                  .chain = select_join->right_table.rows_chain,
+                  .record_id =
+                      select_join->right_record_ids
+                          [select_join->right_record_ids_position++]},
+              DATABASE_WHERE_ALWAYS);
+      if (!result.success) {
+        continue;
+      }
+
+      if (database_join_is_satisfied(select_join->left_table,
+                                     select_join->left_row,
+                                     select_join->right_table, result.row,
+                                     select_join->join) &&
+          database_where_joined_is_satisfied(
+              select_join->left_table, select_join->right_table,
+              select_join->left_row, result.row, select_join->where)) {
+        select_join->has_right_row = true;
+        select_join->right_row = result.row;
         return (struct database_select_join_result){
             .success = true,
-            .left_row = left_result.row,
-            .right_row = right_result.row,
-        };
+            .left_row = select_join->left_row,
+            .right_row = result.row};
       }
-
-      right_result = database_select_row_next(
-          database, right_table, DATABASE_WHERE_ALWAYS, right_result.row);
+      database_row_destroy(result.row);
     }
 
-    left_result = database_select_row_next(
-        database, left_table, DATABASE_WHERE_ALWAYS, left_result.row);
+    database_select_join_index_left_next(select_join);
   }
 
   return (struct database_select_join_result){.success = false};
 }
 
-struct database_select_join_result database_select_join_next(
+static struct database_select_join_result
+database_select_join_find(const struct database *database,
+                          struct database_select_join *select_join) {
+  switch (select_join->method) {
+  case DATABASE_SELECT_JOIN_METHOD_HASH:
+    return database_select_join_hash_find(select_join);
+  case DATABASE_SELECT_JOIN_METHOD_MERGE:
+    return database_select_join_merge_find(database, select_join);
+  case DATABASE_SELECT_JOIN_METHOD_INDEX:
+    return database_select_join_index_find(database, select_join);
+  default:
+    return (struct database_select_join_result){.success = false};
+  }
+}
+
+struct database_select_join_result database_select_join_first(
     const struct database *database, struct database_table left_table,
     struct database_table right_table, struct database_join join,
-    struct database_where_joined where, struct database_row previous_left,
-    struct database_row previous_right) {
+    struct database_where_joined where,
+    struct database_select_join **select_join_ret) {
+  *select_join_ret = NULL;
   if (database == NULL) {
     return (struct database_select_join_result){.success = false};
   }
 
-  struct database_select_row_result left_result = {.success = true,
-                                                   .row = previous_left};
-  struct database_select_row_result right_result = database_select_row_next(
-      database, right_table, DATABASE_WHERE_ALWAYS, previous_right);
-  while (left_result.success) {
-    while (right_result.success) {
-      if (database_join_is_satisfied(left_table, left_result.row, right_table,
-                                     right_result.row, join) &&
-          database_where_joined_is_satisfied(left_table, right_table,
-                                             left_result.row, right_result.row,
-                                             where)) {
-        return (struct database_select_join_result){
-            .success = true,
-            .left_row = left_result.row,
-            .right_row = right_result.row,
-        };
-      }
+  // Values of different types are never equal
+  if (database_attributes_get(left_table.attributes,
+                              join.left_attribute_position)
+          .type != database_attributes_get(right_table.attributes,
+                                           join.right_attribute_position)
+                       .type) {
+    return (struct database_select_join_result){.success = false};
+  }
 
-      right_result = database_select_row_next(
-          database, right_table, DATABASE_WHERE_ALWAYS, right_result.row);
-    }
+  struct database_select_join *select_join =
+      malloc(sizeof(struct database_select_join));
+  if (select_join == NULL) {
+    warn("Join allocation error");
+    return (struct database_select_join_result){.success = false};
+  }
+  *select_join =
+      (struct database_select_join){.left_table = left_table,
+                                    .right_table = right_table,
+                                    .join = join,
+                                    .where = where,
+                                    .match_position = DATABASE_JOIN_NO_ROW};
+  *select_join_ret = select_join;
+
+  if (database_select_join_index_choose(select_join)) {
+    select_join->method = DATABASE_SELECT_JOIN_METHOD_INDEX;
+    const struct database_select_row_result result =
+        database_select_row_first(database, left_table, DATABASE_WHERE_ALWAYS);
+    select_join->has_left_row = result.success;
+    select_join->left_row = result.row;
+    return database_select_join_find(database, select_join);
+  }
 
-    // TODO: Think about fix. We can select first row when left result failed
-    right_result =
-        database_select_row_first(database, right_table, DATABASE_WHERE_ALWAYS);
+  if (!database_select_join_build(database, select_join)) {
+    return (struct database_select_join_result){.success = false};
+  }
 
-    left_result = database_select_row_next(
-        database, left_table, DATABASE_WHERE_ALWAYS, left_result.row);
+  if (select_join->method == DATABASE_SELECT_JOIN_METHOD_MERGE) {
+    select_join->has_left_row = database_join_input_read(
+        database, &select_join->inputs[0], &select_join->left_row);
+    database_select_join_right_next(database, select_join);
+  } else {
+    database_select_join_probe_next(select_join);
   }
+  return database_select_join_find(database, select_join);
+}
 
-  // TODO: Think about fix. We can select first row when left result failed
-  if (right_result.success) {
-    database_row_destroy(right_result.row);
+struct database_select_join_result
+database_select_join_next(const struct database *database,
+                          struct database_select_join *select_join) {
+  if (database == NULL || select_join == NULL) {
+    return (struct database_select_join_result){.success = false};
   }
 
-  return (struct database_select_join_result){.success = false};
+  return database_select_join_find(database, select_join);
+}
+
+void database_select_join_destroy(struct database_select_join *select_join) {
+  if (select_join == NULL) {
+    return;
+  }
+
+  if (select_join->has_probe_row) {
+    database_row_destroy(select_join->probe_row);
+  }
+  for (size_t i = select_join->read_rows_position;
+       i < select_join->read_rows_count; i++) {
+    database_row_destroy(select_join->read_rows[i]);
+  }
+  free(select_join->read_rows);
+  database_join_hash_table_destroy(select_join->built_rows);
+
+  if (select_join->has_left_row) {
+    database_row_destroy(select_join->left_row);
+  }
+  if (select_join->has_right_row) {
+    database_row_destroy(select_join->right_row);
+  }
+  database_rows_destroy(select_join->group_rows,
+                        select_join->group_rows_count);
+  free(select_join->right_record_ids);
+  database_join_input_close(select_join->inputs[0]);
+  database_join_input_close(select_join->inputs[1]);
+  free(select_join);
+}
+
+struct database_remove_row_result
+database_remove_row(const struct database *database,
+                    struct database_table table, struct database_row row) {
+  const struct database_remove_row_result result =
+      database_remove_row_with_info(database, table, row.paging_info);
+  if (result.success) {
+    database_row_destroy(row);
+  }
+  return result;
 }
 
 struct database_remove_row_result
-database_remove_row(const struct database *database, struct database_row row) {
+database_remove_row_with_info(const struct database *database,
+                              struct database_table table,
+                              struct paging_info info) {
   if (database == NULL) {
     return (struct database_remove_row_result){.success = false};
   }
 
+  struct paging_blob *blobs;
+  size_t blobs_count;
+  if (!database_row_blobs_fetch(table, info, &blobs, &blobs_count)) {
+    return (struct database_remove_row_result){.success = false};
+  }
+
+  struct database_index_key *keys;
+  if (!database_row_index_keys_fetch(database, table, info, &keys)) {
+    free(blobs);
+    return (struct database_remove_row_result){.success = false};
+  }
+
   const struct paging_remove_result result =
-      paging_remove(database->pager, row.paging_info);
+      paging_remove(table.pager, info);
   if (!result.success) {
     warn("Remove row from pager error");
+    free(blobs);
+    free(keys);
     return (struct database_remove_row_result){.success = false};
   }
 
-  database_row_destroy(row);
-  return (struct database_remove_row_result){.success = true};
-}
\ No newline at end of file
+  const bool indexes_success =
+      database_row_indexes_remove(table, keys, info.record_id);
+  free(keys);
+  return (struct database_remove_row_result){
+      .success =
+          database_blobs_remove(table, blobs, blobs_count) && indexes_success};
+}
+
+// Adds the rows of the table to the index
+static bool database_index_fill(struct database_table table,
+                                struct database_index index) {
+  void *data = NULL;
+  struct paging_read_result read_result =
+      paging_read_first(table.pager, table.rows_chain, &data);
+  while (read_result.success) {
+    const struct database_select_row_result select_result =
+        database_row_values_from_file_data(table, DATABASE_WHERE_ALWAYS,
+                                           read_result, data);
+    if (!select_result.success) {
+      if (read_result.is_data_owned) {
+        free(data);
+      }
+      return false;
+    }
+
+    const struct database_index_key key =
+        database_row_index_key(index, select_result.row.values);
+    database_row_destroy(select_result.row);
+    if (!database_index_insert(table.pager, index, key,
+                               read_result.info.record_id)) {
+      return false;
+    }
+
+    read_result = paging_read_next(table.pager, read_result.info, &data);
+  }
+
+  return true;
+}
+
+// Writes the table record again with the indexes, the record keeps its
+// paging info
+static bool database_table_record_update(struct database *database,
+                                         struct database_table table,
+                                         const struct database_index *indexes,
+                                         size_t indexes_count) {
+  size_t data_size;
+  void *data = database_table_data_make(
+      table.name, table.attributes, table.rows_chain,
+      database_tablespace_number(database, table.pager), indexes,
+      indexes_count, &data_size);
+  if (data == NULL) {
+    return false;
+  }
+
+  const struct paging_update_result update_result =
+      paging_update(database->pager, table.page_info, data, data_size);
+  free(data);
+  if (!update_result.success) {
+    warn("Table record update error");
+    return false;
+  }
+  return true;
+}
+
+// Builds the indexes again in new chains, which take free pages before the
+// old ones, and writes the table record with their roots. The old chains
+// are freed last, so pages at the end of the file can be truncated. A table
+// in a tablespace commits its record first, as a dropped index does.
+static bool database_table_indexes_rebuild(struct database *database,
+                                           struct database_table table) {
+  if (table.indexes_count == 0) {
+    return true;
+  }
+
+  struct database_index *indexes =
+      malloc(table.indexes_count * sizeof(struct database_index));
+  if (indexes == NULL) {
+    warn("Indexes allocation error");
+    return false;
+  }
+
+  size_t indexes_count = 0;
+  bool success = true;
+  while (success && indexes_count < table.indexes_count) {
+    struct database_index index =
+        database_table_index_get(table, indexes_count);
+    const struct database_index_create_result create_result =
+        database_index_create(table.pager, index.method);
+    success = create_result.success;
+    if (success) {
+      index.chain = create_result.chain;
+      index.root_record_id = create_result.root_record_id;
+      indexes[indexes_count++] = index;
+      success = database_index_fill(table, index);
+    }
+    if (!success) {
+      warn("Index %s rebuild error", index.name);
+    }
+  }
+
+  const bool is_updated =
+      success && database_table_record_update(database, table, indexes,
+                                              indexes_count);
+  const bool is_in_tablespace = table.pager != database->pager;
+  success = is_updated &&
+            (!is_in_tablespace || paging_commit(database->pager).success);
+  for (size_t i = 0; i < indexes_count; i++) {
+    if (success) {
+      paging_chain_remove(table.pager,
+                          database_table_index_get(table, i).chain);
+    } else if (!is_updated) {
+      paging_chain_remove(table.pager, indexes[i].chain);
+    }
+  }
+  free(indexes);
+  return success;
+}
+
+// Finds the table with the index and the position of the index in it
+static const struct database_table *
+database_index_table_find(const struct database *database,
+                          const char *index_name, size_t *index_position) {
+  for (size_t i = 0; i < database_catalog_count(database->catalog); i++) {
+    const struct database_table *table =
+        database_catalog_get(database->catalog, i);
+    for (size_t j = 0; j < table->indexes_count; j++) {
+      if (strcmp(database_table_index_get(*table, j).name, index_name) == 0) {
+        *index_position = j;
+        return table;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+struct database_create_index_result
+database_create_index(struct database *database, struct database_table table,
+                      const char *index_name, size_t attribute_position,
+                      enum database_index_method method) {
+  if (database == NULL || attribute_position >= table.attributes.count) {
+    return (struct database_create_index_result){.success = false};
+  }
+
+  size_t index_position;
+  if (database_index_table_find(database, index_name, &index_position) !=
+      NULL) {
+    warn("Index %s already exists", index_name);
+    return (struct database_create_index_result){.success = false};
+  }
+
+  const struct database_index_create_result create_result =
+      database_index_create(table.pager, method);
+  if (!create_result.success) {
+    return (struct database_create_index_result){.success = false};
+  }
+
+  struct database_index *indexes =
+      malloc((table.indexes_count + 1) * sizeof(struct database_index));
+  if (indexes == NULL) {
+    warn("Indexes allocation error");
+    paging_chain_remove(table.pager, create_result.chain);
+    return (struct database_create_index_result){.success = false};
+  }
+
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    indexes[i] = database_table_index_get(table, i);
+  }
+  indexes[table.indexes_count] = (struct database_index){
+      .name = index_name,
+      .attribute_position = attribute_position,
+      .type = database_attributes_get(table.attributes, attribute_position)
+                  .type,
+      .method = method,
+      .chain = create_result.chain,
+      .root_record_id = create_result.root_record_id};
+
+  const bool success =
+      database_index_fill(table, indexes[table.indexes_count]) &&
+      database_table_record_update(database, table, indexes,
+                                   table.indexes_count + 1);
+  free(indexes);
+  if (!success) {
+    warn("Index %s creation error", index_name);
+    paging_chain_remove(table.pager, create_result.chain);
+    return (struct database_create_index_result){.success = false};
+  }
+
+  // The table is read again with its new index
+  if (!database_catalog_load(database)) {
+    warn("Catalog load error");
+    return (struct database_create_index_result){.success = false};
+  }
+  return (struct database_create_index_result){.success = true};
+}
+
+struct database_drop_index_result
+database_drop_index(struct database *database, const char *index_name) {
+  if (database == NULL) {
+    return (struct database_drop_index_result){.success = false};
+  }
+
+  size_t index_position;
+  const struct database_table *found_table =
+      database_index_table_find(database, index_name, &index_position);
+  if (found_table == NULL) {
+    warn("Index %s not found", index_name);
+    return (struct database_drop_index_result){.success = false};
+  }
+  if (found_table->pager == NULL) {
+    warn("Tablespace of table %s is not added", found_table->name);
+    return (struct database_drop_index_result){.success = false};
+  }
+
+  const struct database_table table = *found_table;
+  const struct database_index index =
+      database_table_index_get(table, index_position);
+  if (index.constraint != DATABASE_INDEX_CONSTRAINT_NONE) {
+    warn("Index %s keeps a key constraint of table %s", index_name,
+         table.name);
+    return (struct database_drop_index_result){.success = false};
+  }
+
+  struct database_index *indexes =
+      malloc(table.indexes_count * sizeof(struct database_index));
+  if (indexes == NULL) {
+    warn("Indexes allocation error");
+    return (struct database_drop_index_result){.success = false};
+  }
+
+  size_t indexes_count = 0;
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    if (i != index_position) {
+      indexes[indexes_count++] = database_table_index_get(table, i);
+    }
+  }
+
+  // The table stops referring to the index before its nodes are freed, and
+  // a table in a tablespace commits that first, as a dropped table does
+  const bool is_in_tablespace = table.pager != database->pager;
+  bool success =
+      database_table_record_update(database, table, indexes, indexes_count) &&
+      (!is_in_tablespace || paging_commit(database->pager).success);
+  free(indexes);
+  if (success && !paging_chain_remove(table.pager, index.chain).success) {
+    warn("Index chain removing error");
+    success = false;
+  }
+
+  // The table is read again without the index
+  if (!database_catalog_load(database)) {
+    warn("Catalog load error");
+    return (struct database_drop_index_result){.success = false};
+  }
+  return (struct database_drop_index_result){.success = success};
+}
+
+// An index that the condition bounds to one key is preferred to ranges, and
+// a hash table finds one key in fewer page reads than a tree
+static int database_index_lookup_rank(struct database_index index,
+                                      struct database_index_range range) {
+  if (!database_index_range_is_point(range)) {
+    return 0;
+  }
+  return index.method == DATABASE_INDEX_METHOD_HASH ? 2 : 1;
+}
+
+struct database_select_infos_result
+database_select_row_infos_with_index(const struct database *database,
+                                     struct database_table table,
+                                     struct database_where where) {
+  if (database == NULL) {
+    return (struct database_select_infos_result){.success = false};
+  }
+
+  bool is_index_found = false;
+  struct database_index index;
+  struct database_index_range range;
+  for (size_t i = 0; i < table.indexes_count; i++) {
+    const struct database_index candidate = database_table_index_get(table, i);
+    struct database_index_range candidate_range;
+    if (!database_index_range_from_where(candidate, where, &candidate_range)) {
+      continue;
+    }
+
+    if (!is_index_found ||
+        database_index_lookup_rank(candidate, candidate_range) >
+            database_index_lookup_rank(index, range)) {
+      is_index_found = true;
+      index = candidate;
+      range = candidate_range;
+    }
+  }
+
+  if (!is_index_found) {
+    return (struct database_select_infos_result){.success = true,
+                                                 .is_index_used = false};
+  }
+
+  const struct database_index_find_result find_result =
+      database_index_find(table.pager, index, range);
+  if (!find_result.success) {
+    return (struct database_select_infos_result){.success = false};
+  }
+
+  struct paging_info *infos =
+      malloc(find_result.count * sizeof(struct paging_info));
+  if (infos == NULL && find_result.count > 0) {
+    warn("Alloc infos error");
+    free(find_result.record_ids);
+    return (struct database_select_infos_result){.success = false};
+  }
+
+  for (size_t i = 0; i < find_result.count; i++) {
+    infos[i] = (struct paging_info){.chain = table.rows_chain,
+                                    .record_id = find_result.record_ids[i]};
+  }
+  free(find_result.record_ids);
+
+  return (struct database_select_infos_result){.success = true,
+                                               .is_index_used = true,
+                                               .infos = infos,
+                                               .count = find_result.count};
+}
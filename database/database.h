@@ -2,6 +2,7 @@
 #define ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_H
 
 #include "database_create_table_request.h"
+#include "database_index.h"
 #include "database_insert_row_request.h"
 #include "database_join.h"
 #include "database_row.h"
@@ -25,8 +26,15 @@ struct database_drop_table_result {
   bool success;
 };
 
+// A row that breaks a key constraint is not written
 struct database_insert_row_result {
   bool success;
+  bool is_constraint_violated;
+};
+
+struct database_update_rows_result {
+  bool success;
+  bool is_constraint_violated;
 };
 
 struct database_select_row_result {
@@ -36,6 +44,8 @@ struct database_select_row_result {
 
 struct database_select_join_result {
   bool success;
+  // The rows are owned by the join and stay valid until the next pair is
+  // selected
   struct database_row left_row;
   struct database_row right_row;
 };
@@ -44,25 +54,109 @@ struct database_remove_row_result {
   bool success;
 };
 
-struct database *database_init(FILE *file);
-struct database *database_create_and_init(FILE *file);
+struct database_commit_result {
+  bool success;
+};
+
+struct database_vacuum_result {
+  bool success;
+};
+
+struct database_add_tablespace_result {
+  bool success;
+  uint64_t tablespace_number;
+};
+
+struct database_create_index_result {
+  bool success;
+};
+
+struct database_drop_index_result {
+  bool success;
+};
+
+struct database_select_infos_result {
+  bool success;
+  bool is_index_used;
+  struct paging_info *infos;
+  size_t count;
+};
+
+struct database *database_init(FILE *file, struct paging_options options);
+struct database *database_create_and_init(FILE *file,
+                                          struct paging_options options);
 
 void database_destroy(struct database *database);
 
+// Adds a data file for new tables, which are spread over the added files
+// while the main file keeps the tables list. An empty file is initialized.
+// Files must be added in the same order every time the database is opened,
+// tables of a file that is not added can not be used.
+struct database_add_tablespace_result
+database_add_tablespace(struct database *database, FILE *file,
+                        struct paging_options options);
+
+// Called after every statement, makes its changes durable. Vacuums the file
+// when most of it is free, so no tables, rows or paging info may be kept
+// across a commit.
+struct database_commit_result database_commit(struct database *database);
+
+// Moves rows and their strings to the start of the file, builds indexes
+// again in new chains and truncates the free pages at its end. Paging info
+// of tables and rows changes.
+struct database_vacuum_result database_vacuum(struct database *database);
+
+// Fails when a table with the name exists
 struct database_create_table_result
 database_create_table(struct database *database,
                       struct database_create_table_request request);
 
+// Looks the table up in memory without reading the file. The table borrows
+// its data from the database until it is dropped or the file is vacuumed.
 struct database_get_table_result
 database_get_table_with_name(const struct database *database, const char *name);
 
 struct database_drop_table_result
 database_drop_table(struct database *database, struct database_table table);
 
+// Indexes the attribute of the table with a B+tree or a hash table that row
+// changes keep up to date. Index names are unique in the database. The table
+// is read again with the index, so the given table must not be used after
+// the call.
+struct database_create_index_result
+database_create_index(struct database *database, struct database_table table,
+                      const char *index_name, size_t attribute_position,
+                      enum database_index_method method);
+
+// Finds the table of the index by the index name. Indexes of key
+// constraints are dropped only with their tables. No tables may be kept
+// across the call.
+struct database_drop_index_result
+database_drop_index(struct database *database, const char *index_name);
+
+// Looks the rows that may satisfy the condition up in an index of the table
+// when the condition bounds an indexed attribute, and is_index_used tells
+// whether it did. The rows found still have to be checked against the
+// condition. The caller frees the paging info.
+struct database_select_infos_result
+database_select_row_infos_with_index(const struct database *database,
+                                     struct database_table table,
+                                     struct database_where where);
+
 struct database_insert_row_result
 database_insert_row(struct database *database, struct database_table table,
                     struct database_insert_row_request request);
 
+// Replaces the values of the rows, the rows keep their paging infos. The key
+// constraints are checked and the records of all rows are made before any
+// of them is written, and the rows written before a failure get their old
+// records back.
+struct database_update_rows_result
+database_update_rows(struct database *database, struct database_table table,
+                     const struct paging_info *infos,
+                     const struct database_attribute_values *values,
+                     size_t count);
+
 struct database_select_row_result
 database_select_row_first(const struct database *database,
                           struct database_table table,
@@ -71,17 +165,42 @@ struct database_select_row_result database_select_row_next(
     const struct database *database, struct database_table table,
     struct database_where where, struct database_row previous);
 
+// Reads the row with the given paging info without scanning the table.
+// Fails when the row does not satisfy the condition.
+struct database_select_row_result
+database_select_row_with_info(const struct database *database,
+                              struct database_table table,
+                              struct paging_info info,
+                              struct database_where where);
+
+// Pairs of rows of two tables with equal values of the join attributes
+struct database_select_join;
+
+// When the join attribute of the right table is indexed, the index is
+// looked up with the value of every left row. Otherwise the rows of the
+// table with fewer rows are put into a hash table in memory when they fit,
+// and the rows of the other table are looked up in it, so each table is
+// read once. When neither table fits, both are read in the order of their
+// join attributes, by a B+tree index or by an external sort that writes
+// runs to temporary chains, and merged. The join is returned even when no
+// pair is found and must be destroyed.
 struct database_select_join_result database_select_join_first(
     const struct database *database, struct database_table left_table,
     struct database_table right_table, struct database_join join,
-    struct database_where_joined where);
-struct database_select_join_result database_select_join_next(
-    const struct database *database, struct database_table left_table,
-    struct database_table right_table, struct database_join join,
-    struct database_where_joined where, struct database_row previous_left,
-    struct database_row previous_right);
+    struct database_where_joined where,
+    struct database_select_join **select_join);
+struct database_select_join_result
+database_select_join_next(const struct database *database,
+                          struct database_select_join *select_join);
+
+void database_select_join_destroy(struct database_select_join *select_join);
 
 struct database_remove_row_result
-database_remove_row(const struct database *database, struct database_row row);
+database_remove_row(const struct database *database,
+                    struct database_table table, struct database_row row);
+struct database_remove_row_result
+database_remove_row_with_info(const struct database *database,
+                              struct database_table table,
+                              struct paging_info info);
 
 #endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_H
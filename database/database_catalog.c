@@ -0,0 +1,187 @@
+#include "database_catalog.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DATABASE_CATALOG_NO_TABLE SIZE_MAX
+
+struct database_catalog_entry {
+  struct database_table table;
+  size_t hash;
+  size_t hash_next;
+};
+
+// Entries are kept dense, removing an entry moves the last one into its
+// place
+struct database_catalog {
+  size_t count;
+  size_t capacity;
+  struct database_catalog_entry *entries;
+  size_t buckets_count;
+  size_t *buckets;
+};
+
+struct database_catalog *database_catalog_create(void) {
+  struct database_catalog *catalog = malloc(sizeof(struct database_catalog));
+  if (catalog == NULL) {
+    return NULL;
+  }
+
+  catalog->count = 0;
+  catalog->capacity = 0;
+  catalog->entries = NULL;
+  catalog->buckets_count = 0;
+  catalog->buckets = NULL;
+  return catalog;
+}
+
+void database_catalog_destroy(struct database_catalog *catalog) {
+  if (catalog == NULL) {
+    return;
+  }
+
+  database_catalog_clear(catalog);
+  free(catalog->entries);
+  free(catalog->buckets);
+  free(catalog);
+}
+
+static size_t database_catalog_bucket(const struct database_catalog *catalog,
+                                      size_t hash) {
+  return hash & (catalog->buckets_count - 1);
+}
+
+static void database_catalog_hash_insert(struct database_catalog *catalog,
+                                         size_t entry_index) {
+  const size_t bucket =
+      database_catalog_bucket(catalog, catalog->entries[entry_index].hash);
+  catalog->entries[entry_index].hash_next = catalog->buckets[bucket];
+  catalog->buckets[bucket] = entry_index;
+}
+
+static void database_catalog_hash_remove(struct database_catalog *catalog,
+                                         size_t entry_index) {
+  size_t *link = &catalog->buckets[database_catalog_bucket(
+      catalog, catalog->entries[entry_index].hash)];
+  while (*link != entry_index) {
+    link = &catalog->entries[*link].hash_next;
+  }
+  *link = catalog->entries[entry_index].hash_next;
+}
+
+static size_t
+database_catalog_find_index(const struct database_catalog *catalog,
+                            const char *name) {
+  if (catalog->count == 0) {
+    return DATABASE_CATALOG_NO_TABLE;
+  }
+
+  const size_t hash = database_table_name_hash(name);
+  size_t entry_index = catalog->buckets[database_catalog_bucket(catalog, hash)];
+  while (entry_index != DATABASE_CATALOG_NO_TABLE) {
+    const struct database_catalog_entry *entry = &catalog->entries[entry_index];
+    if (entry->hash == hash && strcmp(entry->table.name, name) == 0) {
+      return entry_index;
+    }
+    entry_index = entry->hash_next;
+  }
+  return DATABASE_CATALOG_NO_TABLE;
+}
+
+static bool database_catalog_grow(struct database_catalog *catalog) {
+  const size_t capacity = catalog->capacity == 0 ? 16 : catalog->capacity * 2;
+  struct database_catalog_entry *entries = realloc(
+      catalog->entries, capacity * sizeof(struct database_catalog_entry));
+  if (entries == NULL) {
+    return false;
+  }
+  catalog->entries = entries;
+  catalog->capacity = capacity;
+
+  const size_t buckets_count = capacity * 2;
+  size_t *buckets = malloc(buckets_count * sizeof(size_t));
+  if (buckets == NULL) {
+    return false;
+  }
+  free(catalog->buckets);
+  catalog->buckets = buckets;
+  catalog->buckets_count = buckets_count;
+
+  for (size_t i = 0; i < buckets_count; i++) {
+    buckets[i] = DATABASE_CATALOG_NO_TABLE;
+  }
+  for (size_t i = 0; i < catalog->count; i++) {
+    database_catalog_hash_insert(catalog, i);
+  }
+  return true;
+}
+
+bool database_catalog_insert(struct database_catalog *catalog,
+                             struct database_table table) {
+  assert(table.is_data_owned);
+  assert(database_catalog_find_index(catalog, table.name) ==
+         DATABASE_CATALOG_NO_TABLE);
+
+  if (catalog->count == catalog->capacity && !database_catalog_grow(catalog)) {
+    return false;
+  }
+  if (!database_table_attribute_map_build(&table)) {
+    return false;
+  }
+
+  catalog->entries[catalog->count] = (struct database_catalog_entry){
+      .table = table, .hash = database_table_name_hash(table.name)};
+  database_catalog_hash_insert(catalog, catalog->count);
+  catalog->count++;
+  return true;
+}
+
+const struct database_table *
+database_catalog_find(const struct database_catalog *catalog,
+                      const char *name) {
+  const size_t entry_index = database_catalog_find_index(catalog, name);
+  if (entry_index == DATABASE_CATALOG_NO_TABLE) {
+    return NULL;
+  }
+  return &catalog->entries[entry_index].table;
+}
+
+void database_catalog_remove(struct database_catalog *catalog,
+                             const char *name) {
+  const size_t entry_index = database_catalog_find_index(catalog, name);
+  if (entry_index == DATABASE_CATALOG_NO_TABLE) {
+    return;
+  }
+
+  database_catalog_hash_remove(catalog, entry_index);
+  database_table_destroy(catalog->entries[entry_index].table);
+
+  const size_t last_index = catalog->count - 1;
+  if (entry_index != last_index) {
+    database_catalog_hash_remove(catalog, last_index);
+    catalog->entries[entry_index] = catalog->entries[last_index];
+    database_catalog_hash_insert(catalog, entry_index);
+  }
+  catalog->count--;
+}
+
+void database_catalog_clear(struct database_catalog *catalog) {
+  for (size_t i = 0; i < catalog->count; i++) {
+    database_table_destroy(catalog->entries[i].table);
+  }
+  for (size_t i = 0; i < catalog->buckets_count; i++) {
+    catalog->buckets[i] = DATABASE_CATALOG_NO_TABLE;
+  }
+  catalog->count = 0;
+}
+
+size_t database_catalog_count(const struct database_catalog *catalog) {
+  return catalog->count;
+}
+
+const struct database_table *
+database_catalog_get(const struct database_catalog *catalog, size_t position) {
+  assert(position < catalog->count);
+  return &catalog->entries[position].table;
+}
@@ -0,0 +1,37 @@
+#ifndef ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_CATALOG_H
+#define ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_CATALOG_H
+
+#include "database_table.h"
+
+// Tables of the database by name, kept in memory so that statements find
+// their tables without reading the tables list from the file
+struct database_catalog;
+
+struct database_catalog *database_catalog_create(void);
+
+void database_catalog_destroy(struct database_catalog *catalog);
+
+// Takes the table, which must own its data. The attribute map of the table
+// is built here.
+bool database_catalog_insert(struct database_catalog *catalog,
+                             struct database_table table);
+
+// Returns NULL when there is no table with the name. The table stays valid
+// until it is removed.
+const struct database_table *
+database_catalog_find(const struct database_catalog *catalog,
+                      const char *name);
+
+void database_catalog_remove(struct database_catalog *catalog,
+                             const char *name);
+
+void database_catalog_clear(struct database_catalog *catalog);
+
+size_t database_catalog_count(const struct database_catalog *catalog);
+
+// Tables are numbered from 0 to count - 1. Inserting and removing tables
+// changes their numbers.
+const struct database_table *
+database_catalog_get(const struct database_catalog *catalog, size_t position);
+
+#endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_CATALOG_H
@@ -1,6 +1,7 @@
 #include "database_create_table_request.h"
 #include "database_attribute.h"
 #include "database_attributes.h"
+#include <assert.h>
 #include <stdlib.h>
 
 struct database_create_table_request
@@ -8,13 +9,16 @@ database_create_table_request_create(const char *table_name,
                                      size_t attributes_count) {
   struct database_attributes attributes =
       database_attributes_create(attributes_count);
-  return (struct database_create_table_request){.name = table_name,
-                                                .attributes = attributes};
+  enum database_index_constraint *constraints =
+      calloc(attributes_count, sizeof(enum database_index_constraint));
+  return (struct database_create_table_request){
+      .name = table_name, .attributes = attributes, .constraints = constraints};
 }
 
 void database_create_table_request_destroy(
     struct database_create_table_request request) {
   database_attributes_destroy(request.attributes);
+  free(request.constraints);
 }
 
 struct database_attribute database_create_table_request_get_attribute(
@@ -27,3 +31,16 @@ void database_create_table_request_set_attribute(
     struct database_attribute attribute) {
   database_attributes_set(request.attributes, position, attribute);
 }
+
+enum database_index_constraint database_create_table_request_get_constraint(
+    struct database_create_table_request request, size_t position) {
+  assert(position < request.attributes.count);
+  return request.constraints[position];
+}
+
+void database_create_table_request_set_constraint(
+    struct database_create_table_request request, size_t position,
+    enum database_index_constraint constraint) {
+  assert(position < request.attributes.count);
+  request.constraints[position] = constraint;
+}
@@ -5,10 +5,13 @@
 
 #include "database_attribute.h"
 #include "database_attributes.h"
+#include "database_index.h"
 
+// Attributes with key constraints are indexed when the table is created
 struct database_create_table_request {
   const char *name;
   struct database_attributes attributes;
+  enum database_index_constraint *constraints;
 };
 
 struct database_create_table_request
@@ -25,4 +28,11 @@ void database_create_table_request_set_attribute(
     struct database_create_table_request request, size_t position,
     struct database_attribute attribute);
 
+enum database_index_constraint database_create_table_request_get_constraint(
+    struct database_create_table_request request, size_t position);
+
+void database_create_table_request_set_constraint(
+    struct database_create_table_request request, size_t position,
+    enum database_index_constraint constraint);
+
 #endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_CREATE_TABLE_REQUEST_H
@@ -0,0 +1,810 @@
+#include "database_index.h"
+#include "database_index_hash.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Record ids are stored big endian after the keys, so that entries with
+// equal keys are ordered by their rows and compare with memcmp as a whole
+#define DATABASE_INDEX_RECORD_ID_SIZE 10
+
+#define DATABASE_INDEX_ENTRY_SIZE_MAX                                          \
+  (DATABASE_INDEX_STRING_KEY_SIZE + 2 * DATABASE_INDEX_RECORD_ID_SIZE)
+
+#define DATABASE_INDEX_SIGN_BIT (UINT64_C(1) << 63)
+
+#define DATABASE_INDEX_NO_NODE UINT64_MAX
+
+// Leaf entries are keys with the record ids of their rows. Entries of inner
+// nodes are the first leaf entries of their children followed by the record
+// ids of the children.
+struct database_index_file_node_header {
+  uint64_t is_leaf;
+  uint64_t entries_count;
+  // Leaves link the next leaf, inner nodes the child for the entries less
+  // than their first entry
+  uint64_t link_page_number;
+  uint64_t link_slot_number;
+};
+
+struct database_index_tree {
+  struct paging_chain chain;
+  size_t key_size;
+  size_t node_size;
+};
+
+struct database_index_split {
+  bool is_split;
+  // The leaf entry that the new right node starts with
+  unsigned char entry[DATABASE_INDEX_ENTRY_SIZE_MAX];
+  struct paging_record_id right_record_id;
+};
+
+size_t database_index_key_size(enum database_attribute_type type) {
+  switch (type) {
+  case DATABASE_ATTRIBUTE_INTEGER:
+  case DATABASE_ATTRIBUTE_FLOATING_POINT:
+    return sizeof(uint64_t);
+  case DATABASE_ATTRIBUTE_BOOLEAN:
+    return 1;
+  case DATABASE_ATTRIBUTE_STRING:
+    return DATABASE_INDEX_STRING_KEY_SIZE;
+  }
+  return 0;
+}
+
+static void database_index_uint64_encode(uint64_t value,
+                                         unsigned char *bytes) {
+  for (size_t i = 0; i < sizeof(uint64_t); i++) {
+    bytes[i] = (unsigned char)(value >> (56 - 8 * i));
+  }
+}
+
+static uint64_t database_index_uint64_decode(const unsigned char *bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(uint64_t); i++) {
+    value = value << 8 | bytes[i];
+  }
+  return value;
+}
+
+static void database_index_record_id_encode(struct paging_record_id record_id,
+                                            unsigned char *bytes) {
+  database_index_uint64_encode(record_id.page_number, bytes);
+  bytes[8] = (unsigned char)(record_id.slot_number >> 8);
+  bytes[9] = (unsigned char)(record_id.slot_number & 0xFF);
+}
+
+static struct paging_record_id
+database_index_record_id_decode(const unsigned char *bytes) {
+  return (struct paging_record_id){
+      .page_number = database_index_uint64_decode(bytes),
+      .slot_number = (uint16_t)(bytes[8] << 8 | bytes[9])};
+}
+
+struct database_index_key
+database_index_key_make(enum database_attribute_type type,
+                        union database_attribute_value value) {
+  struct database_index_key key = {.size = database_index_key_size(type)};
+  switch (type) {
+  case DATABASE_ATTRIBUTE_INTEGER: {
+    database_index_uint64_encode((uint64_t)value.integer ^
+                                     DATABASE_INDEX_SIGN_BIT,
+                                 key.bytes);
+  } break;
+  case DATABASE_ATTRIBUTE_FLOATING_POINT: {
+    // Negative zero equals zero, so they share a key
+    const double number =
+        value.floating_point == 0 ? 0.0 : value.floating_point;
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    bits = (bits & DATABASE_INDEX_SIGN_BIT) != 0
+               ? ~bits
+               : bits ^ DATABASE_INDEX_SIGN_BIT;
+    database_index_uint64_encode(bits, key.bytes);
+  } break;
+  case DATABASE_ATTRIBUTE_BOOLEAN: {
+    key.bytes[0] = value.boolean ? 1 : 0;
+  } break;
+  case DATABASE_ATTRIBUTE_STRING: {
+    strncpy((char *)key.bytes, value.string, DATABASE_INDEX_STRING_KEY_SIZE);
+  } break;
+  }
+  return key;
+}
+
+static int database_index_key_compare(struct database_index_key left,
+                                      struct database_index_key right) {
+  return memcmp(left.bytes, right.bytes, left.size);
+}
+
+static enum database_where_comparison_operator database_index_operator_flip(
+    enum database_where_comparison_operator comparison_operator) {
+  switch (comparison_operator) {
+  case DATABASE_WHERE_COMPARISON_OPERATOR_GREATER:
+    return DATABASE_WHERE_COMPARISON_OPERATOR_LESS;
+  case DATABASE_WHERE_COMPARISON_OPERATOR_GREATER_OR_EQUAL:
+    return DATABASE_WHERE_COMPARISON_OPERATOR_LESS_OR_EQUAL;
+  case DATABASE_WHERE_COMPARISON_OPERATOR_LESS:
+    return DATABASE_WHERE_COMPARISON_OPERATOR_GREATER;
+  case DATABASE_WHERE_COMPARISON_OPERATOR_LESS_OR_EQUAL:
+    return DATABASE_WHERE_COMPARISON_OPERATOR_GREATER_OR_EQUAL;
+  default:
+    return comparison_operator;
+  }
+}
+
+static bool database_index_item_is_attribute(
+    struct database_index index, struct database_where_comparison_item item) {
+  return item.type == DATABASE_WHERE_COMPARISON_ITEM_ATTRIBUTE &&
+         item.value.attribute.attribute_position == index.attribute_position;
+}
+
+// Strict comparisons get inclusive bounds, rows on the bounds are filtered
+// out by the condition itself
+static bool database_index_range_from_comparison(
+    struct database_index index, struct database_where_comparison comparison,
+    struct database_index_range *range) {
+  enum database_where_comparison_operator comparison_operator =
+      comparison.operator;
+  struct database_where_comparison_item constant;
+  if (database_index_item_is_attribute(index, comparison.left) &&
+      comparison.right.type == DATABASE_WHERE_COMPARISON_ITEM_CONSTANT) {
+    constant = comparison.right;
+  } else if (database_index_item_is_attribute(index, comparison.right) &&
+             comparison.left.type == DATABASE_WHERE_COMPARISON_ITEM_CONSTANT) {
+    constant = comparison.left;
+    comparison_operator = database_index_operator_flip(comparison_operator);
+  } else {
+    return false;
+  }
+
+  if (constant.data_type != index.type) {
+    return false;
+  }
+
+  const struct database_index_key key =
+      database_index_key_make(index.type, constant.value.constant.value);
+  *range = (struct database_index_range){.lower = key, .upper = key};
+  switch (comparison_operator) {
+  case DATABASE_WHERE_COMPARISON_OPERATOR_EQUAL:
+    range->has_lower = true;
+    range->has_upper = true;
+    return true;
+  case DATABASE_WHERE_COMPARISON_OPERATOR_GREATER:
+  case DATABASE_WHERE_COMPARISON_OPERATOR_GREATER_OR_EQUAL:
+    range->has_lower = true;
+    return true;
+  case DATABASE_WHERE_COMPARISON_OPERATOR_LESS:
+  case DATABASE_WHERE_COMPARISON_OPERATOR_LESS_OR_EQUAL:
+    range->has_upper = true;
+    return true;
+  case DATABASE_WHERE_COMPARISON_OPERATOR_NOT_EQUAL:
+    return false;
+  }
+  return false;
+}
+
+static struct database_index_range
+database_index_range_intersect(struct database_index_range left,
+                               struct database_index_range right) {
+  struct database_index_range range = left;
+  if (right.has_lower &&
+      (!left.has_lower ||
+       database_index_key_compare(right.lower, left.lower) > 0)) {
+    range.has_lower = true;
+    range.lower = right.lower;
+  }
+  if (right.has_upper &&
+      (!left.has_upper ||
+       database_index_key_compare(right.upper, left.upper) < 0)) {
+    range.has_upper = true;
+    range.upper = right.upper;
+  }
+  return range;
+}
+
+static struct database_index_range
+database_index_range_unite(struct database_index_range left,
+                           struct database_index_range right) {
+  struct database_index_range range = left;
+  range.has_lower = left.has_lower && right.has_lower;
+  if (range.has_lower &&
+      database_index_key_compare(right.lower, left.lower) < 0) {
+    range.lower = right.lower;
+  }
+  range.has_upper = left.has_upper && right.has_upper;
+  if (range.has_upper &&
+      database_index_key_compare(right.upper, left.upper) > 0) {
+    range.upper = right.upper;
+  }
+  return range;
+}
+
+static bool
+database_index_bounds_from_where(struct database_index index,
+                                 struct database_where where,
+                                 struct database_index_range *range) {
+  switch (where.type) {
+  case DATABASE_WHERE_TYPE_ALWAYS:
+  case DATABASE_WHERE_TYPE_CONTAINS:
+    return false;
+
+  case DATABASE_WHERE_TYPE_COMPARISON:
+    return database_index_range_from_comparison(index, where.value.comparison,
+                                                range);
+
+  case DATABASE_WHERE_TYPE_LOGIC: {
+    struct database_index_range left;
+    struct database_index_range right;
+    const bool has_left = database_index_bounds_from_where(
+        index, *where.value.logic.left, &left);
+    const bool has_right = database_index_bounds_from_where(
+        index, *where.value.logic.right, &right);
+
+    switch (where.value.logic.operator) {
+    case DATABASE_WHERE_LOGIC_OPERATOR_AND:
+      if (has_left && has_right) {
+        *range = database_index_range_intersect(left, right);
+      } else if (has_left || has_right) {
+        *range = has_left ? left : right;
+      }
+      return has_left || has_right;
+
+    case DATABASE_WHERE_LOGIC_OPERATOR_OR:
+      if (!has_left || !has_right) {
+        return false;
+      }
+      *range = database_index_range_unite(left, right);
+      return range->has_lower || range->has_upper;
+    }
+  } break;
+  }
+  return false;
+}
+
+bool database_index_range_is_point(struct database_index_range range) {
+  return range.has_lower && range.has_upper &&
+         database_index_key_compare(range.lower, range.upper) == 0;
+}
+
+bool database_index_range_from_where(struct database_index index,
+                                     struct database_where where,
+                                     struct database_index_range *range) {
+  return database_index_bounds_from_where(index, where, range) &&
+         (index.method != DATABASE_INDEX_METHOD_HASH ||
+          database_index_range_is_point(*range));
+}
+
+static struct database_index_tree
+database_index_tree_make(const struct paging_pager *pager,
+                         struct database_index index) {
+  return (struct database_index_tree){
+      .chain = index.chain,
+      .key_size = database_index_key_size(index.type),
+      .node_size = paging_record_size_max(pager)};
+}
+
+static size_t database_index_entry_size(struct database_index_tree tree,
+                                        bool is_leaf) {
+  return tree.key_size +
+         DATABASE_INDEX_RECORD_ID_SIZE * (is_leaf ? 1 : 2);
+}
+
+static size_t database_index_node_capacity(struct database_index_tree tree,
+                                           bool is_leaf) {
+  return (tree.node_size - sizeof(struct database_index_file_node_header)) /
+         database_index_entry_size(tree, is_leaf);
+}
+
+static struct database_index_file_node_header
+database_index_node_header(const unsigned char *node) {
+  struct database_index_file_node_header header;
+  memcpy(&header, node, sizeof(header));
+  return header;
+}
+
+static unsigned char *
+database_index_node_entry(struct database_index_tree tree, unsigned char *node,
+                          bool is_leaf, size_t position) {
+  return node + sizeof(struct database_index_file_node_header) +
+         position * database_index_entry_size(tree, is_leaf);
+}
+
+static struct paging_record_id database_index_node_child(
+    struct database_index_tree tree, unsigned char *node, size_t position) {
+  if (position == 0) {
+    const struct database_index_file_node_header header =
+        database_index_node_header(node);
+    return (struct paging_record_id){
+        .page_number = header.link_page_number,
+        .slot_number = (uint16_t)header.link_slot_number};
+  }
+
+  return database_index_record_id_decode(
+      database_index_node_entry(tree, node, false, position - 1) +
+      tree.key_size + DATABASE_INDEX_RECORD_ID_SIZE);
+}
+
+// Counts the entries of the node that are less than the leaf entry, or not
+// greater than it when is_equal_counted
+static size_t database_index_node_search(struct database_index_tree tree,
+                                         unsigned char *node,
+                                         const unsigned char *entry,
+                                         bool is_equal_counted) {
+  const struct database_index_file_node_header header =
+      database_index_node_header(node);
+  size_t low = 0;
+  size_t high = header.entries_count;
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+    const int compare_result = memcmp(
+        database_index_node_entry(tree, node, header.is_leaf, middle), entry,
+        tree.key_size + DATABASE_INDEX_RECORD_ID_SIZE);
+    if (compare_result < 0 || (is_equal_counted && compare_result == 0)) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static bool database_index_node_read(const struct paging_pager *pager,
+                                     struct database_index_tree tree,
+                                     struct paging_record_id record_id,
+                                     unsigned char *node) {
+  void *data = NULL;
+  const struct paging_read_result read_result = paging_fetch(
+      pager, (struct paging_info){.chain = tree.chain, .record_id = record_id},
+      &data);
+  if (!read_result.success) {
+    warn("Index node read error");
+    return false;
+  }
+
+  const bool success = read_result.size == tree.node_size;
+  if (success) {
+    memcpy(node, data, tree.node_size);
+  } else {
+    warn("Index node size mismatch");
+  }
+  if (read_result.is_data_owned) {
+    free(data);
+  }
+  return success;
+}
+
+// Clears the space after the entries, so that nodes compress well
+static void database_index_node_tail_clear(struct database_index_tree tree,
+                                           unsigned char *node) {
+  const struct database_index_file_node_header header =
+      database_index_node_header(node);
+  unsigned char *tail = database_index_node_entry(tree, node, header.is_leaf,
+                                                  header.entries_count);
+  memset(tail, 0, tree.node_size - (size_t)(tail - node));
+}
+
+static bool database_index_node_write(struct paging_pager *pager,
+                                      struct database_index_tree tree,
+                                      unsigned char *node,
+                                      struct paging_record_id *record_id) {
+  database_index_node_tail_clear(tree, node);
+  const struct paging_write_result write_result =
+      paging_write(pager, tree.chain, node, tree.node_size);
+  if (!write_result.success) {
+    warn("Index node write error");
+    return false;
+  }
+
+  *record_id = write_result.info.record_id;
+  return true;
+}
+
+static bool database_index_node_update(struct paging_pager *pager,
+                                       struct database_index_tree tree,
+                                       struct paging_record_id record_id,
+                                       unsigned char *node) {
+  database_index_node_tail_clear(tree, node);
+  const struct paging_update_result update_result = paging_update(
+      pager, (struct paging_info){.chain = tree.chain, .record_id = record_id},
+      node, tree.node_size);
+  if (!update_result.success) {
+    warn("Index node update error");
+    return false;
+  }
+  return true;
+}
+
+// Puts the entry at the position and splits the node in two when it
+// overflows. The node must have room for one entry over its capacity.
+static bool database_index_node_put(struct paging_pager *pager,
+                                    struct database_index_tree tree,
+                                    struct paging_record_id record_id,
+                                    unsigned char *node, size_t position,
+                                    const unsigned char *entry,
+                                    struct database_index_split *split) {
+  struct database_index_file_node_header header =
+      database_index_node_header(node);
+  const bool is_leaf = header.is_leaf;
+  const size_t entry_size = database_index_entry_size(tree, is_leaf);
+
+  unsigned char *target =
+      database_index_node_entry(tree, node, is_leaf, position);
+  memmove(target + entry_size, target,
+          (header.entries_count - position) * entry_size);
+  memcpy(target, entry, entry_size);
+  header.entries_count++;
+  if (header.entries_count <= database_index_node_capacity(tree, is_leaf)) {
+    memcpy(node, &header, sizeof(header));
+    return database_index_node_update(pager, tree, record_id, node);
+  }
+
+  unsigned char *right = malloc(tree.node_size);
+  if (right == NULL) {
+    warn("Index node allocation error");
+    return false;
+  }
+
+  // Leaves copy their middle entry to the parent, inner nodes move it there
+  // and give its child to the right node
+  const size_t left_count = header.entries_count / 2;
+  const unsigned char *middle =
+      database_index_node_entry(tree, node, is_leaf, left_count);
+  memcpy(split->entry, middle, tree.key_size + DATABASE_INDEX_RECORD_ID_SIZE);
+
+  struct database_index_file_node_header right_header = {.is_leaf = is_leaf};
+  size_t right_first = left_count;
+  if (is_leaf) {
+    right_header.link_page_number = header.link_page_number;
+    right_header.link_slot_number = header.link_slot_number;
+  } else {
+    const struct paging_record_id child = database_index_record_id_decode(
+        middle + tree.key_size + DATABASE_INDEX_RECORD_ID_SIZE);
+    right_header.link_page_number = child.page_number;
+    right_header.link_slot_number = child.slot_number;
+    right_first++;
+  }
+  right_header.entries_count = header.entries_count - right_first;
+  memcpy(right, &right_header, sizeof(right_header));
+  memcpy(database_index_node_entry(tree, right, is_leaf, 0),
+         database_index_node_entry(tree, node, is_leaf, right_first),
+         right_header.entries_count * entry_size);
+
+  const bool success = database_index_node_write(pager, tree, right,
+                                                 &split->right_record_id);
+  free(right);
+  if (!success) {
+    return false;
+  }
+
+  header.entries_count = left_count;
+  if (is_leaf) {
+    header.link_page_number = split->right_record_id.page_number;
+    header.link_slot_number = split->right_record_id.slot_number;
+  }
+  memcpy(node, &header, sizeof(header));
+  split->is_split = true;
+  return database_index_node_update(pager, tree, record_id, node);
+}
+
+static bool database_index_node_insert(struct paging_pager *pager,
+                                       struct database_index_tree tree,
+                                       struct paging_record_id record_id,
+                                       const unsigned char *entry,
+                                       struct database_index_split *split) {
+  split->is_split = false;
+  unsigned char *node =
+      malloc(tree.node_size + database_index_entry_size(tree, false));
+  if (node == NULL) {
+    warn("Index node allocation error");
+    return false;
+  }
+  if (!database_index_node_read(pager, tree, record_id, node)) {
+    free(node);
+    return false;
+  }
+
+  const struct database_index_file_node_header header =
+      database_index_node_header(node);
+  bool success;
+  if (header.is_leaf) {
+    const size_t position =
+        database_index_node_search(tree, node, entry, false);
+    // The row is indexed already
+    success =
+        (position < header.entries_count &&
+         memcmp(database_index_node_entry(tree, node, true, position), entry,
+                database_index_entry_size(tree, true)) == 0) ||
+        database_index_node_put(pager, tree, record_id, node, position, entry,
+                                split);
+  } else {
+    const size_t position = database_index_node_search(tree, node, entry, true);
+    struct database_index_split child_split;
+    success = database_index_node_insert(
+        pager, tree, database_index_node_child(tree, node, position), entry,
+        &child_split);
+    if (success && child_split.is_split) {
+      unsigned char inner_entry[DATABASE_INDEX_ENTRY_SIZE_MAX];
+      memcpy(inner_entry, child_split.entry,
+             tree.key_size + DATABASE_INDEX_RECORD_ID_SIZE);
+      database_index_record_id_encode(child_split.right_record_id,
+                                      inner_entry + tree.key_size +
+                                          DATABASE_INDEX_RECORD_ID_SIZE);
+      success = database_index_node_put(pager, tree, record_id, node, position,
+                                        inner_entry, split);
+    }
+  }
+
+  free(node);
+  return success;
+}
+
+// Moves the old root to a new node, which becomes the first child of the
+// root next to the node split from it
+static bool database_index_root_grow(struct paging_pager *pager,
+                                     struct database_index_tree tree,
+                                     struct paging_record_id root_record_id,
+                                     struct database_index_split split) {
+  unsigned char *node = malloc(tree.node_size);
+  if (node == NULL) {
+    warn("Index node allocation error");
+    return false;
+  }
+
+  struct paging_record_id left_record_id;
+  if (!database_index_node_read(pager, tree, root_record_id, node) ||
+      !database_index_node_write(pager, tree, node, &left_record_id)) {
+    free(node);
+    return false;
+  }
+
+  const struct database_index_file_node_header header = {
+      .is_leaf = false,
+      .entries_count = 1,
+      .link_page_number = left_record_id.page_number,
+      .link_slot_number = left_record_id.slot_number};
+  memcpy(node, &header, sizeof(header));
+  unsigned char *entry = database_index_node_entry(tree, node, false, 0);
+  memcpy(entry, split.entry, tree.key_size + DATABASE_INDEX_RECORD_ID_SIZE);
+  database_index_record_id_encode(split.right_record_id,
+                                  entry + tree.key_size +
+                                      DATABASE_INDEX_RECORD_ID_SIZE);
+
+  const bool success =
+      database_index_node_update(pager, tree, root_record_id, node);
+  free(node);
+  return success;
+}
+
+struct database_index_create_result
+database_index_create(struct paging_pager *pager,
+                      enum database_index_method method) {
+  const struct paging_chain_create_result chain_result =
+      paging_chain_create(pager);
+  if (!chain_result.success) {
+    warn("Index chain creation error");
+    return (struct database_index_create_result){.success = false};
+  }
+
+  struct paging_record_id root_record_id;
+  bool success = false;
+  switch (method) {
+  case DATABASE_INDEX_METHOD_BTREE: {
+    const struct database_index_tree tree = {
+        .chain = chain_result.chain,
+        .node_size = paging_record_size_max(pager)};
+    unsigned char *root = calloc(1, tree.node_size);
+    if (root == NULL) {
+      warn("Index node allocation error");
+      success = false;
+      break;
+    }
+
+    const struct database_index_file_node_header header = {
+        .is_leaf = true,
+        .entries_count = 0,
+        .link_page_number = DATABASE_INDEX_NO_NODE};
+    memcpy(root, &header, sizeof(header));
+    success = database_index_node_write(pager, tree, root, &root_record_id);
+    free(root);
+  } break;
+  case DATABASE_INDEX_METHOD_HASH: {
+    success = database_index_hash_create(pager, chain_result.chain,
+                                         &root_record_id);
+  } break;
+  }
+  if (!success) {
+    paging_chain_remove(pager, chain_result.chain);
+    return (struct database_index_create_result){.success = false};
+  }
+
+  return (struct database_index_create_result){
+      .success = true,
+      .chain = chain_result.chain,
+      .root_record_id = root_record_id};
+}
+
+bool database_index_insert(struct paging_pager *pager,
+                           struct database_index index,
+                           struct database_index_key key,
+                           struct paging_record_id record_id) {
+  if (index.method == DATABASE_INDEX_METHOD_HASH) {
+    return database_index_hash_insert(pager, index, key, record_id);
+  }
+
+  const struct database_index_tree tree =
+      database_index_tree_make(pager, index);
+  if (key.size != tree.key_size) {
+    warn("Index key size mismatch");
+    return false;
+  }
+
+  unsigned char entry[DATABASE_INDEX_ENTRY_SIZE_MAX];
+  memcpy(entry, key.bytes, tree.key_size);
+  database_index_record_id_encode(record_id, entry + tree.key_size);
+
+  struct database_index_split split;
+  if (!database_index_node_insert(pager, tree, index.root_record_id, entry,
+                                  &split)) {
+    return false;
+  }
+  return !split.is_split ||
+         database_index_root_grow(pager, tree, index.root_record_id, split);
+}
+
+bool database_index_remove(struct paging_pager *pager,
+                           struct database_index index,
+                           struct database_index_key key,
+                           struct paging_record_id record_id) {
+  if (index.method == DATABASE_INDEX_METHOD_HASH) {
+    return database_index_hash_remove(pager, index, key, record_id);
+  }
+
+  const struct database_index_tree tree =
+      database_index_tree_make(pager, index);
+  if (key.size != tree.key_size) {
+    warn("Index key size mismatch");
+    return false;
+  }
+
+  unsigned char entry[DATABASE_INDEX_ENTRY_SIZE_MAX];
+  memcpy(entry, key.bytes, tree.key_size);
+  database_index_record_id_encode(record_id, entry + tree.key_size);
+
+  unsigned char *node = malloc(tree.node_size);
+  if (node == NULL) {
+    warn("Index node allocation error");
+    return false;
+  }
+
+  struct paging_record_id node_record_id = index.root_record_id;
+  while (database_index_node_read(pager, tree, node_record_id, node)) {
+    struct database_index_file_node_header header =
+        database_index_node_header(node);
+    if (!header.is_leaf) {
+      node_record_id = database_index_node_child(
+          tree, node, database_index_node_search(tree, node, entry, true));
+      continue;
+    }
+
+    const size_t entry_size = database_index_entry_size(tree, true);
+    const size_t position =
+        database_index_node_search(tree, node, entry, false);
+    unsigned char *target =
+        database_index_node_entry(tree, node, true, position);
+    if (position == header.entries_count ||
+        memcmp(target, entry, entry_size) != 0) {
+      free(node);
+      return true;
+    }
+
+    memmove(target, target + entry_size,
+            (header.entries_count - position - 1) * entry_size);
+    header.entries_count--;
+    memcpy(node, &header, sizeof(header));
+    const bool success =
+        database_index_node_update(pager, tree, node_record_id, node);
+    free(node);
+    return success;
+  }
+
+  free(node);
+  return false;
+}
+
+struct database_index_find_result
+database_index_find(const struct paging_pager *pager,
+                    struct database_index index,
+                    struct database_index_range range) {
+  if (index.method == DATABASE_INDEX_METHOD_HASH) {
+    if (!database_index_range_is_point(range)) {
+      warn("Hash index range is not a single key");
+      return (struct database_index_find_result){.success = false};
+    }
+    return database_index_hash_find(pager, index, range.lower);
+  }
+
+  const struct database_index_tree tree =
+      database_index_tree_make(pager, index);
+  if ((range.has_lower && range.lower.size != tree.key_size) ||
+      (range.has_upper && range.upper.size != tree.key_size)) {
+    warn("Index key size mismatch");
+    return (struct database_index_find_result){.success = false};
+  }
+
+  // No row has a zero record id, so the entry is less than all entries
+  // with the lower key
+  unsigned char lower[DATABASE_INDEX_ENTRY_SIZE_MAX] = {0};
+  memcpy(lower, range.lower.bytes, tree.key_size);
+
+  size_t capacity = 16;
+  struct database_index_find_result result = {
+      .success = true,
+      .count = 0,
+      .record_ids = malloc(capacity * sizeof(struct paging_record_id))};
+  unsigned char *node = malloc(tree.node_size);
+  if (result.record_ids == NULL || node == NULL) {
+    warn("Index find allocation error");
+    free(result.record_ids);
+    free(node);
+    return (struct database_index_find_result){.success = false};
+  }
+
+  struct paging_record_id node_record_id = index.root_record_id;
+  bool success = database_index_node_read(pager, tree, node_record_id, node);
+  while (success && !database_index_node_header(node).is_leaf) {
+    node_record_id = database_index_node_child(
+        tree, node,
+        range.has_lower ? database_index_node_search(tree, node, lower, true)
+                        : 0);
+    success = database_index_node_read(pager, tree, node_record_id, node);
+  }
+
+  size_t position =
+      range.has_lower ? database_index_node_search(tree, node, lower, false)
+                      : 0;
+  while (success) {
+    const struct database_index_file_node_header header =
+        database_index_node_header(node);
+    for (; position < header.entries_count; position++) {
+      const unsigned char *entry =
+          database_index_node_entry(tree, node, true, position);
+      if (range.has_upper &&
+          memcmp(entry, range.upper.bytes, tree.key_size) > 0) {
+        free(node);
+        return result;
+      }
+
+      if (result.count == capacity) {
+        capacity *= 2;
+        struct paging_record_id *record_ids = realloc(
+            result.record_ids, capacity * sizeof(struct paging_record_id));
+        if (record_ids == NULL) {
+          warn("Index find allocation error");
+          success = false;
+          break;
+        }
+        result.record_ids = record_ids;
+      }
+      result.record_ids[result.count++] =
+          database_index_record_id_decode(entry + tree.key_size);
+    }
+
+    if (!success || header.link_page_number == DATABASE_INDEX_NO_NODE) {
+      break;
+    }
+    node_record_id = (struct paging_record_id){
+        .page_number = header.link_page_number,
+        .slot_number = (uint16_t)header.link_slot_number};
+    success = database_index_node_read(pager, tree, node_record_id, node);
+    position = 0;
+  }
+
+  free(node);
+  if (!success) {
+    free(result.record_ids);
+    return (struct database_index_find_result){.success = false};
+  }
+  return result;
+}
@@ -0,0 +1,109 @@
+#ifndef ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_INDEX_H
+#define ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_INDEX_H
+
+#include "database_attribute_type.h"
+#include "database_attribute_value.h"
+#include "database_where.h"
+#include "paging.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Strings are indexed by their first bytes only, so rows found by a string
+// key have to be checked against the whole string
+#define DATABASE_INDEX_STRING_KEY_SIZE 32
+
+// Keys of one attribute type have one size and compare with memcmp in the
+// order of their values
+struct database_index_key {
+  size_t size;
+  unsigned char bytes[DATABASE_INDEX_STRING_KEY_SIZE];
+};
+
+// B+trees find ranges of keys, hash tables find single keys in fewer page
+// reads
+enum database_index_method {
+  DATABASE_INDEX_METHOD_BTREE,
+  DATABASE_INDEX_METHOD_HASH
+};
+
+// Indexes of key constraints keep the values of the attribute unique among
+// the rows and live as long as their tables
+enum database_index_constraint {
+  DATABASE_INDEX_CONSTRAINT_NONE,
+  DATABASE_INDEX_CONSTRAINT_UNIQUE,
+  DATABASE_INDEX_CONSTRAINT_PRIMARY_KEY
+};
+
+// Maps the values of an attribute to the record ids of the rows. Its nodes
+// are records of its own chain in the pager of the rows. Every node takes a
+// page of its own and the root keeps its record id while the index grows.
+struct database_index {
+  const char *name;
+  size_t attribute_position;
+  enum database_attribute_type type;
+  enum database_index_method method;
+  enum database_index_constraint constraint;
+  struct paging_chain chain;
+  struct paging_record_id root_record_id;
+};
+
+// Bounds are inclusive, a missing bound leaves the range open
+struct database_index_range {
+  bool has_lower;
+  struct database_index_key lower;
+  bool has_upper;
+  struct database_index_key upper;
+};
+
+struct database_index_create_result {
+  bool success;
+  struct paging_chain chain;
+  struct paging_record_id root_record_id;
+};
+
+struct database_index_find_result {
+  bool success;
+  size_t count;
+  struct paging_record_id *record_ids;
+};
+
+size_t database_index_key_size(enum database_attribute_type type);
+
+struct database_index_key
+database_index_key_make(enum database_attribute_type type,
+                        union database_attribute_value value);
+
+// Finds the range of keys outside of which the attribute never satisfies
+// the condition. Returns false when the condition does not bound the
+// attribute, or bounds it to a range that the index cannot find.
+bool database_index_range_from_where(struct database_index index,
+                                     struct database_where where,
+                                     struct database_index_range *range);
+
+// Tells whether the range holds a single key
+bool database_index_range_is_point(struct database_index_range range);
+
+// Creates an empty index, which is removed with its chain
+struct database_index_create_result
+database_index_create(struct paging_pager *pager,
+                      enum database_index_method method);
+
+bool database_index_insert(struct paging_pager *pager,
+                           struct database_index index,
+                           struct database_index_key key,
+                           struct paging_record_id record_id);
+
+// Nodes emptied by removals stay in the index until it is built again
+bool database_index_remove(struct paging_pager *pager,
+                           struct database_index index,
+                           struct database_index_key key,
+                           struct paging_record_id record_id);
+
+// Record ids of the rows with keys in the range. B+trees order them by key,
+// hash tables find only ranges of one key.
+struct database_index_find_result
+database_index_find(const struct paging_pager *pager,
+                    struct database_index index,
+                    struct database_index_range range);
+
+#endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_INDEX_H
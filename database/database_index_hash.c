@@ -0,0 +1,899 @@
+#include "database_index_hash.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DATABASE_INDEX_HASH_RECORD_ID_SIZE                                     \
+  (sizeof(uint64_t) + sizeof(uint16_t))
+
+#define DATABASE_INDEX_HASH_NO_BUCKET UINT64_MAX
+
+// The root of the table. Directory entry i is the bucket of the keys whose
+// hashes end with the global_depth low bits of i. The directory is split
+// into pages of a power of two entries, their record ids follow the header.
+struct database_index_hash_file_header {
+  uint64_t global_depth;
+  uint64_t directory_pages_count;
+};
+
+struct database_index_hash_file_record_id {
+  uint64_t page_number;
+  uint64_t slot_number;
+};
+
+// Entries of a bucket are keys with the record ids of their rows. All keys
+// of a bucket end with the same local_depth low bits of their hashes.
+struct database_index_hash_file_bucket_header {
+  uint64_t local_depth;
+  uint64_t entries_count;
+  uint64_t next_page_number;
+  uint64_t next_slot_number;
+};
+
+struct database_index_hash_table {
+  struct paging_chain chain;
+  size_t key_size;
+  size_t record_size;
+  size_t directory_page_capacity;
+  size_t directory_pages_max;
+  size_t depth_max;
+};
+
+static struct database_index_hash_table
+database_index_hash_table_make(const struct paging_pager *pager,
+                               struct paging_chain chain, size_t key_size) {
+  const size_t record_size = paging_record_size_max(pager);
+  const size_t record_id_size =
+      sizeof(struct database_index_hash_file_record_id);
+
+  size_t directory_page_capacity = 1;
+  while (directory_page_capacity * 2 <= record_size / record_id_size) {
+    directory_page_capacity *= 2;
+  }
+  const size_t directory_pages_max =
+      (record_size - sizeof(struct database_index_hash_file_header)) /
+      record_id_size;
+
+  size_t depth_max = 0;
+  while (depth_max < 63 &&
+         (size_t)1 << (depth_max + 1) <=
+             directory_page_capacity * directory_pages_max) {
+    depth_max++;
+  }
+
+  return (struct database_index_hash_table){
+      .chain = chain,
+      .key_size = key_size,
+      .record_size = record_size,
+      .directory_page_capacity = directory_page_capacity,
+      .directory_pages_max = directory_pages_max,
+      .depth_max = depth_max};
+}
+
+static struct database_index_hash_table
+database_index_hash_table_of(const struct paging_pager *pager,
+                             struct database_index index) {
+  return database_index_hash_table_make(
+      pager, index.chain, database_index_key_size(index.type));
+}
+
+static uint64_t database_index_hash_of(const unsigned char *key,
+                                       size_t key_size) {
+  // FNV-1a
+  uint64_t hash = UINT64_C(0xCBF29CE484222325);
+  for (size_t i = 0; i < key_size; i++) {
+    hash = (hash ^ key[i]) * UINT64_C(0x100000001B3);
+  }
+
+  // The directory is addressed by the low bits, which FNV-1a leaves
+  // depending on the low bits of the bytes only
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xFF51AFD7ED558CCD);
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static uint64_t database_index_hash_mask(size_t depth) {
+  return depth == 0 ? 0 : UINT64_MAX >> (64 - depth);
+}
+
+static size_t
+database_index_hash_entry_size(struct database_index_hash_table table) {
+  return table.key_size + DATABASE_INDEX_HASH_RECORD_ID_SIZE;
+}
+
+static size_t
+database_index_hash_bucket_capacity(struct database_index_hash_table table) {
+  return (table.record_size -
+          sizeof(struct database_index_hash_file_bucket_header)) /
+         database_index_hash_entry_size(table);
+}
+
+static void database_index_hash_entry_make(struct database_index_key key,
+                                           struct paging_record_id record_id,
+                                           unsigned char *entry) {
+  memcpy(entry, key.bytes, key.size);
+  memcpy(entry + key.size, &record_id.page_number, sizeof(uint64_t));
+  memcpy(entry + key.size + sizeof(uint64_t), &record_id.slot_number,
+         sizeof(uint16_t));
+}
+
+static struct paging_record_id
+database_index_hash_entry_record_id(struct database_index_hash_table table,
+                                    const unsigned char *entry) {
+  struct paging_record_id record_id;
+  memcpy(&record_id.page_number, entry + table.key_size, sizeof(uint64_t));
+  memcpy(&record_id.slot_number, entry + table.key_size + sizeof(uint64_t),
+         sizeof(uint16_t));
+  return record_id;
+}
+
+static struct paging_record_id
+database_index_hash_record_id_read(const unsigned char *bytes) {
+  struct database_index_hash_file_record_id file_record_id;
+  memcpy(&file_record_id, bytes, sizeof(file_record_id));
+  return (struct paging_record_id){
+      .page_number = file_record_id.page_number,
+      .slot_number = (uint16_t)file_record_id.slot_number};
+}
+
+static void
+database_index_hash_record_id_write(struct paging_record_id record_id,
+                                    unsigned char *bytes) {
+  const struct database_index_hash_file_record_id file_record_id = {
+      .page_number = record_id.page_number,
+      .slot_number = record_id.slot_number};
+  memcpy(bytes, &file_record_id, sizeof(file_record_id));
+}
+
+static struct database_index_hash_file_header
+database_index_hash_header(const unsigned char *root) {
+  struct database_index_hash_file_header header;
+  memcpy(&header, root, sizeof(header));
+  return header;
+}
+
+static unsigned char *database_index_hash_directory_page_id(unsigned char *root,
+                                                            size_t position) {
+  return root + sizeof(struct database_index_hash_file_header) +
+         position * sizeof(struct database_index_hash_file_record_id);
+}
+
+static struct database_index_hash_file_bucket_header
+database_index_hash_bucket_header(const unsigned char *bucket) {
+  struct database_index_hash_file_bucket_header header;
+  memcpy(&header, bucket, sizeof(header));
+  return header;
+}
+
+static unsigned char *
+database_index_hash_bucket_entry(struct database_index_hash_table table,
+                                 unsigned char *bucket, size_t position) {
+  return bucket + sizeof(struct database_index_hash_file_bucket_header) +
+         position * database_index_hash_entry_size(table);
+}
+
+static struct paging_record_id database_index_hash_bucket_next(
+    struct database_index_hash_file_bucket_header header) {
+  return (struct paging_record_id){
+      .page_number = header.next_page_number,
+      .slot_number = (uint16_t)header.next_slot_number};
+}
+
+static bool database_index_hash_read(const struct paging_pager *pager,
+                                     struct database_index_hash_table table,
+                                     struct paging_record_id record_id,
+                                     unsigned char *record) {
+  void *data = NULL;
+  const struct paging_read_result read_result = paging_fetch(
+      pager, (struct paging_info){.chain = table.chain, .record_id = record_id},
+      &data);
+  if (!read_result.success) {
+    warn("Hash index record read error");
+    return false;
+  }
+
+  const bool success = read_result.size == table.record_size;
+  if (success) {
+    memcpy(record, data, table.record_size);
+  } else {
+    warn("Hash index record size mismatch");
+  }
+  if (read_result.is_data_owned) {
+    free(data);
+  }
+  return success;
+}
+
+static bool database_index_hash_write(struct paging_pager *pager,
+                                      struct database_index_hash_table table,
+                                      const unsigned char *record,
+                                      struct paging_record_id *record_id) {
+  const struct paging_write_result write_result =
+      paging_write(pager, table.chain, record, table.record_size);
+  if (!write_result.success) {
+    warn("Hash index record write error");
+    return false;
+  }
+
+  *record_id = write_result.info.record_id;
+  return true;
+}
+
+static bool database_index_hash_update(struct paging_pager *pager,
+                                       struct database_index_hash_table table,
+                                       struct paging_record_id record_id,
+                                       const unsigned char *record) {
+  const struct paging_update_result update_result = paging_update(
+      pager, (struct paging_info){.chain = table.chain, .record_id = record_id},
+      record, table.record_size);
+  if (!update_result.success) {
+    warn("Hash index record update error");
+    return false;
+  }
+  return true;
+}
+
+// Finds the bucket of the hash with the root of the table read into root
+static bool database_index_hash_bucket_find(
+    const struct paging_pager *pager, struct database_index_hash_table table,
+    unsigned char *root, unsigned char *directory_page, uint64_t hash,
+    struct paging_record_id *bucket_record_id) {
+  const struct database_index_hash_file_header header =
+      database_index_hash_header(root);
+  const uint64_t position =
+      hash & database_index_hash_mask(header.global_depth);
+  const struct paging_record_id page_record_id =
+      database_index_hash_record_id_read(database_index_hash_directory_page_id(
+          root, position / table.directory_page_capacity));
+  if (!database_index_hash_read(pager, table, page_record_id,
+                                directory_page)) {
+    return false;
+  }
+
+  *bucket_record_id = database_index_hash_record_id_read(
+      directory_page + (position % table.directory_page_capacity) *
+                           sizeof(struct database_index_hash_file_record_id));
+  return true;
+}
+
+// Writes the root of a table with one empty bucket into root
+static bool
+database_index_hash_root_make(struct paging_pager *pager,
+                              struct database_index_hash_table table,
+                              unsigned char *root) {
+  unsigned char *record = calloc(1, table.record_size);
+  if (record == NULL) {
+    warn("Hash index record allocation error");
+    return false;
+  }
+
+  const struct database_index_hash_file_bucket_header bucket_header = {
+      .local_depth = 0,
+      .entries_count = 0,
+      .next_page_number = DATABASE_INDEX_HASH_NO_BUCKET};
+  memcpy(record, &bucket_header, sizeof(bucket_header));
+  struct paging_record_id bucket_record_id;
+  if (!database_index_hash_write(pager, table, record, &bucket_record_id)) {
+    free(record);
+    return false;
+  }
+
+  memset(record, 0, table.record_size);
+  database_index_hash_record_id_write(bucket_record_id, record);
+  struct paging_record_id page_record_id;
+  const bool success =
+      database_index_hash_write(pager, table, record, &page_record_id);
+  free(record);
+  if (!success) {
+    return false;
+  }
+
+  memset(root, 0, table.record_size);
+  const struct database_index_hash_file_header header = {
+      .global_depth = 0, .directory_pages_count = 1};
+  memcpy(root, &header, sizeof(header));
+  database_index_hash_record_id_write(
+      page_record_id, database_index_hash_directory_page_id(root, 0));
+  return true;
+}
+
+bool database_index_hash_create(struct paging_pager *pager,
+                                struct paging_chain chain,
+                                struct paging_record_id *root_record_id) {
+  const struct database_index_hash_table table =
+      database_index_hash_table_make(pager, chain, 0);
+  unsigned char *root = malloc(table.record_size);
+  if (root == NULL) {
+    warn("Hash index record allocation error");
+    return false;
+  }
+
+  const bool success =
+      database_index_hash_root_make(pager, table, root) &&
+      database_index_hash_write(pager, table, root, root_record_id);
+  free(root);
+  return success;
+}
+
+// Points the directory to twice as many entries, the new half repeats the
+// old one
+static bool
+database_index_hash_directory_double(struct paging_pager *pager,
+                                     struct database_index_hash_table table,
+                                     struct paging_record_id root_record_id,
+                                     unsigned char *root) {
+  struct database_index_hash_file_header header =
+      database_index_hash_header(root);
+  const size_t entries_count = (size_t)1 << header.global_depth;
+  const size_t record_id_size =
+      sizeof(struct database_index_hash_file_record_id);
+
+  unsigned char *page = malloc(table.record_size);
+  if (page == NULL) {
+    warn("Hash index record allocation error");
+    return false;
+  }
+
+  bool success = true;
+  if (entries_count * 2 <= table.directory_page_capacity) {
+    const struct paging_record_id page_record_id =
+        database_index_hash_record_id_read(
+            database_index_hash_directory_page_id(root, 0));
+    success = database_index_hash_read(pager, table, page_record_id, page);
+    if (success) {
+      memcpy(page + entries_count * record_id_size, page,
+             entries_count * record_id_size);
+      success =
+          database_index_hash_update(pager, table, page_record_id, page);
+    }
+  } else {
+    // The old pages are full, so the new ones are their copies
+    const size_t pages_count = header.directory_pages_count;
+    for (size_t i = 0; success && i < pages_count; i++) {
+      struct paging_record_id copy_record_id;
+      success =
+          database_index_hash_read(
+              pager, table,
+              database_index_hash_record_id_read(
+                  database_index_hash_directory_page_id(root, i)),
+              page) &&
+          database_index_hash_write(pager, table, page, &copy_record_id);
+      if (success) {
+        database_index_hash_record_id_write(
+            copy_record_id,
+            database_index_hash_directory_page_id(root, pages_count + i));
+      }
+    }
+    header.directory_pages_count *= 2;
+  }
+  free(page);
+  if (!success) {
+    return false;
+  }
+
+  header.global_depth++;
+  memcpy(root, &header, sizeof(header));
+  return database_index_hash_update(pager, table, root_record_id, root);
+}
+
+// Points the directory entries of the keys that end with the bits to the
+// bucket
+static bool database_index_hash_directory_set(
+    struct paging_pager *pager, struct database_index_hash_table table,
+    unsigned char *root, uint64_t bits, size_t depth,
+    struct paging_record_id bucket_record_id) {
+  const struct database_index_hash_file_header header =
+      database_index_hash_header(root);
+  unsigned char *page = malloc(table.record_size);
+  if (page == NULL) {
+    warn("Hash index record allocation error");
+    return false;
+  }
+
+  const size_t entries_count = (size_t)1 << header.global_depth;
+  bool success = true;
+  size_t page_position = SIZE_MAX;
+  struct paging_record_id page_record_id;
+  for (size_t i = bits & database_index_hash_mask(depth);
+       success && i < entries_count; i += (size_t)1 << depth) {
+    if (i / table.directory_page_capacity != page_position) {
+      if (page_position != SIZE_MAX) {
+        success =
+            database_index_hash_update(pager, table, page_record_id, page);
+      }
+      page_position = i / table.directory_page_capacity;
+      page_record_id = database_index_hash_record_id_read(
+          database_index_hash_directory_page_id(root, page_position));
+      success = success &&
+                database_index_hash_read(pager, table, page_record_id, page);
+    }
+    database_index_hash_record_id_write(
+        bucket_record_id,
+        page + (i % table.directory_page_capacity) *
+                   sizeof(struct database_index_hash_file_record_id));
+  }
+  if (success && page_position != SIZE_MAX) {
+    success = database_index_hash_update(pager, table, page_record_id, page);
+  }
+
+  free(page);
+  return success;
+}
+
+// Writes the entries to a list of buckets that starts with the given
+// buckets, which are removed when they are left unused
+static bool database_index_hash_chain_write(
+    struct paging_pager *pager, struct database_index_hash_table table,
+    size_t local_depth, const unsigned char *entries, size_t entries_count,
+    const struct paging_record_id *old_record_ids, size_t old_count,
+    struct paging_record_id *first_record_id) {
+  const size_t capacity = database_index_hash_bucket_capacity(table);
+  const size_t entry_size = database_index_hash_entry_size(table);
+  size_t buckets_count = (entries_count + capacity - 1) / capacity;
+  if (buckets_count == 0) {
+    buckets_count = 1;
+  }
+
+  unsigned char *bucket = malloc(table.record_size);
+  struct paging_record_id *record_ids =
+      malloc(buckets_count * sizeof(struct paging_record_id));
+  if (bucket == NULL || record_ids == NULL) {
+    warn("Hash index bucket allocation error");
+    free(bucket);
+    free(record_ids);
+    return false;
+  }
+
+  // Buckets are written from the last one, so that each knows the next
+  bool success = true;
+  for (size_t i = buckets_count; success && i-- > 0;) {
+    const size_t first = i * capacity;
+    const size_t count =
+        entries_count - first < capacity ? entries_count - first : capacity;
+    struct database_index_hash_file_bucket_header header = {
+        .local_depth = local_depth,
+        .entries_count = count,
+        .next_page_number = DATABASE_INDEX_HASH_NO_BUCKET};
+    if (i + 1 < buckets_count) {
+      header.next_page_number = record_ids[i + 1].page_number;
+      header.next_slot_number = record_ids[i + 1].slot_number;
+    }
+
+    memset(bucket, 0, table.record_size);
+    memcpy(bucket, &header, sizeof(header));
+    memcpy(database_index_hash_bucket_entry(table, bucket, 0),
+           entries + first * entry_size, count * entry_size);
+    if (i < old_count) {
+      record_ids[i] = old_record_ids[i];
+      success =
+          database_index_hash_update(pager, table, record_ids[i], bucket);
+    } else {
+      success =
+          database_index_hash_write(pager, table, bucket, &record_ids[i]);
+    }
+  }
+
+  for (size_t i = buckets_count; success && i < old_count; i++) {
+    success = paging_remove(pager, (struct paging_info){
+                                       .chain = table.chain,
+                                       .record_id = old_record_ids[i]})
+                  .success;
+  }
+
+  if (success) {
+    *first_record_id = record_ids[0];
+  }
+  free(bucket);
+  free(record_ids);
+  return success;
+}
+
+// Moves the entries of the bucket of the hash and its overflow buckets
+// whose hashes have the bit after the local depth set to a new bucket
+static bool database_index_hash_bucket_split(
+    struct paging_pager *pager, struct database_index_hash_table table,
+    unsigned char *root, uint64_t hash,
+    struct paging_record_id bucket_record_id) {
+  const size_t entry_size = database_index_hash_entry_size(table);
+  const size_t capacity = database_index_hash_bucket_capacity(table);
+  unsigned char *bucket = malloc(table.record_size);
+  size_t buckets_capacity = 4;
+  size_t buckets_count = 0;
+  struct paging_record_id *record_ids =
+      malloc(buckets_capacity * sizeof(struct paging_record_id));
+  unsigned char *entries = malloc(buckets_capacity * capacity * entry_size);
+  if (bucket == NULL || record_ids == NULL || entries == NULL) {
+    warn("Hash index bucket allocation error");
+    free(bucket);
+    free(record_ids);
+    free(entries);
+    return false;
+  }
+
+  // Entries with the bit cleared are put from the start of the array, the
+  // others from its end
+  size_t local_depth = 0;
+  size_t low_count = 0;
+  size_t high_count = 0;
+  bool success = true;
+  struct paging_record_id record_id = bucket_record_id;
+  while (success && record_id.page_number != DATABASE_INDEX_HASH_NO_BUCKET) {
+    success = database_index_hash_read(pager, table, record_id, bucket);
+    if (!success) {
+      break;
+    }
+    const struct database_index_hash_file_bucket_header header =
+        database_index_hash_bucket_header(bucket);
+
+    if (buckets_count == buckets_capacity) {
+      const size_t old_capacity = buckets_capacity;
+      buckets_capacity *= 2;
+      struct paging_record_id *new_record_ids = realloc(
+          record_ids, buckets_capacity * sizeof(struct paging_record_id));
+      unsigned char *new_entries =
+          malloc(buckets_capacity * capacity * entry_size);
+      if (new_record_ids == NULL || new_entries == NULL) {
+        warn("Hash index bucket allocation error");
+        record_ids = new_record_ids == NULL ? record_ids : new_record_ids;
+        free(new_entries);
+        success = false;
+        break;
+      }
+      record_ids = new_record_ids;
+      memcpy(new_entries, entries, low_count * entry_size);
+      memcpy(new_entries + (buckets_capacity * capacity - high_count) *
+                               entry_size,
+             entries + (old_capacity * capacity - high_count) * entry_size,
+             high_count * entry_size);
+      free(entries);
+      entries = new_entries;
+    }
+    if (buckets_count == 0) {
+      local_depth = header.local_depth;
+    }
+    record_ids[buckets_count++] = record_id;
+
+    for (size_t i = 0; i < header.entries_count; i++) {
+      const unsigned char *entry =
+          database_index_hash_bucket_entry(table, bucket, i);
+      if ((database_index_hash_of(entry, table.key_size) >> local_depth & 1) ==
+          0) {
+        memcpy(entries + low_count * entry_size, entry, entry_size);
+        low_count++;
+      } else {
+        high_count++;
+        memcpy(entries +
+                   (buckets_capacity * capacity - high_count) * entry_size,
+               entry, entry_size);
+      }
+    }
+    record_id = database_index_hash_bucket_next(header);
+  }
+
+  struct paging_record_id high_record_id;
+  success =
+      success &&
+      database_index_hash_chain_write(
+          pager, table, local_depth + 1,
+          entries + (buckets_capacity * capacity - high_count) * entry_size,
+          high_count, NULL, 0, &high_record_id) &&
+      database_index_hash_chain_write(pager, table, local_depth + 1, entries,
+                                      low_count, record_ids, buckets_count,
+                                      &bucket_record_id) &&
+      database_index_hash_directory_set(
+          pager, table, root,
+          (hash & database_index_hash_mask(local_depth)) |
+              (uint64_t)1 << local_depth,
+          local_depth + 1, high_record_id);
+
+  free(bucket);
+  free(record_ids);
+  free(entries);
+  return success;
+}
+
+// Looks for the entry in the bucket of its hash and in the buckets linked
+// after it
+static bool database_index_hash_entry_find(
+    const struct paging_pager *pager, struct database_index_hash_table table,
+    unsigned char *root, unsigned char *bucket, uint64_t hash,
+    const unsigned char *entry, bool *is_found) {
+  *is_found = false;
+  struct paging_record_id bucket_record_id;
+  bool success = database_index_hash_bucket_find(pager, table, root, bucket,
+                                                 hash, &bucket_record_id);
+  while (success && !*is_found &&
+         bucket_record_id.page_number != DATABASE_INDEX_HASH_NO_BUCKET) {
+    success = database_index_hash_read(pager, table, bucket_record_id, bucket);
+    if (!success) {
+      break;
+    }
+
+    const struct database_index_hash_file_bucket_header header =
+        database_index_hash_bucket_header(bucket);
+    for (size_t i = 0; !*is_found && i < header.entries_count; i++) {
+      *is_found = memcmp(database_index_hash_bucket_entry(table, bucket, i),
+                         entry, database_index_hash_entry_size(table)) == 0;
+    }
+    bucket_record_id = database_index_hash_bucket_next(header);
+  }
+
+  return success;
+}
+
+bool database_index_hash_insert(struct paging_pager *pager,
+                                struct database_index index,
+                                struct database_index_key key,
+                                struct paging_record_id record_id) {
+  const struct database_index_hash_table table =
+      database_index_hash_table_of(pager, index);
+  if (key.size != table.key_size) {
+    warn("Index key size mismatch");
+    return false;
+  }
+
+  const size_t entry_size = database_index_hash_entry_size(table);
+  const size_t capacity = database_index_hash_bucket_capacity(table);
+  const uint64_t hash = database_index_hash_of(key.bytes, key.size);
+  unsigned char entry[DATABASE_INDEX_STRING_KEY_SIZE +
+                      DATABASE_INDEX_HASH_RECORD_ID_SIZE];
+  database_index_hash_entry_make(key, record_id, entry);
+
+  unsigned char *root = malloc(table.record_size);
+  unsigned char *bucket = malloc(table.record_size);
+  if (root == NULL || bucket == NULL) {
+    warn("Hash index record allocation error");
+    free(root);
+    free(bucket);
+    return false;
+  }
+
+  // The row is indexed already
+  bool is_inserted;
+  bool success =
+      database_index_hash_read(pager, table, index.root_record_id, root) &&
+      database_index_hash_entry_find(pager, table, root, bucket, hash, entry,
+                                     &is_inserted);
+  while (success && !is_inserted) {
+    struct paging_record_id first_record_id;
+    success =
+        database_index_hash_read(pager, table, index.root_record_id, root) &&
+        database_index_hash_bucket_find(pager, table, root, bucket, hash,
+                                        &first_record_id);
+
+    // The entry goes to the first bucket with room. Full buckets are split
+    // while their keys differ in the bits that the directory can address.
+    size_t local_depth = 0;
+    bool is_splittable = false;
+    struct paging_record_id bucket_record_id = first_record_id;
+    while (success &&
+           bucket_record_id.page_number != DATABASE_INDEX_HASH_NO_BUCKET) {
+      success =
+          database_index_hash_read(pager, table, bucket_record_id, bucket);
+      if (!success) {
+        break;
+      }
+
+      struct database_index_hash_file_bucket_header header =
+          database_index_hash_bucket_header(bucket);
+      if (header.entries_count < capacity) {
+        memcpy(database_index_hash_bucket_entry(table, bucket,
+                                                header.entries_count),
+               entry, entry_size);
+        header.entries_count++;
+        memcpy(bucket, &header, sizeof(header));
+        success = database_index_hash_update(pager, table, bucket_record_id,
+                                             bucket);
+        is_inserted = true;
+        break;
+      }
+
+      local_depth = header.local_depth;
+      for (size_t i = 0; !is_splittable && i < header.entries_count; i++) {
+        const uint64_t entry_hash = database_index_hash_of(
+            database_index_hash_bucket_entry(table, bucket, i),
+            table.key_size);
+        is_splittable = ((entry_hash ^ hash) &
+                         database_index_hash_mask(table.depth_max)) != 0;
+      }
+      bucket_record_id = database_index_hash_bucket_next(header);
+    }
+    if (!success || is_inserted) {
+      break;
+    }
+
+    const size_t global_depth = database_index_hash_header(root).global_depth;
+    if (is_splittable && local_depth < table.depth_max) {
+      success = (local_depth < global_depth ||
+                 database_index_hash_directory_double(
+                     pager, table, index.root_record_id, root)) &&
+                database_index_hash_bucket_split(pager, table, root, hash,
+                                                 first_record_id);
+      continue;
+    }
+
+    // The keys cannot be split apart, so a new bucket is linked after the
+    // first one
+    success = database_index_hash_read(pager, table, first_record_id, bucket);
+    if (!success) {
+      break;
+    }
+    struct database_index_hash_file_bucket_header first_header =
+        database_index_hash_bucket_header(bucket);
+    unsigned char *overflow = calloc(1, table.record_size);
+    if (overflow == NULL) {
+      warn("Hash index record allocation error");
+      success = false;
+      break;
+    }
+    const struct database_index_hash_file_bucket_header overflow_header = {
+        .local_depth = first_header.local_depth,
+        .entries_count = 1,
+        .next_page_number = first_header.next_page_number,
+        .next_slot_number = first_header.next_slot_number};
+    memcpy(overflow, &overflow_header, sizeof(overflow_header));
+    memcpy(database_index_hash_bucket_entry(table, overflow, 0), entry,
+           entry_size);
+    struct paging_record_id overflow_record_id;
+    success = database_index_hash_write(pager, table, overflow,
+                                        &overflow_record_id);
+    free(overflow);
+    if (success) {
+      first_header.next_page_number = overflow_record_id.page_number;
+      first_header.next_slot_number = overflow_record_id.slot_number;
+      memcpy(bucket, &first_header, sizeof(first_header));
+      success =
+          database_index_hash_update(pager, table, first_record_id, bucket);
+    }
+    is_inserted = true;
+  }
+
+  free(root);
+  free(bucket);
+  return success;
+}
+
+bool database_index_hash_remove(struct paging_pager *pager,
+                                struct database_index index,
+                                struct database_index_key key,
+                                struct paging_record_id record_id) {
+  const struct database_index_hash_table table =
+      database_index_hash_table_of(pager, index);
+  if (key.size != table.key_size) {
+    warn("Index key size mismatch");
+    return false;
+  }
+
+  const size_t entry_size = database_index_hash_entry_size(table);
+  unsigned char entry[DATABASE_INDEX_STRING_KEY_SIZE +
+                      DATABASE_INDEX_HASH_RECORD_ID_SIZE];
+  database_index_hash_entry_make(key, record_id, entry);
+
+  unsigned char *root = malloc(table.record_size);
+  unsigned char *bucket = malloc(table.record_size);
+  if (root == NULL || bucket == NULL) {
+    warn("Hash index record allocation error");
+    free(root);
+    free(bucket);
+    return false;
+  }
+
+  struct paging_record_id bucket_record_id;
+  bool success =
+      database_index_hash_read(pager, table, index.root_record_id, root) &&
+      database_index_hash_bucket_find(
+          pager, table, root, bucket,
+          database_index_hash_of(key.bytes, key.size), &bucket_record_id);
+  while (success &&
+         bucket_record_id.page_number != DATABASE_INDEX_HASH_NO_BUCKET) {
+    success = database_index_hash_read(pager, table, bucket_record_id, bucket);
+    if (!success) {
+      break;
+    }
+
+    struct database_index_hash_file_bucket_header header =
+        database_index_hash_bucket_header(bucket);
+    size_t position = 0;
+    while (position < header.entries_count &&
+           memcmp(database_index_hash_bucket_entry(table, bucket, position),
+                  entry, entry_size) != 0) {
+      position++;
+    }
+    if (position == header.entries_count) {
+      bucket_record_id = database_index_hash_bucket_next(header);
+      continue;
+    }
+
+    // The last entry takes the place of the removed one
+    header.entries_count--;
+    unsigned char *last =
+        database_index_hash_bucket_entry(table, bucket, header.entries_count);
+    memcpy(database_index_hash_bucket_entry(table, bucket, position), last,
+           entry_size);
+    memset(last, 0, entry_size);
+    memcpy(bucket, &header, sizeof(header));
+    success =
+        database_index_hash_update(pager, table, bucket_record_id, bucket);
+    break;
+  }
+
+  free(root);
+  free(bucket);
+  return success;
+}
+
+struct database_index_find_result
+database_index_hash_find(const struct paging_pager *pager,
+                         struct database_index index,
+                         struct database_index_key key) {
+  const struct database_index_hash_table table =
+      database_index_hash_table_of(pager, index);
+  if (key.size != table.key_size) {
+    warn("Index key size mismatch");
+    return (struct database_index_find_result){.success = false};
+  }
+
+  size_t capacity = 16;
+  struct database_index_find_result result = {
+      .success = true,
+      .count = 0,
+      .record_ids = malloc(capacity * sizeof(struct paging_record_id))};
+  unsigned char *root = malloc(table.record_size);
+  unsigned char *bucket = malloc(table.record_size);
+  if (result.record_ids == NULL || root == NULL || bucket == NULL) {
+    warn("Index find allocation error");
+    free(result.record_ids);
+    free(root);
+    free(bucket);
+    return (struct database_index_find_result){.success = false};
+  }
+
+  struct paging_record_id bucket_record_id;
+  bool success =
+      database_index_hash_read(pager, table, index.root_record_id, root) &&
+      database_index_hash_bucket_find(
+          pager, table, root, bucket,
+          database_index_hash_of(key.bytes, key.size), &bucket_record_id);
+  while (success &&
+         bucket_record_id.page_number != DATABASE_INDEX_HASH_NO_BUCKET) {
+    success = database_index_hash_read(pager, table, bucket_record_id, bucket);
+    if (!success) {
+      break;
+    }
+
+    const struct database_index_hash_file_bucket_header header =
+        database_index_hash_bucket_header(bucket);
+    for (size_t i = 0; success && i < header.entries_count; i++) {
+      const unsigned char *entry =
+          database_index_hash_bucket_entry(table, bucket, i);
+      if (memcmp(entry, key.bytes, key.size) != 0) {
+        continue;
+      }
+
+      if (result.count == capacity) {
+        capacity *= 2;
+        struct paging_record_id *record_ids = realloc(
+            result.record_ids, capacity * sizeof(struct paging_record_id));
+        if (record_ids == NULL) {
+          warn("Index find allocation error");
+          success = false;
+          break;
+        }
+        result.record_ids = record_ids;
+      }
+
+      result.record_ids[result.count++] =
+          database_index_hash_entry_record_id(table, entry);
+    }
+    bucket_record_id = database_index_hash_bucket_next(header);
+  }
+
+  free(root);
+  free(bucket);
+  if (!success) {
+    free(result.record_ids);
+    return (struct database_index_find_result){.success = false};
+  }
+  return result;
+}
@@ -0,0 +1,33 @@
+#ifndef ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_INDEX_HASH_H
+#define ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_INDEX_HASH_H
+
+#include "database_index.h"
+
+// Extendible hashing: a directory of bucket record ids is addressed by the
+// low bits of the key hashes, and only the overflowing bucket is split when
+// the table grows. A lookup reads the root, one directory page and the
+// bucket. Keys with equal hashes that do not fit a bucket go to overflow
+// buckets linked after it.
+
+// Writes the root of an empty table to the chain
+bool database_index_hash_create(struct paging_pager *pager,
+                                struct paging_chain chain,
+                                struct paging_record_id *root_record_id);
+
+// An entry with the same key and record id is not added again
+bool database_index_hash_insert(struct paging_pager *pager,
+                                struct database_index index,
+                                struct database_index_key key,
+                                struct paging_record_id record_id);
+
+bool database_index_hash_remove(struct paging_pager *pager,
+                                struct database_index index,
+                                struct database_index_key key,
+                                struct paging_record_id record_id);
+
+struct database_index_find_result
+database_index_hash_find(const struct paging_pager *pager,
+                         struct database_index index,
+                         struct database_index_key key);
+
+#endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_INDEX_HASH_H
@@ -1,6 +1,26 @@
 #include "database_join.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+static bool database_join_values_equal(enum database_attribute_type type,
+                                       union database_attribute_value left,
+                                       union database_attribute_value right) {
+  switch (type) {
+  case DATABASE_ATTRIBUTE_INTEGER:
+    return left.integer == right.integer;
+  case DATABASE_ATTRIBUTE_FLOATING_POINT:
+    return left.floating_point == right.floating_point;
+  case DATABASE_ATTRIBUTE_BOOLEAN:
+    return left.boolean == right.boolean;
+  case DATABASE_ATTRIBUTE_STRING:
+    return strcmp(left.string, right.string) == 0;
+  default:
+    return false;
+  }
+}
+
 bool database_join_is_satisfied(struct database_table left_table,
                                 struct database_row left_row,
                                 struct database_table right_table,
@@ -20,16 +40,191 @@ bool database_join_is_satisfied(struct database_table left_table,
   const union database_attribute_value right_value =
       database_attribute_values_get(right_row.values,
                                     join.right_attribute_position);
-  switch (left_attribute.type) {
+  return database_join_values_equal(left_attribute.type, left_value,
+                                    right_value);
+}
+
+struct database_join_hash_table_entry {
+  struct database_row row;
+  uint64_t hash;
+  size_t hash_next;
+};
+
+struct database_join_hash_table {
+  size_t attribute_position;
+  enum database_attribute_type type;
+  size_t count;
+  size_t capacity;
+  struct database_join_hash_table_entry *entries;
+  size_t buckets_count;
+  size_t *buckets;
+};
+
+// Equal values must have equal hashes, so both zeros of floating point
+// numbers are hashed as one
+static uint64_t
+database_join_value_hash(enum database_attribute_type type,
+                         union database_attribute_value value) {
+  uint64_t hash = 0;
+  switch (type) {
   case DATABASE_ATTRIBUTE_INTEGER:
-    return left_value.integer == right_value.integer;
+    hash = (uint64_t)value.integer;
+    break;
   case DATABASE_ATTRIBUTE_FLOATING_POINT:
-    return left_value.floating_point == right_value.floating_point;
+    if (value.floating_point != 0) {
+      memcpy(&hash, &value.floating_point, sizeof(hash));
+    }
+    break;
   case DATABASE_ATTRIBUTE_BOOLEAN:
-    return left_value.boolean == right_value.boolean;
+    hash = value.boolean;
+    break;
   case DATABASE_ATTRIBUTE_STRING:
-    return strcmp(left_value.string, right_value.string) == 0;
-  default:
+    // FNV-1a
+    hash = UINT64_C(0xCBF29CE484222325);
+    for (const char *c = value.string; *c != '\0'; c++) {
+      hash = (hash ^ (unsigned char)*c) * UINT64_C(0x100000001B3);
+    }
+    break;
+  }
+
+  // Buckets are addressed by the low bits
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xFF51AFD7ED558CCD);
+  hash ^= hash >> 33;
+  return hash;
+}
+
+struct database_join_hash_table *
+database_join_hash_table_create(size_t attribute_position,
+                                enum database_attribute_type type) {
+  struct database_join_hash_table *table =
+      malloc(sizeof(struct database_join_hash_table));
+  if (table == NULL) {
+    return NULL;
+  }
+
+  table->attribute_position = attribute_position;
+  table->type = type;
+  table->count = 0;
+  table->capacity = 0;
+  table->entries = NULL;
+  table->buckets_count = 0;
+  table->buckets = NULL;
+  return table;
+}
+
+void database_join_hash_table_destroy(struct database_join_hash_table *table) {
+  if (table == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < table->count; i++) {
+    database_row_destroy(table->entries[i].row);
+  }
+  free(table->entries);
+  free(table->buckets);
+  free(table);
+}
+
+static void
+database_join_hash_table_link(struct database_join_hash_table *table,
+                              size_t position) {
+  const size_t bucket =
+      table->entries[position].hash & (table->buckets_count - 1);
+  table->entries[position].hash_next = table->buckets[bucket];
+  table->buckets[bucket] = position;
+}
+
+static bool
+database_join_hash_table_grow(struct database_join_hash_table *table) {
+  const size_t capacity = table->capacity == 0 ? 64 : table->capacity * 2;
+  struct database_join_hash_table_entry *entries = realloc(
+      table->entries, capacity * sizeof(struct database_join_hash_table_entry));
+  if (entries == NULL) {
+    return false;
+  }
+  table->entries = entries;
+  table->capacity = capacity;
+
+  size_t *buckets = malloc(capacity * sizeof(size_t));
+  if (buckets == NULL) {
+    return false;
+  }
+  free(table->buckets);
+  table->buckets = buckets;
+  table->buckets_count = capacity;
+
+  for (size_t i = 0; i < table->buckets_count; i++) {
+    table->buckets[i] = DATABASE_JOIN_NO_ROW;
+  }
+  for (size_t i = 0; i < table->count; i++) {
+    database_join_hash_table_link(table, i);
+  }
+  return true;
+}
+
+bool database_join_hash_table_insert(struct database_join_hash_table *table,
+                                     struct database_row row) {
+  if (table->count == table->capacity &&
+      !database_join_hash_table_grow(table)) {
     return false;
   }
-}
\ No newline at end of file
+
+  table->entries[table->count] = (struct database_join_hash_table_entry){
+      .row = row,
+      .hash = database_join_value_hash(
+          table->type, database_attribute_values_get(
+                           row.values, table->attribute_position))};
+  database_join_hash_table_link(table, table->count);
+  table->count++;
+  return true;
+}
+
+static size_t
+database_join_hash_table_match(const struct database_join_hash_table *table,
+                               size_t position, uint64_t hash,
+                               union database_attribute_value value) {
+  while (position != DATABASE_JOIN_NO_ROW) {
+    const struct database_join_hash_table_entry *entry =
+        &table->entries[position];
+    if (entry->hash == hash &&
+        database_join_values_equal(
+            table->type, value,
+            database_attribute_values_get(entry->row.values,
+                                          table->attribute_position))) {
+      return position;
+    }
+    position = entry->hash_next;
+  }
+  return DATABASE_JOIN_NO_ROW;
+}
+
+size_t database_join_hash_table_find_first(
+    const struct database_join_hash_table *table,
+    union database_attribute_value value) {
+  if (table->count == 0) {
+    return DATABASE_JOIN_NO_ROW;
+  }
+
+  const uint64_t hash = database_join_value_hash(table->type, value);
+  return database_join_hash_table_match(
+      table, table->buckets[hash & (table->buckets_count - 1)], hash, value);
+}
+
+size_t database_join_hash_table_find_next(
+    const struct database_join_hash_table *table, size_t position) {
+  assert(position < table->count);
+  const struct database_join_hash_table_entry *entry =
+      &table->entries[position];
+  return database_join_hash_table_match(
+      table, entry->hash_next, entry->hash,
+      database_attribute_values_get(entry->row.values,
+                                    table->attribute_position));
+}
+
+struct database_row
+database_join_hash_table_get(const struct database_join_hash_table *table,
+                             size_t position) {
+  assert(position < table->count);
+  return table->entries[position].row;
+}
@@ -6,6 +6,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#define DATABASE_JOIN_NO_ROW SIZE_MAX
+
 struct database_join {
   size_t left_attribute_position;
   size_t right_attribute_position;
@@ -17,4 +19,34 @@ bool database_join_is_satisfied(struct database_table left_table,
                                 struct database_row right_row,
                                 struct database_join join);
 
+// Rows of one table of a join kept in memory by the values of their join
+// attribute
+struct database_join_hash_table;
+
+struct database_join_hash_table *
+database_join_hash_table_create(size_t attribute_position,
+                                enum database_attribute_type type);
+
+void database_join_hash_table_destroy(struct database_join_hash_table *table);
+
+// Takes the row
+bool database_join_hash_table_insert(struct database_join_hash_table *table,
+                                     struct database_row row);
+
+// Returns the position of the first row with the value or
+// DATABASE_JOIN_NO_ROW
+size_t database_join_hash_table_find_first(
+    const struct database_join_hash_table *table,
+    union database_attribute_value value);
+
+// Returns the position of the next row with the value of the row at the
+// position or DATABASE_JOIN_NO_ROW
+size_t database_join_hash_table_find_next(
+    const struct database_join_hash_table *table, size_t position);
+
+// The row stays owned by the table
+struct database_row
+database_join_hash_table_get(const struct database_join_hash_table *table,
+                             size_t position);
+
 #endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_JOIN_H
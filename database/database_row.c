@@ -1,10 +1,31 @@
 #include "database_row.h"
 #include <stdlib.h>
+#include <string.h>
 
 void database_row_destroy(struct database_row row) {
-  if (row.data) {
+  if (row.data && row.is_data_owned) {
     free(row.data);
   }
 
+  if (row.blob_strings != NULL) {
+    for (size_t i = 0; i < row.values.count; i++) {
+      free(row.blob_strings[i]);
+    }
+    free(row.blob_strings);
+  }
+
   database_attribute_values_destroy(row.values);
-}
\ No newline at end of file
+}
+
+size_t database_row_size(struct database_attributes attributes,
+                         struct database_row row) {
+  size_t size = sizeof(struct database_row) +
+                row.values.count * sizeof(union database_attribute_value);
+  for (size_t i = 0; i < row.values.count; i++) {
+    if (database_attributes_get(attributes, i).type ==
+        DATABASE_ATTRIBUTE_STRING) {
+      size += strlen(database_attribute_values_get(row.values, i).string) + 1;
+    }
+  }
+  return size;
+}
@@ -2,14 +2,23 @@
 #define ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_ROW_H
 
 #include "database_attribute_values.h"
+#include "database_attributes.h"
 #include "paging.h"
 
 struct database_row {
   void *data;
+  bool is_data_owned;
   struct paging_info paging_info;
   struct database_attribute_values values;
+  // Strings read from blobs that the row owns, one per attribute. NULL when
+  // the row owns none.
+  char **blob_strings;
 };
 
 void database_row_destroy(struct database_row row);
 
+// Bytes the values of the row take in memory, strings included
+size_t database_row_size(struct database_attributes attributes,
+                         struct database_row row);
+
 #endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_ROW_H
@@ -0,0 +1,426 @@
+#include "database_sort.h"
+#include "logger.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct database_sort_item {
+  enum database_attribute_type type;
+  union database_attribute_value key;
+  struct database_row row;
+};
+
+struct database_sort_run {
+  struct paging_chain chain;
+  // Paging info of the record of the row merged next
+  struct paging_info info;
+  struct database_row row;
+};
+
+struct database_sort {
+  struct paging_pager *pager;
+  struct database_attributes attributes;
+  size_t attribute_position;
+  size_t memory_size;
+  // Rows of the run being collected. Without written runs they are read
+  // from here once they are sorted.
+  size_t items_size;
+  size_t items_count;
+  size_t items_capacity;
+  size_t items_position;
+  struct database_sort_item *items;
+  size_t runs_count;
+  size_t runs_capacity;
+  struct database_sort_run *runs;
+  // Positions of the runs that still have rows, as a binary heap by their
+  // rows
+  size_t heap_count;
+  size_t *heap;
+};
+
+// Records of the runs hold the paging info of the row and its values.
+// Strings are stored with their terminating zeros after their sizes.
+struct database_sort_file_row_header {
+  uint64_t chain_root_page_number;
+  uint64_t page_number;
+  uint64_t slot_number;
+};
+
+int database_sort_values_compare(enum database_attribute_type type,
+                                 union database_attribute_value left,
+                                 union database_attribute_value right) {
+  switch (type) {
+  case DATABASE_ATTRIBUTE_INTEGER:
+    return (left.integer > right.integer) - (left.integer < right.integer);
+  case DATABASE_ATTRIBUTE_FLOATING_POINT:
+    if (left.floating_point < right.floating_point) {
+      return -1;
+    }
+    if (left.floating_point > right.floating_point) {
+      return 1;
+    }
+    return isnan(left.floating_point) - isnan(right.floating_point);
+  case DATABASE_ATTRIBUTE_BOOLEAN:
+    return left.boolean - right.boolean;
+  case DATABASE_ATTRIBUTE_STRING: {
+    const int result = strcmp(left.string, right.string);
+    return (result > 0) - (result < 0);
+  }
+  default:
+    return 0;
+  }
+}
+
+struct database_sort *
+database_sort_create(struct paging_pager *pager,
+                     struct database_attributes attributes,
+                     size_t attribute_position, size_t memory_size) {
+  struct database_sort *sort = malloc(sizeof(struct database_sort));
+  if (sort == NULL) {
+    warn("Sort allocation error");
+    return NULL;
+  }
+
+  *sort = (struct database_sort){.pager = pager,
+                                 .attributes = attributes,
+                                 .attribute_position = attribute_position,
+                                 .memory_size = memory_size};
+  return sort;
+}
+
+void database_sort_destroy(struct database_sort *sort) {
+  if (sort == NULL) {
+    return;
+  }
+
+  for (size_t i = sort->items_position; i < sort->items_count; i++) {
+    database_row_destroy(sort->items[i].row);
+  }
+  free(sort->items);
+
+  for (size_t i = 0; i < sort->heap_count; i++) {
+    database_row_destroy(sort->runs[sort->heap[i]].row);
+  }
+  for (size_t i = 0; i < sort->runs_count; i++) {
+    if (!paging_chain_remove(sort->pager, sort->runs[i].chain).success) {
+      warn("Sort run remove error");
+    }
+  }
+  free(sort->runs);
+  free(sort->heap);
+  free(sort);
+}
+
+static size_t database_sort_record_size(const struct database_sort *sort,
+                                        struct database_row row) {
+  size_t size = sizeof(struct database_sort_file_row_header);
+  for (size_t i = 0; i < sort->attributes.count; i++) {
+    size += sizeof(uint64_t);
+    if (database_attributes_get(sort->attributes, i).type ==
+        DATABASE_ATTRIBUTE_STRING) {
+      size += strlen(database_attribute_values_get(row.values, i).string) + 1;
+    }
+  }
+  return size;
+}
+
+static void database_sort_record_write(const struct database_sort *sort,
+                                       struct database_row row, void *data) {
+  const struct database_sort_file_row_header header = {
+      .chain_root_page_number = row.paging_info.chain.root_page_number,
+      .page_number = row.paging_info.record_id.page_number,
+      .slot_number = row.paging_info.record_id.slot_number};
+  memcpy(data, &header, sizeof(header));
+  size_t data_offset = sizeof(header);
+
+  for (size_t i = 0; i < sort->attributes.count; i++) {
+    const union database_attribute_value value =
+        database_attribute_values_get(row.values, i);
+    switch (database_attributes_get(sort->attributes, i).type) {
+    case DATABASE_ATTRIBUTE_INTEGER:
+      memcpy((char *)data + data_offset, &value.integer, sizeof(int64_t));
+      break;
+    case DATABASE_ATTRIBUTE_FLOATING_POINT:
+      memcpy((char *)data + data_offset, &value.floating_point,
+             sizeof(double));
+      break;
+    case DATABASE_ATTRIBUTE_BOOLEAN: {
+      const uint64_t boolean = value.boolean;
+      memcpy((char *)data + data_offset, &boolean, sizeof(uint64_t));
+    } break;
+    case DATABASE_ATTRIBUTE_STRING: {
+      const uint64_t string_size = strlen(value.string) + 1;
+      memcpy((char *)data + data_offset, &string_size, sizeof(uint64_t));
+      memcpy((char *)data + data_offset + sizeof(uint64_t), value.string,
+             string_size);
+      data_offset += string_size;
+    } break;
+    }
+    data_offset += sizeof(uint64_t);
+  }
+}
+
+// Strings of the row point into the data, which the row takes
+static bool database_sort_record_read(const struct database_sort *sort,
+                                      struct paging_read_result read_result,
+                                      void *data, struct database_row *row) {
+  struct database_attribute_values values =
+      database_attribute_values_create(sort->attributes.count);
+  if (values.values == NULL) {
+    warn("Values allocation error");
+    if (read_result.is_data_owned) {
+      free(data);
+    }
+    return false;
+  }
+
+  struct database_sort_file_row_header header;
+  memcpy(&header, data, sizeof(header));
+  size_t data_offset = sizeof(header);
+
+  for (size_t i = 0; i < sort->attributes.count; i++) {
+    union database_attribute_value value;
+    switch (database_attributes_get(sort->attributes, i).type) {
+    case DATABASE_ATTRIBUTE_INTEGER:
+      memcpy(&value.integer, (char *)data + data_offset, sizeof(int64_t));
+      break;
+    case DATABASE_ATTRIBUTE_FLOATING_POINT:
+      memcpy(&value.floating_point, (char *)data + data_offset,
+             sizeof(double));
+      break;
+    case DATABASE_ATTRIBUTE_BOOLEAN: {
+      uint64_t boolean;
+      memcpy(&boolean, (char *)data + data_offset, sizeof(uint64_t));
+      value.boolean = boolean != 0;
+    } break;
+    case DATABASE_ATTRIBUTE_STRING: {
+      uint64_t string_size;
+      memcpy(&string_size, (char *)data + data_offset, sizeof(uint64_t));
+      value.string = (char *)data + data_offset + sizeof(uint64_t);
+      data_offset += string_size;
+    } break;
+    }
+    database_attribute_values_set(values, i, value);
+    data_offset += sizeof(uint64_t);
+  }
+
+  *row = (struct database_row){
+      .data = data,
+      .is_data_owned = read_result.is_data_owned,
+      .paging_info = {.chain = {header.chain_root_page_number},
+                      .record_id = {header.page_number,
+                                    (uint16_t)header.slot_number}},
+      .values = values};
+  return true;
+}
+
+static int database_sort_item_compare(const void *left, const void *right) {
+  const struct database_sort_item *left_item = left;
+  const struct database_sort_item *right_item = right;
+  return database_sort_values_compare(left_item->type, left_item->key,
+                                      right_item->key);
+}
+
+static bool database_sort_run_write(struct database_sort *sort) {
+  if (sort->runs_count == sort->runs_capacity) {
+    const size_t capacity =
+        sort->runs_capacity == 0 ? 8 : sort->runs_capacity * 2;
+    struct database_sort_run *runs =
+        realloc(sort->runs, capacity * sizeof(struct database_sort_run));
+    if (runs == NULL) {
+      warn("Sort runs allocation error");
+      return false;
+    }
+    sort->runs = runs;
+    sort->runs_capacity = capacity;
+  }
+
+  const struct paging_chain_create_result chain_result =
+      paging_chain_create(sort->pager);
+  if (!chain_result.success) {
+    warn("Sort run chain create error");
+    return false;
+  }
+  sort->runs[sort->runs_count++] =
+      (struct database_sort_run){.chain = chain_result.chain};
+
+  qsort(sort->items, sort->items_count, sizeof(struct database_sort_item),
+        database_sort_item_compare);
+
+  void *data = NULL;
+  size_t data_capacity = 0;
+  bool success = true;
+  for (size_t i = 0; success && i < sort->items_count; i++) {
+    const size_t data_size =
+        database_sort_record_size(sort, sort->items[i].row);
+    if (data_size > data_capacity) {
+      free(data);
+      data_capacity = data_size * 2;
+      data = malloc(data_capacity);
+      if (data == NULL) {
+        warn("Sort record allocation error");
+        success = false;
+        break;
+      }
+    }
+
+    database_sort_record_write(sort, sort->items[i].row, data);
+    success = paging_write(sort->pager, chain_result.chain, data, data_size)
+                  .success;
+  }
+  free(data);
+
+  for (size_t i = 0; i < sort->items_count; i++) {
+    database_row_destroy(sort->items[i].row);
+  }
+  sort->items_count = 0;
+  sort->items_size = 0;
+
+  if (!success) {
+    warn("Sort run write error");
+  }
+  return success;
+}
+
+bool database_sort_add(struct database_sort *sort, struct database_row row) {
+  const size_t row_size = database_row_size(sort->attributes, row) +
+                          sizeof(struct database_sort_item);
+  if (sort->items_count > 0 &&
+      sort->items_size + row_size > sort->memory_size &&
+      !database_sort_run_write(sort)) {
+    database_row_destroy(row);
+    return false;
+  }
+
+  if (sort->items_count == sort->items_capacity) {
+    const size_t capacity =
+        sort->items_capacity == 0 ? 64 : sort->items_capacity * 2;
+    struct database_sort_item *items =
+        realloc(sort->items, capacity * sizeof(struct database_sort_item));
+    if (items == NULL) {
+      warn("Sort items allocation error");
+      database_row_destroy(row);
+      return false;
+    }
+    sort->items = items;
+    sort->items_capacity = capacity;
+  }
+
+  sort->items[sort->items_count++] = (struct database_sort_item){
+      .type =
+          database_attributes_get(sort->attributes, sort->attribute_position)
+              .type,
+      .key =
+          database_attribute_values_get(row.values, sort->attribute_position),
+      .row = row};
+  sort->items_size += row_size;
+  return true;
+}
+
+static bool database_sort_heap_less(const struct database_sort *sort,
+                                    size_t left, size_t right) {
+  const enum database_attribute_type type =
+      database_attributes_get(sort->attributes, sort->attribute_position).type;
+  const struct database_row left_row = sort->runs[sort->heap[left]].row;
+  const struct database_row right_row = sort->runs[sort->heap[right]].row;
+  return database_sort_values_compare(
+             type,
+             database_attribute_values_get(left_row.values,
+                                           sort->attribute_position),
+             database_attribute_values_get(right_row.values,
+                                           sort->attribute_position)) < 0;
+}
+
+static void database_sort_heap_down(struct database_sort *sort,
+                                    size_t position) {
+  while (true) {
+    size_t smallest = position;
+    const size_t left = position * 2 + 1;
+    const size_t right = left + 1;
+    if (left < sort->heap_count &&
+        database_sort_heap_less(sort, left, smallest)) {
+      smallest = left;
+    }
+    if (right < sort->heap_count &&
+        database_sort_heap_less(sort, right, smallest)) {
+      smallest = right;
+    }
+    if (smallest == position) {
+      return;
+    }
+
+    const size_t run = sort->heap[position];
+    sort->heap[position] = sort->heap[smallest];
+    sort->heap[smallest] = run;
+    position = smallest;
+  }
+}
+
+// Reads the row of the run that follows the given record, or the first row
+// of the run without one
+static bool database_sort_run_read(struct database_sort *sort,
+                                   struct database_sort_run *run,
+                                   const struct paging_info *previous) {
+  void *data = NULL;
+  const struct paging_read_result read_result =
+      previous == NULL ? paging_read_first(sort->pager, run->chain, &data)
+                       : paging_read_next(sort->pager, *previous, &data);
+  if (!read_result.success) {
+    return false;
+  }
+
+  run->info = read_result.info;
+  return database_sort_record_read(sort, read_result, data, &run->row);
+}
+
+bool database_sort_finish(struct database_sort *sort) {
+  if (sort->runs_count == 0) {
+    qsort(sort->items, sort->items_count, sizeof(struct database_sort_item),
+          database_sort_item_compare);
+    return true;
+  }
+
+  if (sort->items_count > 0 && !database_sort_run_write(sort)) {
+    return false;
+  }
+
+  sort->heap = malloc(sort->runs_count * sizeof(size_t));
+  if (sort->heap == NULL) {
+    warn("Sort heap allocation error");
+    return false;
+  }
+  for (size_t i = 0; i < sort->runs_count; i++) {
+    if (database_sort_run_read(sort, &sort->runs[i], NULL)) {
+      sort->heap[sort->heap_count++] = i;
+    }
+  }
+  for (size_t i = sort->heap_count / 2; i > 0; i--) {
+    database_sort_heap_down(sort, i - 1);
+  }
+  return true;
+}
+
+struct database_sort_read_result
+database_sort_next(struct database_sort *sort) {
+  if (sort->runs_count == 0) {
+    if (sort->items_position == sort->items_count) {
+      return (struct database_sort_read_result){.success = false};
+    }
+    return (struct database_sort_read_result){
+        .success = true, .row = sort->items[sort->items_position++].row};
+  }
+
+  if (sort->heap_count == 0) {
+    return (struct database_sort_read_result){.success = false};
+  }
+
+  struct database_sort_run *run = &sort->runs[sort->heap[0]];
+  const struct database_row row = run->row;
+  const struct paging_info info = run->info;
+  if (!database_sort_run_read(sort, run, &info)) {
+    sort->heap[0] = sort->heap[--sort->heap_count];
+  }
+  database_sort_heap_down(sort, 0);
+  return (struct database_sort_read_result){.success = true, .row = row};
+}
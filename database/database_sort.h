@@ -0,0 +1,48 @@
+#ifndef ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_SORT_H
+#define ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_SORT_H
+
+#include "database_attributes.h"
+#include "database_row.h"
+#include "paging.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// External merge sort of the rows of a table by the values of one
+// attribute. Rows are kept in memory until they take more than the memory
+// size, then they are sorted and written as a run to a temporary chain of
+// the pager. Runs are merged while the rows are read back, so every row is
+// written and read once.
+struct database_sort;
+
+struct database_sort_read_result {
+  bool success;
+  struct database_row row;
+};
+
+// Orders values the way the sort does, NaN after all other numbers.
+// Returns a negative number, zero or a positive number.
+int database_sort_values_compare(enum database_attribute_type type,
+                                 union database_attribute_value left,
+                                 union database_attribute_value right);
+
+// The attributes must outlive the sort
+struct database_sort *
+database_sort_create(struct paging_pager *pager,
+                     struct database_attributes attributes,
+                     size_t attribute_position, size_t memory_size);
+
+// Removes the temporary chains, the rows read from the sort must be
+// destroyed before
+void database_sort_destroy(struct database_sort *sort);
+
+// Takes the row, which may be destroyed right away
+bool database_sort_add(struct database_sort *sort, struct database_row row);
+
+// Called once after all rows are added
+bool database_sort_finish(struct database_sort *sort);
+
+// The row is owned by the caller. Fails after the last row.
+struct database_sort_read_result
+database_sort_next(struct database_sort *sort);
+
+#endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_SORT_H
@@ -1,11 +1,73 @@
 #include "database_table.h"
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define DATABASE_TABLE_NO_ATTRIBUTE SIZE_MAX
 
 void database_table_destroy(struct database_table table) {
-  if (table.data) {
-    free(table.data);
+  if (!table.is_data_owned) {
+    return;
   }
 
+  free(table.data);
+  free(table.attribute_map.buckets);
   database_attributes_destroy(table.attributes);
 }
+
+size_t database_table_name_hash(const char *name) {
+  // FNV-1a
+  uint64_t hash = UINT64_C(0xCBF29CE484222325);
+  for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++) {
+    hash = (hash ^ *c) * UINT64_C(0x100000001B3);
+  }
+  return (size_t)hash;
+}
+
+bool database_table_attribute_map_build(struct database_table *table) {
+  size_t buckets_count = 1;
+  while (buckets_count < table->attributes.count * 2) {
+    buckets_count *= 2;
+  }
+
+  // Buckets and links share one allocation
+  size_t *buckets =
+      malloc((buckets_count + table->attributes.count) * sizeof(size_t));
+  if (buckets == NULL) {
+    return false;
+  }
+
+  size_t *next = buckets + buckets_count;
+  for (size_t i = 0; i < buckets_count; i++) {
+    buckets[i] = DATABASE_TABLE_NO_ATTRIBUTE;
+  }
+  // Inserted from the last attribute, so the first of equal names is found
+  for (size_t i = table->attributes.count; i-- > 0;) {
+    const size_t bucket =
+        database_table_name_hash(
+            database_attributes_get(table->attributes, i).name) &
+        (buckets_count - 1);
+    next[i] = buckets[bucket];
+    buckets[bucket] = i;
+  }
+
+  table->attribute_map = (struct database_table_attribute_map){
+      .buckets_count = buckets_count, .buckets = buckets, .next = next};
+  return true;
+}
+
+size_t database_table_attribute_position(struct database_table table,
+                                         const char *name) {
+  const struct database_table_attribute_map map = table.attribute_map;
+  assert(map.buckets != NULL);
+
+  size_t position =
+      map.buckets[database_table_name_hash(name) & (map.buckets_count - 1)];
+  while (position != DATABASE_TABLE_NO_ATTRIBUTE &&
+         strcmp(database_attributes_get(table.attributes, position).name,
+                name) != 0) {
+    position = map.next[position];
+  }
+  return position;
+}
@@ -6,13 +6,38 @@
 #include "paging.h"
 // #include "pa"
 
+// Attribute positions by name as a chained hash table
+struct database_table_attribute_map {
+  size_t buckets_count;
+  size_t *buckets;
+  size_t *next;
+};
+
 struct database_table {
   void *data;
+  // Tables of the catalog own their data, attributes and attribute map.
+  // Tables given out by the database borrow them from the catalog.
+  bool is_data_owned;
   char *name;
   struct paging_info page_info;
+  // Pager of the file that holds the rows of the table
+  struct paging_pager *pager;
+  struct paging_chain rows_chain;
   struct database_attributes attributes;
+  struct database_table_attribute_map attribute_map;
+  // Definitions of the indexes are read from the data when they are used
+  size_t indexes_count;
+  size_t indexes_offset;
 };
 
 void database_table_destroy(struct database_table table);
 
+size_t database_table_name_hash(const char *name);
+
+bool database_table_attribute_map_build(struct database_table *table);
+
+// Returns SIZE_MAX when the table has no attribute with the name
+size_t database_table_attribute_position(struct database_table table,
+                                         const char *name);
+
 #endif // ITMO_LOW_LEVEL_PROGRAMMING_LAB1_DATABASE_TABLE_H
@@ -451,6 +451,44 @@ bool database_where_joined_is_satisfied(struct database_table left_table,
   }
 }
 
+bool database_where_uses_attribute(struct database_where where,
+                                   size_t attribute_position) {
+  switch (where.type) {
+  case DATABASE_WHERE_TYPE_ALWAYS:
+    return false;
+
+  case DATABASE_WHERE_TYPE_LOGIC:
+    return database_where_uses_attribute(*where.value.logic.left,
+                                         attribute_position) ||
+           database_where_uses_attribute(*where.value.logic.right,
+                                         attribute_position);
+
+  case DATABASE_WHERE_TYPE_COMPARISON: {
+    const struct database_where_comparison comparison =
+        where.value.comparison;
+    return (comparison.left.type == DATABASE_WHERE_COMPARISON_ITEM_ATTRIBUTE &&
+            comparison.left.value.attribute.attribute_position ==
+                attribute_position) ||
+           (comparison.right.type == DATABASE_WHERE_COMPARISON_ITEM_ATTRIBUTE &&
+            comparison.right.value.attribute.attribute_position ==
+                attribute_position);
+  }
+
+  case DATABASE_WHERE_TYPE_CONTAINS: {
+    const struct database_where_contains contains = where.value.contains;
+    return (contains.left.type == DATABASE_WHERE_CONTAINS_ITEM_ATTRIBUTE &&
+            contains.left.value.attribute.attribute_position ==
+                attribute_position) ||
+           (contains.right.type == DATABASE_WHERE_CONTAINS_ITEM_ATTRIBUTE &&
+            contains.right.value.attribute.attribute_position ==
+                attribute_position);
+  }
+
+  default:
+    return true;
+  }
+}
+
 void database_where_destroy(struct database_where where) {
   switch (where.type) {
   case DATABASE_WHERE_TYPE_ALWAYS:
@@ -184,6 +184,10 @@ bool database_where_joined_is_satisfied(struct database_table left_table,
                                         struct database_row right_row,
                                         struct database_where_joined where);
 
+// Tells whether evaluating the condition reads the attribute of the row
+bool database_where_uses_attribute(struct database_where where,
+                                   size_t attribute_position);
+
 void database_where_destroy(struct database_where where);
 
 void database_where_joined_destroy(struct database_where_joined where);
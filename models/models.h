@@ -12,9 +12,16 @@ enum sql_data_type {
   SQL_DATA_TYPE_TEXT
 };
 
+enum sql_column_constraint {
+  SQL_COLUMN_CONSTRAINT_NONE,
+  SQL_COLUMN_CONSTRAINT_UNIQUE,
+  SQL_COLUMN_CONSTRAINT_PRIMARY_KEY
+};
+
 struct sql_column_with_type {
   char *name;
   enum sql_data_type type;
+  enum sql_column_constraint constraint;
 };
 
 struct sql_column_with_type_list {
@@ -169,6 +176,19 @@ struct sql_drop_statement {
   char *table_name;
 };
 
+enum sql_index_method { SQL_INDEX_METHOD_BTREE, SQL_INDEX_METHOD_HASH };
+
+struct sql_create_index_statement {
+  char *index_name;
+  char *table_name;
+  char *column;
+  enum sql_index_method method;
+};
+
+struct sql_drop_index_statement {
+  char *index_name;
+};
+
 struct sql_insert_statement {
   char *table_name;
   struct sql_literal_list *values;
@@ -197,7 +217,9 @@ enum sql_statement_type {
   SQL_STATEMENT_TYPE_INSERT,
   SQL_STATEMENT_TYPE_SELECT,
   SQL_STATEMENT_TYPE_DELETE,
-  SQL_STATEMENT_TYPE_UPDATE
+  SQL_STATEMENT_TYPE_UPDATE,
+  SQL_STATEMENT_TYPE_CREATE_INDEX,
+  SQL_STATEMENT_TYPE_DROP_INDEX
 };
 
 union sql_statement_value {
@@ -207,6 +229,8 @@ union sql_statement_value {
   struct sql_select_statement select;
   struct sql_delete_statement delete;
   struct sql_update_statement update;
+  struct sql_create_index_statement create_index;
+  struct sql_drop_index_statement drop_index;
 };
 
 struct sql_statement {
@@ -24,6 +24,25 @@ static bool data_type_from_string(enum sql_data_type *ret, const char *string) {
   return true;
 }
 
+static const char *column_constraint_to_string[] = {
+    [SQL_COLUMN_CONSTRAINT_NONE] = "none",
+    [SQL_COLUMN_CONSTRAINT_UNIQUE] = "unique",
+    [SQL_COLUMN_CONSTRAINT_PRIMARY_KEY] = "primary_key",
+};
+
+static bool column_constraint_from_string(enum sql_column_constraint *ret,
+                                          const char *string) {
+  if (strcmp(string, "none") == 0)
+    *ret = SQL_COLUMN_CONSTRAINT_NONE;
+  else if (strcmp(string, "unique") == 0)
+    *ret = SQL_COLUMN_CONSTRAINT_UNIQUE;
+  else if (strcmp(string, "primary_key") == 0)
+    *ret = SQL_COLUMN_CONSTRAINT_PRIMARY_KEY;
+  else
+    return false;
+  return true;
+}
+
 static const char *comparison_operator_to_string[] = {
     [SQL_COMPARISON_OPERATOR_EQUAL] = "EQUAL",
     [SQL_COMPARISON_OPERATOR_NOT_EQUAL] = "NOT_EQUAL",
@@ -68,6 +87,22 @@ static bool logic_operator_from_string(enum sql_logic_binary_operator *ret,
   return true;
 }
 
+static const char *index_method_to_string[] = {
+    [SQL_INDEX_METHOD_BTREE] = "btree",
+    [SQL_INDEX_METHOD_HASH] = "hash",
+};
+
+static bool index_method_from_string(enum sql_index_method *ret,
+                                     const char *string) {
+  if (strcmp(string, "btree") == 0)
+    *ret = SQL_INDEX_METHOD_BTREE;
+  else if (strcmp(string, "hash") == 0)
+    *ret = SQL_INDEX_METHOD_HASH;
+  else
+    return false;
+  return true;
+}
+
 static cJSON *serialize_column_with_type(struct sql_column_with_type column) {
   cJSON *result = cJSON_CreateObject();
   if (result == NULL)
@@ -75,7 +110,10 @@ static cJSON *serialize_column_with_type(struct sql_column_with_type column) {
 
   if (cJSON_AddStringToObject(result, "name", column.name) == NULL ||
       cJSON_AddStringToObject(result, "type",
-                              data_type_to_string[column.type]) == NULL) {
+                              data_type_to_string[column.type]) == NULL ||
+      cJSON_AddStringToObject(
+          result, "constraint",
+          column_constraint_to_string[column.constraint]) == NULL) {
     cJSON_Delete(result);
     return NULL;
   }
@@ -90,9 +128,13 @@ static bool deserialize_column_with_type(struct sql_column_with_type *column,
 
   const cJSON *nameJSON = cJSON_GetObjectItem(json, "name");
   const cJSON *typeJSON = cJSON_GetObjectItem(json, "type");
-  if (nameJSON == NULL || typeJSON == NULL || !cJSON_IsString(nameJSON) ||
-      !cJSON_IsString(typeJSON) ||
-      !data_type_from_string(&column->type, typeJSON->valuestring))
+  const cJSON *constraintJSON = cJSON_GetObjectItem(json, "constraint");
+  if (nameJSON == NULL || typeJSON == NULL || constraintJSON == NULL ||
+      !cJSON_IsString(nameJSON) || !cJSON_IsString(typeJSON) ||
+      !cJSON_IsString(constraintJSON) ||
+      !data_type_from_string(&column->type, typeJSON->valuestring) ||
+      !column_constraint_from_string(&column->constraint,
+                                     constraintJSON->valuestring))
     return false;
 
   column->name = strdup(nameJSON->valuestring);
@@ -765,6 +807,79 @@ static bool deserialize_drop_statement(struct sql_drop_statement *statement,
   return true;
 }
 
+static cJSON *
+serialize_create_index_statement(struct sql_create_index_statement statement) {
+  cJSON *result = cJSON_CreateObject();
+  if (result == NULL)
+    return NULL;
+
+  if (cJSON_AddStringToObject(result, "index_name", statement.index_name) ==
+          NULL ||
+      cJSON_AddStringToObject(result, "table_name", statement.table_name) ==
+          NULL ||
+      cJSON_AddStringToObject(result, "column", statement.column) == NULL ||
+      cJSON_AddStringToObject(result, "method",
+                              index_method_to_string[statement.method]) ==
+          NULL) {
+    cJSON_Delete(result);
+    return NULL;
+  }
+
+  return result;
+}
+
+static bool
+deserialize_create_index_statement(struct sql_create_index_statement *statement,
+                                   const cJSON *json) {
+  if (!cJSON_IsObject(json))
+    return false;
+
+  const cJSON *index_nameJSON = cJSON_GetObjectItem(json, "index_name");
+  const cJSON *table_nameJSON = cJSON_GetObjectItem(json, "table_name");
+  const cJSON *columnJSON = cJSON_GetObjectItem(json, "column");
+  const cJSON *methodJSON = cJSON_GetObjectItem(json, "method");
+  if (index_nameJSON == NULL || table_nameJSON == NULL || columnJSON == NULL ||
+      methodJSON == NULL || !cJSON_IsString(index_nameJSON) ||
+      !cJSON_IsString(table_nameJSON) || !cJSON_IsString(columnJSON) ||
+      !cJSON_IsString(methodJSON) ||
+      !index_method_from_string(&statement->method, methodJSON->valuestring))
+    return false;
+
+  statement->index_name = strdup(index_nameJSON->valuestring);
+  statement->table_name = strdup(table_nameJSON->valuestring);
+  statement->column = strdup(columnJSON->valuestring);
+  return true;
+}
+
+static cJSON *
+serialize_drop_index_statement(struct sql_drop_index_statement statement) {
+  cJSON *result = cJSON_CreateObject();
+  if (result == NULL)
+    return NULL;
+
+  if (cJSON_AddStringToObject(result, "index_name", statement.index_name) ==
+      NULL) {
+    cJSON_Delete(result);
+    return NULL;
+  }
+
+  return result;
+}
+
+static bool
+deserialize_drop_index_statement(struct sql_drop_index_statement *statement,
+                                 const cJSON *json) {
+  if (!cJSON_IsObject(json))
+    return false;
+
+  const cJSON *index_nameJSON = cJSON_GetObjectItem(json, "index_name");
+  if (index_nameJSON == NULL || !cJSON_IsString(index_nameJSON))
+    return false;
+
+  statement->index_name = strdup(index_nameJSON->valuestring);
+  return true;
+}
+
 static cJSON *
 serialize_select_statement(struct sql_select_statement statement) {
   cJSON *result = cJSON_CreateObject();
@@ -989,6 +1104,24 @@ static cJSON *serialize_statement(struct sql_statement statement) {
       return NULL;
     }
   } break;
+  case SQL_STATEMENT_TYPE_CREATE_INDEX: {
+    cJSON *create_index =
+        serialize_create_index_statement(statement.value.create_index);
+    if (create_index == NULL ||
+        !cJSON_AddItemToObject(result, "create_index", create_index)) {
+      cJSON_Delete(result);
+      return NULL;
+    }
+  } break;
+  case SQL_STATEMENT_TYPE_DROP_INDEX: {
+    cJSON *drop_index =
+        serialize_drop_index_statement(statement.value.drop_index);
+    if (drop_index == NULL ||
+        !cJSON_AddItemToObject(result, "drop_index", drop_index)) {
+      cJSON_Delete(result);
+      return NULL;
+    }
+  } break;
   }
 
   return result;
@@ -1005,8 +1138,11 @@ static bool deserialize_statement(struct sql_statement *statement,
   const cJSON *selectJSON = cJSON_GetObjectItem(json, "select");
   const cJSON *deleteJSON = cJSON_GetObjectItem(json, "delete");
   const cJSON *updateJSON = cJSON_GetObjectItem(json, "update");
+  const cJSON *create_indexJSON = cJSON_GetObjectItem(json, "create_index");
+  const cJSON *drop_indexJSON = cJSON_GetObjectItem(json, "drop_index");
   if (createJSON == NULL && dropJSON == NULL && insertJSON == NULL &&
-      selectJSON == NULL && deleteJSON == NULL && updateJSON == NULL)
+      selectJSON == NULL && deleteJSON == NULL && updateJSON == NULL &&
+      create_indexJSON == NULL && drop_indexJSON == NULL)
     return false;
 
   if (createJSON != NULL) {
@@ -1039,6 +1175,18 @@ static bool deserialize_statement(struct sql_statement *statement,
       return false;
     statement->type = SQL_STATEMENT_TYPE_UPDATE;
   }
+  if (create_indexJSON != NULL) {
+    if (!deserialize_create_index_statement(&statement->value.create_index,
+                                            create_indexJSON))
+      return false;
+    statement->type = SQL_STATEMENT_TYPE_CREATE_INDEX;
+  }
+  if (drop_indexJSON != NULL) {
+    if (!deserialize_drop_index_statement(&statement->value.drop_index,
+                                          drop_indexJSON))
+      return false;
+    statement->type = SQL_STATEMENT_TYPE_DROP_INDEX;
+  }
 
   return true;
 }
@@ -1,82 +1,420 @@
 #include "paging.h"
 #include "logger.h"
 #include "math_utils.h"
-
+#include "paging_buffer_pool.h"
+#include "paging_extents.h"
+#include "paging_fsm.h"
+#include "paging_io.h"
+#include "paging_lz.h"
+#include "paging_mmap.h"
+#include "paging_uring.h"
+#include "paging_wal.h"
+#include "paging_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// "LAB3PAGE" in little endian
+#define PAGING_FILE_MAGIC UINT64_C(0x454741503342414C)
 
-#define PAGING_PAGE_DATA_SIZE (1024)
+#define PAGING_PAGE_SIZE_MIN (4096)
+#define PAGING_PAGE_SIZE_MAX (65536)
+
+// A compressed page has to leave at least one block of its place free
+#define PAGING_COMPRESSED_PAGE_SIZE_MIN (2 * PAGING_LZ_BLOCK_SIZE)
 
 #define PAGING_INVALID_PAGE_NUMBER UINT64_MAX
 
+#define PAGING_FILE_GROW_SIZE ((size_t)1 << 20)
+
+#define PAGING_RECORD_ALIGNMENT (8)
+
+#define PAGING_SLOT_FLAG_OVERFLOW (1)
+
+#define PAGING_URING_ENTRIES (64)
+
+// Commits checkpoint the log themselves once it grows this many times past
+// the checkpoint size, which happens only when the background writer cannot
+// keep up with them
+#define PAGING_WAL_CHECKPOINT_BACKLOG (4)
+
+// Pages of the chain being scanned that were prefetched ahead of the scan,
+// in chain order. Kept in a ring of capacity page numbers.
+struct paging_readahead {
+  uint64_t current_page_number;
+  size_t head;
+  size_t count;
+  size_t capacity;
+  uint64_t *page_numbers;
+};
+
+struct paging_pager_stats {
+  struct paging_stats stats;
+  // Where the last transfer to or from the file ended
+  uint64_t io_end_position;
+};
+
 struct paging_pager {
   FILE *file;
+  int fd;
+  enum paging_backend backend;
+  struct paging_buffer_pool *buffer_pool;
+  struct paging_mmap *mmap;
+  struct paging_wal *wal;
+  // Checkpoints the log in the background, commits do it when NULL
+  struct paging_writer *writer;
+  // Asynchronous I/O of the buffered backend, synchronous I/O when NULL
+  struct paging_uring *uring;
+  uint64_t wal_checkpoint_size;
+  // Changed by reads, so it lives outside of the pager
+  struct paging_readahead *readahead;
+  // Also updated by scans
+  struct paging_fsm *fsm;
+  // Changed by reads too, so it lives outside of the pager
+  struct paging_pager_stats *stats;
+  size_t page_size;
+  size_t page_data_size;
+  enum paging_compression compression;
+  // Scratch page for compaction
+  void *page_buffer;
+  // Scratch page for compression, pages may be written back in the middle
+  // of a compaction
+  void *codec_buffer;
+  struct paging_extents *free_extents;
+  // Pages in use or free, the file may be preallocated past them
+  uint64_t pages_count;
+  uint64_t allocated_pages_count;
   uint64_t first_free_page_number;
-  uint64_t first_page_type_1_page_number;
-  uint64_t first_page_type_2_page_number;
-  uint64_t first_page_type_3_page_number;
+  uint64_t root_chain_page_number;
+  // The header is written only by commits that follow a change of the
+  // fields above
+  bool is_header_dirty;
 };
 
+// Heap pages start with a slot directory that grows towards the end of the
+// page, while records are placed from the end of the page backwards. Offsets
+// are relative to the page data.
 struct paging_file_page_header {
   uint64_t next_page_number;
-  uint64_t next_continuation;
+  uint64_t previous_page_number;
+  // Last page of the chain in a chain root page, last page of the extent in
+  // the first page of a free extent
+  uint64_t last_page_number;
+  uint16_t slots_count;
+  uint16_t free_space_end;
+  uint16_t fragmented_size;
+};
+
+// A slot with zero offset is free
+struct paging_file_slot {
+  uint16_t offset;
+  uint16_t size;
+  uint16_t flags;
+};
+
+struct paging_file_overflow {
+  uint64_t size;
+  uint64_t first_page_number;
 };
 
+// Page 0 holds the file header, so that all other pages start at offsets
+// aligned to the page size.
 struct paging_file_header {
+  uint64_t magic;
+  uint64_t page_size;
+  uint64_t pages_count;
   uint64_t first_free_page_number;
-  uint64_t first_page_type_1_page_number;
-  uint64_t first_page_type_2_page_number;
-  uint64_t first_page_type_3_page_number;
+  uint64_t root_chain_page_number;
+  uint64_t compression;
 };
 
-static bool paging_file_header_read(struct paging_pager *pager) {
-  const int seek_result = fseek(pager->file, 0, SEEK_SET);
-  if (seek_result != 0) {
+static bool paging_page_size_is_valid(size_t page_size) {
+  return page_size >= PAGING_PAGE_SIZE_MIN &&
+         page_size <= PAGING_PAGE_SIZE_MAX &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+static bool paging_file_header_read(FILE *file,
+                                    struct paging_file_header *header) {
+  if (!paging_io_read(fileno(file), header, sizeof(*header), 0)) {
     return false;
   }
 
-  struct paging_file_header header;
-  const size_t read_count = 1;
-  const size_t read_result =
-      fread(&header, sizeof(header), read_count, pager->file);
-  if (read_result != read_count) {
+  if (header->magic != PAGING_FILE_MAGIC) {
+    warn("File is not a database file");
     return false;
   }
 
-  pager->first_free_page_number = header.first_free_page_number;
-  pager->first_page_type_1_page_number = header.first_page_type_1_page_number;
-  pager->first_page_type_2_page_number = header.first_page_type_2_page_number;
-  pager->first_page_type_3_page_number = header.first_page_type_3_page_number;
-
-  return true;
-}
+  if (!paging_page_size_is_valid(header->page_size)) {
+    warn("Unsupported page size %" PRIu64, header->page_size);
+    return false;
+  }
 
-static bool paging_file_header_write(struct paging_pager *pager) {
-  const int seek_result = fseek(pager->file, 0, SEEK_SET);
-  if (seek_result != 0) {
+  if (header->compression > PAGING_COMPRESSION_LZ) {
+    warn("Unsupported compression %" PRIu64, header->compression);
     return false;
   }
 
-  struct paging_file_header header = {
+  return true;
+}
+
+static struct paging_file_header
+paging_file_header_make(const struct paging_pager *pager) {
+  return (struct paging_file_header){
+      .magic = PAGING_FILE_MAGIC,
+      .page_size = pager->page_size,
+      .pages_count = pager->pages_count,
       .first_free_page_number = pager->first_free_page_number,
-      .first_page_type_1_page_number = pager->first_page_type_1_page_number,
-      .first_page_type_2_page_number = pager->first_page_type_2_page_number,
-      .first_page_type_3_page_number = pager->first_page_type_3_page_number,
+      .root_chain_page_number = pager->root_chain_page_number,
+      .compression = pager->compression,
   };
-  const size_t write_count = 1;
-  const size_t write_result =
-      fwrite(&header, sizeof(header), write_count, pager->file);
-  if (write_result != write_count) {
+}
+
+static bool paging_file_header_write(struct paging_pager *pager) {
+  const struct paging_file_header header = paging_file_header_make(pager);
+  return paging_io_write(pager->fd, &header, sizeof(header), 0);
+}
+
+static bool paging_allocated_pages_count_read(struct paging_pager *pager) {
+  struct stat file_stat;
+  if (fstat(pager->fd, &file_stat) != 0 ||
+      file_stat.st_size < (off_t)sizeof(struct paging_file_header)) {
     return false;
   }
 
+  pager->allocated_pages_count =
+      DIV_ROUND_UP((uint64_t)file_stat.st_size, pager->page_size);
   return true;
 }
 
-struct paging_pager *paging_pager_create_and_init(FILE *file) {
-  if (file == NULL) {
+static long paging_page_position(const struct paging_pager *pager,
+                                 uint64_t page_number) {
+  return (long)(page_number * pager->page_size);
+}
+
+static uint64_t paging_time_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+static void paging_stats_histogram_add(struct paging_stats_histogram *histogram,
+                                       uint64_t start_ns) {
+  const uint64_t time_ns = paging_time_ns() - start_ns;
+  size_t bucket = 0;
+  while (bucket + 1 < PAGING_STATS_HISTOGRAM_BUCKETS &&
+         time_ns >> (bucket + 1) != 0) {
+    bucket++;
+  }
+
+  histogram->buckets[bucket]++;
+  histogram->count++;
+  histogram->total_ns += time_ns;
+  histogram->max_ns = MAX(histogram->max_ns, time_ns);
+}
+
+static void paging_stats_transfer_add(const struct paging_pager *pager,
+                                      uint64_t position, uint64_t size) {
+  if (position != pager->stats->io_end_position) {
+    pager->stats->stats.seeks_count++;
+  }
+  pager->stats->io_end_position = position + size;
+}
+
+// Queues the transfer when io_uring is used, it is complete after
+// paging_pages_wait then
+static bool paging_pages_transfer(const struct paging_pager *pager,
+                                  bool is_write, struct iovec *vectors,
+                                  size_t count, uint64_t first_page_number) {
+  const long position = paging_page_position(pager, first_page_number);
+  paging_stats_transfer_add(pager, (uint64_t)position,
+                            count * pager->page_size);
+  if (pager->uring != NULL) {
+    return is_write
+               ? paging_uring_writev(pager->uring, vectors, (int)count,
+                                     position)
+               : paging_uring_readv(pager->uring, vectors, (int)count,
+                                    position);
+  }
+
+  return is_write ? paging_io_writev(pager->fd, vectors, (int)count, position)
+                  : paging_io_readv(pager->fd, vectors, (int)count, position);
+}
+
+static bool paging_pages_wait(void *context) {
+  struct paging_pager *pager = context;
+  return pager->uring == NULL || paging_uring_wait(pager->uring);
+}
+
+static bool paging_pages_read(void *context, uint64_t first_page_number,
+                              void *const *pages, size_t count) {
+  struct paging_pager *pager = context;
+  struct paging_stats *stats = &pager->stats->stats;
+  const uint64_t start_ns = paging_time_ns();
+  stats->page_reads_count += count;
+  stats->read_calls_count++;
+  stats->bytes_read += count * pager->page_size;
+
+  // Pages that have images in the log split the run, the pieces between
+  // them are read from the file with one call each. With io_uring the
+  // pieces are in flight together.
+  struct iovec vectors[PAGING_BUFFER_POOL_RUN_MAX];
+  bool is_in_log[PAGING_BUFFER_POOL_RUN_MAX] = {false};
+  size_t vectors_count = 0;
+  bool success = true;
+  for (size_t i = 0; success && i <= count; i++) {
+    if (i < count && pager->wal != NULL) {
+      const struct paging_wal_read_result result = paging_wal_read(
+          pager->wal, first_page_number + i, pages[i], pager->page_size);
+      success = result.success;
+      is_in_log[i] = result.is_found;
+    }
+
+    if (success && i < count && !is_in_log[i]) {
+      vectors[vectors_count++] =
+          (struct iovec){.iov_base = pages[i], .iov_len = pager->page_size};
+      continue;
+    }
+
+    const uint64_t page_number = first_page_number + i - vectors_count;
+    success = success && (vectors_count == 0 ||
+                          paging_pages_transfer(pager, false, vectors,
+                                                vectors_count, page_number));
+    vectors_count = 0;
+  }
+
+  // Pages must not be handed out while reads into them are in flight
+  success = paging_pages_wait(pager) && success;
+
+  // Images in the log are never compressed
+  for (size_t i = 0;
+       success && pager->compression != PAGING_COMPRESSION_NONE && i < count;
+       i++) {
+    if (!is_in_log[i] && paging_lz_page_decode(pages[i], pager->codec_buffer,
+                                               pager->page_size)) {
+      memcpy(pages[i], pager->codec_buffer, pager->page_size);
+    }
+  }
+
+  paging_stats_histogram_add(&stats->read_latency, start_ns);
+  return success;
+}
+
+static bool paging_pages_write_run(struct paging_pager *pager,
+                                   uint64_t first_page_number,
+                                   const void *const *pages, size_t count) {
+  if (pager->wal != NULL) {
+    return paging_wal_append_pages(pager->wal, first_page_number, pages,
+                                   count, pager->page_size);
+  }
+
+  // Compressed pages have different sizes, so they are written one by one
+  // and synchronously
+  if (pager->compression != PAGING_COMPRESSION_NONE) {
+    bool success = true;
+    for (size_t i = 0; success && i < count; i++) {
+      const long position = paging_page_position(pager, first_page_number + i);
+      paging_stats_transfer_add(pager, (uint64_t)position, pager->page_size);
+      success = paging_lz_page_write(pager->fd, pages[i], pager->page_size,
+                                     (uint64_t)position, pager->codec_buffer);
+    }
+    return success;
+  }
+
+  struct iovec vectors[PAGING_BUFFER_POOL_RUN_MAX];
+  for (size_t i = 0; i < count; i++) {
+    vectors[i] = (struct iovec){.iov_base = (void *)pages[i],
+                                .iov_len = pager->page_size};
+  }
+  return paging_pages_transfer(pager, true, vectors, count, first_page_number);
+}
+
+static bool paging_pages_write(void *context, uint64_t first_page_number,
+                               const void *const *pages, size_t count) {
+  struct paging_pager *pager = context;
+  struct paging_stats *stats = &pager->stats->stats;
+  const uint64_t start_ns = paging_time_ns();
+  stats->page_writes_count += count;
+  stats->write_calls_count++;
+  stats->bytes_written += count * pager->page_size;
+
+  const bool success =
+      paging_pages_write_run(pager, first_page_number, pages, count);
+  paging_stats_histogram_add(&stats->write_latency, start_ns);
+  return success;
+}
+
+static void paging_readahead_destroy(struct paging_readahead *readahead) {
+  if (readahead == NULL) {
+    return;
+  }
+
+  free(readahead->page_numbers);
+  free(readahead);
+}
+
+static struct paging_readahead *paging_readahead_create(size_t capacity) {
+  struct paging_readahead *readahead = malloc(sizeof(struct paging_readahead));
+  if (readahead == NULL) {
+    return NULL;
+  }
+
+  readahead->current_page_number = PAGING_INVALID_PAGE_NUMBER;
+  readahead->head = 0;
+  readahead->count = 0;
+  readahead->capacity = capacity;
+  readahead->page_numbers = malloc(capacity * sizeof(uint64_t));
+  if (readahead->page_numbers == NULL) {
+    free(readahead);
+    return NULL;
+  }
+
+  return readahead;
+}
+
+// Runs in the background writer thread, which touches only the log and the
+// file descriptor
+static bool paging_wal_checkpoint_step(void *context) {
+  const struct paging_pager *pager = context;
+  return paging_wal_checkpoint_incremental(pager->wal, pager->fd);
+}
+
+// Releases the pager without committing, uncommitted changes may be lost
+static void paging_pager_free(struct paging_pager *pager) {
+  paging_writer_destroy(pager->writer);
+  paging_buffer_pool_destroy(pager->buffer_pool);
+  paging_uring_destroy(pager->uring);
+  paging_mmap_destroy(pager->mmap,
+                      paging_page_position(pager, pager->pages_count));
+  paging_wal_destroy(pager->wal);
+  paging_readahead_destroy(pager->readahead);
+  paging_fsm_destroy(pager->fsm);
+  free(pager->stats);
+  free(pager->page_buffer);
+  free(pager->codec_buffer);
+  paging_extents_destroy(pager->free_extents);
+  free(pager);
+}
+
+static struct paging_pager *
+paging_pager_create(FILE *file, struct paging_options options,
+                    size_t page_size, enum paging_compression compression) {
+  if (options.wal_file != NULL && options.backend == PAGING_BACKEND_MMAP) {
+    warn("Write-ahead log is not supported by the mmap backend");
+    return NULL;
+  }
+
+  if (compression != PAGING_COMPRESSION_NONE &&
+      options.backend == PAGING_BACKEND_MMAP) {
+    warn("Compression is not supported by the mmap backend");
     return NULL;
   }
 
@@ -85,30 +423,187 @@ struct paging_pager *paging_pager_create_and_init(FILE *file) {
     return NULL;
   }
 
+  // Pages and the header are read and written through the descriptor, so
+  // nothing may stay buffered in the stream
+  fflush(file);
   pager->file = file;
+  pager->fd = fileno(file);
+  pager->backend = options.backend;
+  pager->page_size = page_size;
+  pager->page_data_size = page_size - sizeof(struct paging_file_page_header);
+  pager->compression = compression;
+  pager->wal_checkpoint_size = options.wal_checkpoint_size;
+  pager->pages_count = 0;
+  pager->allocated_pages_count = 0;
+  pager->is_header_dirty = false;
+  pager->buffer_pool = NULL;
+  pager->mmap = NULL;
+  pager->wal = NULL;
+  pager->writer = NULL;
+  pager->uring = NULL;
+  pager->readahead = NULL;
+  pager->page_buffer = malloc(page_size);
+  pager->codec_buffer =
+      compression != PAGING_COMPRESSION_NONE ? malloc(page_size) : NULL;
+  pager->free_extents = paging_extents_create();
+  // Pages are worth filling again once an eighth of them is free
+  pager->fsm = paging_fsm_create(pager->page_data_size / 8);
+  pager->stats = calloc(1, sizeof(struct paging_pager_stats));
+  if (pager->page_buffer == NULL || pager->free_extents == NULL ||
+      pager->fsm == NULL || pager->stats == NULL ||
+      (compression != PAGING_COMPRESSION_NONE && pager->codec_buffer == NULL)) {
+    paging_pager_free(pager);
+    return NULL;
+  }
+
+  if (options.readahead_pages_count > 0) {
+    pager->readahead = paging_readahead_create(options.readahead_pages_count);
+    if (pager->readahead == NULL) {
+      paging_pager_free(pager);
+      return NULL;
+    }
+  }
+
+  if (options.wal_file != NULL) {
+    pager->wal = paging_wal_create(options.wal_file, page_size,
+                                   compression != PAGING_COMPRESSION_NONE);
+    if (pager->wal == NULL) {
+      warn("Write-ahead log creation error");
+      paging_pager_free(pager);
+      return NULL;
+    }
+  }
+
+  if (pager->wal != NULL && options.wal_checkpoint_interval_ms > 0) {
+    const struct paging_writer_step step = {
+        .context = pager, .run = paging_wal_checkpoint_step};
+    pager->writer =
+        paging_writer_create(step, options.wal_checkpoint_interval_ms);
+    if (pager->writer == NULL) {
+      info("Background writer is unavailable, commits checkpoint the log");
+    }
+  }
+
+  switch (options.backend) {
+  case PAGING_BACKEND_BUFFERED: {
+    if (options.io_engine == PAGING_IO_ENGINE_IO_URING) {
+      pager->uring = paging_uring_create(pager->fd, PAGING_URING_ENTRIES);
+      if (pager->uring == NULL) {
+        info("io_uring is unavailable, using synchronous I/O");
+      }
+    }
+
+    const struct paging_buffer_pool_io io = {.context = pager,
+                                             .read_pages = paging_pages_read,
+                                             .write_pages = paging_pages_write,
+                                             .wait = paging_pages_wait};
+    pager->buffer_pool = paging_buffer_pool_create(
+        io, options.buffer_pool_frames_count, page_size);
+    if (pager->buffer_pool == NULL) {
+      warn("Buffer pool creation error");
+      paging_pager_free(pager);
+      return NULL;
+    }
+  } break;
+  case PAGING_BACKEND_MMAP:
+    if (options.io_engine == PAGING_IO_ENGINE_IO_URING) {
+      info("io_uring is not used by the mmap backend");
+    }
+    pager->mmap = paging_mmap_create(file);
+    if (pager->mmap == NULL) {
+      warn("File mapping creation error");
+      paging_pager_free(pager);
+      return NULL;
+    }
+    break;
+  }
+
+  return pager;
+}
+
+struct paging_pager *
+paging_pager_create_and_init(FILE *file, struct paging_options options) {
+  if (file == NULL) {
+    return NULL;
+  }
+
+  if (!paging_page_size_is_valid(options.page_size)) {
+    warn("Unsupported page size %zu", options.page_size);
+    return NULL;
+  }
+
+  if (options.compression != PAGING_COMPRESSION_NONE &&
+      options.page_size < PAGING_COMPRESSED_PAGE_SIZE_MIN) {
+    warn("Compressed pages must be at least %d bytes",
+         PAGING_COMPRESSED_PAGE_SIZE_MIN);
+    return NULL;
+  }
+
+  struct paging_pager *pager = paging_pager_create(
+      file, options, options.page_size, options.compression);
+  if (pager == NULL) {
+    return NULL;
+  }
+
+  // Page 0 is the file header
+  pager->pages_count = 1;
   pager->first_free_page_number = PAGING_INVALID_PAGE_NUMBER;
-  pager->first_page_type_1_page_number = PAGING_INVALID_PAGE_NUMBER;
-  pager->first_page_type_2_page_number = PAGING_INVALID_PAGE_NUMBER;
-  pager->first_page_type_3_page_number = PAGING_INVALID_PAGE_NUMBER;
-  if (!paging_file_header_write(pager)) {
+  pager->root_chain_page_number = PAGING_INVALID_PAGE_NUMBER;
+  pager->is_header_dirty = true;
+
+  const struct paging_chain_create_result root_chain_result =
+      paging_chain_create(pager);
+  if (!root_chain_result.success) {
+    paging_pager_free(pager);
+    return NULL;
+  }
+
+  // The new file is written out completely, so that it can be opened
+  // without its log
+  pager->root_chain_page_number = root_chain_result.chain.root_page_number;
+  if (!paging_commit(pager).success ||
+      (pager->wal != NULL && !paging_wal_checkpoint(pager->wal, file))) {
+    paging_pager_free(pager);
     return NULL;
   }
 
   return pager;
 }
 
-struct paging_pager *paging_pager_init(FILE *file) {
+static bool paging_free_extents_read(struct paging_pager *pager);
+
+struct paging_pager *paging_pager_init(FILE *file,
+                                       struct paging_options options) {
   if (file == NULL) {
     return NULL;
   }
 
-  struct paging_pager *pager = malloc(sizeof(struct paging_pager));
+  fflush(file);
+  struct paging_file_header header;
+  if (!paging_file_header_read(file, &header)) {
+    return NULL;
+  }
+
+  struct paging_pager *pager = paging_pager_create(
+      file, options, header.page_size,
+      (enum paging_compression)header.compression);
   if (pager == NULL) {
     return NULL;
   }
 
-  pager->file = file;
-  if (!paging_file_header_read(pager)) {
+  // Commits recovered from the log are applied before anything is read
+  if (pager->wal != NULL && (!paging_wal_checkpoint(pager->wal, file) ||
+                             !paging_file_header_read(file, &header))) {
+    paging_pager_free(pager);
+    return NULL;
+  }
+
+  pager->pages_count = header.pages_count;
+  pager->first_free_page_number = header.first_free_page_number;
+  pager->root_chain_page_number = header.root_chain_page_number;
+  if (!paging_allocated_pages_count_read(pager) ||
+      !paging_free_extents_read(pager)) {
+    paging_pager_free(pager);
     return NULL;
   }
 
@@ -119,360 +614,1558 @@ void paging_pager_destroy(struct paging_pager *pager) {
   if (pager == NULL) {
     return;
   }
-  free(pager);
-}
 
-static long paging_file_page_header_position(uint64_t page_number) {
-  const long page_size =
-      (long)sizeof(struct paging_file_page_header) + PAGING_PAGE_DATA_SIZE;
-  return (long)sizeof(struct paging_file_header) +
-         (long)page_number * page_size;
-}
+  if (!paging_commit(pager).success) {
+    warn("Commit on pager destroy error");
+  } else if (pager->wal != NULL &&
+             !paging_wal_checkpoint(pager->wal, pager->file)) {
+    warn("Checkpoint on pager destroy error");
+  }
 
-static long paging_file_page_data_position(uint64_t page_number) {
-  return paging_file_page_header_position(page_number) +
-         (long)sizeof(struct paging_file_page_header);
+  paging_pager_free(pager);
 }
 
-static uint64_t paging_new_page_number(struct paging_pager *pager) {
-  if (fseek(pager->file, 0L, SEEK_END) != 0) {
-    return 0;
+static void *paging_page_pin(const struct paging_pager *pager,
+                             uint64_t page_number) {
+  pager->stats->stats.page_pins_count++;
+  switch (pager->backend) {
+  case PAGING_BACKEND_BUFFERED:
+    return paging_buffer_pool_pin(pager->buffer_pool, page_number);
+  case PAGING_BACKEND_MMAP:
+    return paging_mmap_get(pager->mmap,
+                           paging_page_position(pager, page_number),
+                           pager->page_size);
+  default:
+    abort();
   }
-
-  const long file_size = ftell(pager->file);
-  const long page_size =
-      (long)sizeof(struct paging_file_page_header) + PAGING_PAGE_DATA_SIZE;
-  return (file_size - (long)sizeof(struct paging_file_header)) / page_size;
 }
 
-static uint64_t paging_first_page_number(const struct paging_pager *pager,
-                                         enum paging_type type) {
-  switch (type) {
-  case PAGING_TYPE_FREE:
-    return pager->first_free_page_number;
-  case PAGING_TYPE_1:
-    return pager->first_page_type_1_page_number;
-  case PAGING_TYPE_2:
-    return pager->first_page_type_2_page_number;
-  case PAGING_TYPE_3:
-    return pager->first_page_type_3_page_number;
+static void *paging_page_pin_new(const struct paging_pager *pager,
+                                 uint64_t page_number) {
+  switch (pager->backend) {
+  case PAGING_BACKEND_BUFFERED:
+    return paging_buffer_pool_pin_new(pager->buffer_pool, page_number);
+  case PAGING_BACKEND_MMAP: {
+    void *page = paging_page_pin(pager, page_number);
+    if (page != NULL) {
+      memset(page, 0, pager->page_size);
+    }
+    return page;
+  }
   default:
     abort();
   }
 }
 
-static void paging_update_first_page_number(struct paging_pager *pager,
-                                            enum paging_type type,
-                                            uint64_t new_value) {
-  switch (type) {
-  case PAGING_TYPE_FREE:
-    pager->first_free_page_number = new_value;
-    break;
-  case PAGING_TYPE_1:
-    pager->first_page_type_1_page_number = new_value;
-    break;
-  case PAGING_TYPE_2:
-    pager->first_page_type_2_page_number = new_value;
-    break;
-  case PAGING_TYPE_3:
-    pager->first_page_type_3_page_number = new_value;
-    break;
+// Brings a run of pages into memory ahead of pins of every page of the run
+static void paging_pages_load(const struct paging_pager *pager,
+                              uint64_t first_page_number,
+                              uint64_t pages_count) {
+  if (pager->backend == PAGING_BACKEND_BUFFERED &&
+      !paging_buffer_pool_load(pager->buffer_pool, first_page_number,
+                               pages_count)) {
+    warn("Pages %" PRIu64 "-%" PRIu64 " load error", first_page_number,
+         first_page_number + pages_count - 1);
   }
 }
 
-struct paging_write_result paging_write(struct paging_pager *pager,
-                                        enum paging_type type, const void *data,
-                                        size_t data_size) {
-  if (pager == NULL || data == NULL || data_size == 0) {
-    return (struct paging_write_result){.success = false};
+static void paging_page_unpin(const struct paging_pager *pager,
+                              uint64_t page_number, bool is_dirty) {
+  switch (pager->backend) {
+  case PAGING_BACKEND_BUFFERED:
+    paging_buffer_pool_unpin(pager->buffer_pool, page_number, is_dirty);
+    break;
+  case PAGING_BACKEND_MMAP:
+    break;
   }
+}
 
-  const size_t pages_count = DIV_ROUND_UP(data_size, PAGING_PAGE_DATA_SIZE);
-  uint64_t next_page_number = paging_first_page_number(pager, type);
-  uint64_t next_page_is_continuation = 0;
-
-  for (size_t i = pages_count; i > 0; i--) {
-    uint64_t page_number;
-
-    if (pager->first_free_page_number == PAGING_INVALID_PAGE_NUMBER) {
-      page_number = paging_new_page_number(pager);
-    } else {
-      page_number = pager->first_free_page_number;
-
-      // Update first free page number in pager
-
-      const long seek_position =
-          paging_file_page_header_position(pager->first_free_page_number);
-      const int seek_result = fseek(pager->file, seek_position, SEEK_SET);
-      if (seek_result != 0) {
-        warn("Free page header seek error");
-        return (struct paging_write_result){.success = false};
-      }
-
-      struct paging_file_page_header header;
-
-      const size_t read_count = 1;
-      const size_t read_result =
-          fread(&header, sizeof(header), read_count, pager->file);
-      if (read_result != read_count) {
-        warn("Free page header read error");
-        return (struct paging_write_result){.success = false};
-      }
+static struct paging_file_page_header *paging_page_header(void *page) {
+  return page;
+}
 
-      pager->first_free_page_number = header.next_page_number;
-    }
+static void *paging_page_data(void *page) {
+  return (char *)page + sizeof(struct paging_file_page_header);
+}
 
-    const long header_position = paging_file_page_header_position(page_number);
-    const int seek_result = fseek(pager->file, header_position, SEEK_SET);
-    if (seek_result != 0) {
-      warn("Page header seek error");
-      return (struct paging_write_result){.success = false};
-    }
+static struct paging_file_slot *paging_page_slots(void *page) {
+  return paging_page_data(page);
+}
 
-    const struct paging_file_page_header header = {
-        .next_page_number = next_page_number,
-        .next_continuation = next_page_is_continuation};
+static void paging_page_init(const struct paging_pager *pager, void *page,
+                             uint64_t previous_page_number) {
+  memset(page, 0, pager->page_size);
+  *paging_page_header(page) = (struct paging_file_page_header){
+      .next_page_number = PAGING_INVALID_PAGE_NUMBER,
+      .previous_page_number = previous_page_number,
+      .last_page_number = PAGING_INVALID_PAGE_NUMBER,
+      .slots_count = 0,
+      .free_space_end = (uint16_t)pager->page_data_size,
+      .fragmented_size = 0};
+}
 
-    const size_t write_header_count = 1;
-    const size_t write_header_result =
-        fwrite(&header, sizeof(header), write_header_count, pager->file);
-    if (write_header_result != write_header_count) {
-      warn("Page header write error");
-      return (struct paging_write_result){.success = false};
+// Moves all records to the end of the page so that the space of removed
+// records becomes one free block between the slots and the records.
+static void paging_page_compact(struct paging_pager *pager, void *page) {
+  struct paging_file_page_header *header = paging_page_header(page);
+  struct paging_file_slot *slots = paging_page_slots(page);
+  char *page_data = paging_page_data(page);
+
+  char *buffer = pager->page_buffer;
+  size_t free_space_end = pager->page_data_size;
+  for (uint16_t i = 0; i < header->slots_count; i++) {
+    if (slots[i].offset == 0) {
+      continue;
     }
 
-    const size_t page_data_offset = PAGING_PAGE_DATA_SIZE * (i - 1);
-    const size_t page_data_size =
-        MIN(PAGING_PAGE_DATA_SIZE, data_size - page_data_offset);
+    free_space_end -= ROUND_UP(slots[i].size, PAGING_RECORD_ALIGNMENT);
+    memcpy(buffer + free_space_end, page_data + slots[i].offset,
+           slots[i].size);
+    slots[i].offset = (uint16_t)free_space_end;
+  }
 
-    const void *page_data = (char *)data + page_data_offset;
+  memcpy(page_data + free_space_end, buffer + free_space_end,
+         pager->page_data_size - free_space_end);
+  header->free_space_end = (uint16_t)free_space_end;
+  header->fragmented_size = 0;
+}
 
-    const size_t write_data_count = 1;
-    const size_t write_data_result =
-        fwrite(page_data, page_data_size, write_data_count, pager->file);
-    if (write_data_result != write_data_count) {
-      warn("Data write error");
-      return (struct paging_write_result){.success = false};
-    }
+// Records above this size do not fit into an empty heap page with their slot
+static size_t paging_inline_record_max_size(const struct paging_pager *pager) {
+  return pager->page_data_size -
+         ROUND_UP(sizeof(struct paging_file_slot), PAGING_RECORD_ALIGNMENT);
+}
 
-    const long padding_seek_offset = PAGING_PAGE_DATA_SIZE - page_data_size - 1;
-    const int padding_seek_result =
-        fseek(pager->file, padding_seek_offset, SEEK_CUR);
-    if (padding_seek_result != 0) {
-      warn("Padding seek error");
-      return (struct paging_write_result){.success = false};
+static bool paging_page_insert(struct paging_pager *pager, void *page,
+                               const void *record, size_t size, uint16_t flags,
+                               uint16_t *slot_number) {
+  struct paging_file_page_header *header = paging_page_header(page);
+  struct paging_file_slot *slots = paging_page_slots(page);
+
+  uint16_t free_slot_number = header->slots_count;
+  for (uint16_t i = 0; i < header->slots_count; i++) {
+    if (slots[i].offset == 0) {
+      free_slot_number = i;
+      break;
     }
+  }
 
-    const char data_padding_value = 0;
-    const size_t write_data_padding_count = 1;
-    const size_t write_data_padding_result =
-        fwrite(&data_padding_value, sizeof(data_padding_value),
-               write_data_padding_count, pager->file);
-    if (write_data_padding_result != write_data_padding_count) {
-      warn("Padding write error");
-      return (struct paging_write_result){.success = false};
-    }
+  const size_t slots_size =
+      sizeof(struct paging_file_slot) *
+      MAX(header->slots_count, (size_t)free_slot_number + 1);
+  const size_t record_size = ROUND_UP(size, PAGING_RECORD_ALIGNMENT);
+  if (slots_size + record_size >
+      (size_t)header->free_space_end + header->fragmented_size) {
+    return false;
+  }
 
-    paging_update_first_page_number(pager, type, page_number);
-    next_page_number = page_number;
-    next_page_is_continuation = 1;
+  if (slots_size + record_size > header->free_space_end) {
+    paging_page_compact(pager, page);
   }
 
-  if (!paging_file_header_write(pager)) {
-    warn("File header write error");
-    return (struct paging_write_result){.success = false};
+  header->free_space_end -= record_size;
+  memcpy((char *)paging_page_data(page) + header->free_space_end, record,
+         size);
+  slots[free_slot_number] =
+      (struct paging_file_slot){.offset = header->free_space_end,
+                                .size = (uint16_t)size,
+                                .flags = flags};
+  if (free_slot_number == header->slots_count) {
+    header->slots_count += 1;
   }
 
-  return (struct paging_write_result){.success = true};
+  *slot_number = free_slot_number;
+  return true;
 }
 
-struct paging_remove_result paging_remove(struct paging_pager *pager,
-                                          struct paging_info info) {
-  if (info.current_first_page_number == PAGING_INVALID_PAGE_NUMBER) {
-    return (struct paging_remove_result){.success = false};
+static void paging_page_remove(const struct paging_pager *pager, void *page,
+                               uint16_t slot_number) {
+  struct paging_file_page_header *header = paging_page_header(page);
+  struct paging_file_slot *slots = paging_page_slots(page);
+
+  const size_t record_size =
+      ROUND_UP(slots[slot_number].size, PAGING_RECORD_ALIGNMENT);
+  if (slots[slot_number].offset == header->free_space_end) {
+    header->free_space_end += record_size;
+  } else {
+    header->fragmented_size += record_size;
   }
+  slots[slot_number] = (struct paging_file_slot){0};
 
-  bool next_continuation = true;
-  uint64_t next_page_number = info.current_first_page_number;
+  while (header->slots_count > 0 &&
+         slots[header->slots_count - 1].offset == 0) {
+    header->slots_count -= 1;
+  }
 
-  while (next_continuation) {
-    const long seek_position =
-        paging_file_page_header_position(next_page_number);
+  if (header->slots_count == 0) {
+    header->free_space_end = (uint16_t)pager->page_data_size;
+    header->fragmented_size = 0;
+  }
+}
 
-    const int seek_result = fseek(pager->file, seek_position, SEEK_SET);
-    if (seek_result != 0) {
-      warn("Page header seek error");
-      return (struct paging_remove_result){.success = false};
-    }
+// Space a new record may take in the page together with a new slot
+static size_t paging_page_free_size(void *page) {
+  const struct paging_file_page_header *header = paging_page_header(page);
+  const size_t slots_size =
+      sizeof(struct paging_file_slot) * ((size_t)header->slots_count + 1);
+  const size_t free_size =
+      (size_t)header->free_space_end + header->fragmented_size;
+  return free_size > slots_size ? free_size - slots_size : 0;
+}
 
-    struct paging_file_page_header header;
+static void paging_page_fsm_update(const struct paging_pager *pager,
+                                   struct paging_chain chain,
+                                   uint64_t page_number, void *page) {
+  paging_fsm_set(pager->fsm, chain.root_page_number, page_number,
+                 paging_page_free_size(page));
+}
 
-    const size_t header_read_count = 1;
-    const size_t header_read_result =
-        fread(&header, sizeof(header), header_read_count, pager->file);
-    if (header_read_result != header_read_count) {
-      warn("Read page %" PRIu64 " header error", next_page_number);
-      return (struct paging_remove_result){.success = false};
-    }
+struct paging_commit_result paging_commit(struct paging_pager *pager) {
+  if (pager == NULL) {
+    return (struct paging_commit_result){.success = false};
+  }
 
-    struct paging_file_page_header new_header = {
-        .next_page_number = pager->first_free_page_number,
-        .next_continuation = 0};
+  if (pager->backend == PAGING_BACKEND_BUFFERED &&
+      !paging_buffer_pool_flush(pager->buffer_pool)) {
+    warn("Buffer pool flush error");
+    return (struct paging_commit_result){.success = false};
+  }
 
-    const int new_seek_result = fseek(pager->file, seek_position, SEEK_SET);
-    if (new_seek_result != 0) {
-      warn("Page header seek error");
-      return (struct paging_remove_result){.success = false};
-    }
+  pager->stats->stats.commits_count++;
+  if (pager->is_header_dirty) {
+    pager->stats->stats.header_writes_count++;
+  }
 
-    const size_t header_write_count = 1;
-    const size_t header_write_result = fwrite(&new_header, sizeof(new_header),
-                                              header_write_count, pager->file);
-    if (header_write_result != header_write_count) {
-      warn("Write page %" PRIu64 " header error", next_page_number);
-      return (struct paging_remove_result){.success = false};
+  if (pager->wal == NULL) {
+    if (pager->is_header_dirty && !paging_file_header_write(pager)) {
+      warn("File header write error");
+      return (struct paging_commit_result){.success = false};
     }
 
-    pager->first_free_page_number = next_page_number;
-    next_page_number = header.next_page_number;
-    next_continuation = header.next_continuation;
+    pager->is_header_dirty = false;
+    return (struct paging_commit_result){.success = true};
   }
 
-  if (paging_first_page_number(pager, info.type) ==
-      info.current_first_page_number) {
-    paging_update_first_page_number(pager, info.type,
-                                    info.next_first_page_number);
+  const struct paging_file_header header = paging_file_header_make(pager);
+  if (pager->is_header_dirty &&
+      !paging_wal_append(pager->wal, 0, &header, sizeof(header))) {
+    warn("Log header append error");
+    return (struct paging_commit_result){.success = false};
   }
+  pager->is_header_dirty = false;
 
-  if (!paging_file_header_write(pager)) {
-    warn("Write file header error");
-    return (struct paging_remove_result){.success = false};
+  if (!paging_wal_commit(pager->wal)) {
+    warn("Log commit error");
+    return (struct paging_commit_result){.success = false};
   }
 
-  if (info.previous_last_page_number != PAGING_INVALID_PAGE_NUMBER) {
-    const long seek_position =
-        paging_file_page_header_position(info.previous_last_page_number);
-
-    const int seek_read_result = fseek(pager->file, seek_position, SEEK_SET);
-    if (seek_read_result != 0) {
-      warn("Previous page header seek error");
-      return (struct paging_remove_result){.success = false};
-    }
+  const uint64_t wal_size = paging_wal_size(pager->wal);
+  if (pager->writer != NULL && wal_size >= pager->wal_checkpoint_size) {
+    paging_writer_wake(pager->writer);
+  }
 
-    struct paging_file_page_header header;
+  const uint64_t checkpoint_size =
+      pager->writer != NULL
+          ? pager->wal_checkpoint_size * PAGING_WAL_CHECKPOINT_BACKLOG
+          : pager->wal_checkpoint_size;
+  if (wal_size < checkpoint_size) {
+    return (struct paging_commit_result){.success = true};
+  }
 
-    const size_t header_read_count = 1;
-    const size_t header_read_result =
-        fread(&header, sizeof(header), header_read_count, pager->file);
-    if (header_read_result != header_read_count) {
-      warn("Read previous page header error");
-      return (struct paging_remove_result){.success = false};
-    }
+  pager->stats->stats.checkpoints_count++;
+  if (!paging_wal_checkpoint(pager->wal, pager->file)) {
+    warn("Checkpoint error");
+    return (struct paging_commit_result){.success = false};
+  }
 
-    header.next_page_number = info.next_first_page_number;
+  return (struct paging_commit_result){.success = true};
+}
 
-    const int seek_write_result = fseek(pager->file, seek_position, SEEK_SET);
-    if (seek_write_result != 0) {
-      warn("Previous page header seek error");
-      return (struct paging_remove_result){.success = false};
-    }
+static bool paging_file_reserve(struct paging_pager *pager,
+                                uint64_t pages_count) {
+  if (pages_count <= pager->allocated_pages_count) {
+    return true;
+  }
 
-    const size_t header_write_count = 1;
-    const size_t header_write_result =
-        fwrite(&header, sizeof(header), header_write_count, pager->file);
-    if (header_write_result != header_write_count) {
-      warn("Write previous page header error");
-      return (struct paging_remove_result){.success = false};
-    }
+  // Grow in large steps, so that the file system can keep the file
+  // contiguous and most allocations do not touch the file size at all
+  const uint64_t grow_pages_count =
+      MAX(pages_count - pager->allocated_pages_count,
+          MAX(PAGING_FILE_GROW_SIZE / pager->page_size,
+              pager->allocated_pages_count / 8));
+  const int error = posix_fallocate(
+      pager->fd, paging_page_position(pager, pager->allocated_pages_count),
+      paging_page_position(pager, grow_pages_count));
+  if (error != 0) {
+    warn("File preallocation error. Errno: %d", error);
+    return false;
   }
 
-  return (struct paging_remove_result){.success = true};
+  pager->stats->stats.file_extensions_count++;
+  pager->allocated_pages_count += grow_pages_count;
+  return true;
 }
 
-static struct paging_read_result paging_read(const struct paging_pager *pager,
-                                             uint64_t page_number,
-                                             void **data) {
-  if (page_number == PAGING_INVALID_PAGE_NUMBER) {
-    return (struct paging_read_result){.success = false};
+static bool paging_free_extent_head_write(struct paging_pager *pager,
+                                          size_t index) {
+  const struct paging_extent extent =
+      paging_extents_get(pager->free_extents, index);
+  const uint64_t next_page_number =
+      index + 1 < paging_extents_count(pager->free_extents)
+          ? paging_extents_get(pager->free_extents, index + 1)
+                .first_page_number
+          : PAGING_INVALID_PAGE_NUMBER;
+
+  void *page = paging_page_pin_new(pager, extent.first_page_number);
+  if (page == NULL) {
+    warn("Free extent page %" PRIu64 " pin error", extent.first_page_number);
+    return false;
   }
 
-  uint64_t current_page_number = page_number;
-  uint64_t next_page_number = page_number;
-  bool next_continuation = true;
-  size_t pages_read = 0;
-
-  *data = NULL;
+  paging_page_init(pager, page, PAGING_INVALID_PAGE_NUMBER);
+  paging_page_header(page)->next_page_number = next_page_number;
+  paging_page_header(page)->last_page_number =
+      extent.first_page_number + extent.pages_count - 1;
+  paging_page_unpin(pager, extent.first_page_number, true);
+  return true;
+}
 
-  while (next_continuation) {
-    void *tmp_data = realloc(*data, PAGING_PAGE_DATA_SIZE * (pages_read + 1));
-    if (tmp_data == NULL) {
-      warn("Re-alloc error");
-      free(*data);
-      return (struct paging_read_result){.success = false};
+// The free extents are also kept in the file as a list of their first pages
+// sorted by page number. After the extent at index changed, only its head
+// page and the head page of the previous extent need to be rewritten.
+static bool paging_free_extents_write(struct paging_pager *pager,
+                                      size_t index) {
+  if (index > 0) {
+    if (!paging_free_extent_head_write(pager, index - 1)) {
+      return false;
     }
+  } else {
+    pager->first_free_page_number =
+        paging_extents_count(pager->free_extents) > 0
+            ? paging_extents_get(pager->free_extents, 0).first_page_number
+            : PAGING_INVALID_PAGE_NUMBER;
+    pager->is_header_dirty = true;
+  }
 
-    *data = tmp_data;
-
-    const long seek_position =
-        paging_file_page_header_position(next_page_number);
-    const int seek_result = fseek(pager->file, seek_position, SEEK_SET);
-    if (seek_result != 0) {
-      warn("Page header seek error");
-      free(*data);
-      return (struct paging_read_result){.success = false};
-    }
+  if (index < paging_extents_count(pager->free_extents)) {
+    return paging_free_extent_head_write(pager, index);
+  }
 
-    struct paging_file_page_header header;
+  return true;
+}
 
-    const size_t header_read_count = 1;
-    const size_t header_read_result =
-        fread(&header, sizeof(header), header_read_count, pager->file);
-    if (header_read_result != header_read_count) {
-      warn("Read page %" PRIu64 " header error", next_page_number);
-      free(*data);
-      return (struct paging_read_result){.success = false};
+static bool paging_free_extents_read(struct paging_pager *pager) {
+  uint64_t page_number = pager->first_free_page_number;
+  while (page_number != PAGING_INVALID_PAGE_NUMBER) {
+    void *page = paging_page_pin(pager, page_number);
+    if (page == NULL) {
+      warn("Read free extent page %" PRIu64 " error", page_number);
+      return false;
     }
 
-    void *data_for_page =
-        (PAGING_PAGE_DATA_SIZE * pages_read) + (char *)(*data);
-    const size_t data_read_count = 1;
-    const size_t data_read_result = fread(data_for_page, PAGING_PAGE_DATA_SIZE,
-                                          data_read_count, pager->file);
-    if (data_read_result != data_read_count) {
-      warn("Read page %" PRIu64 " data error", next_page_number);
-      free(*data);
-      return (struct paging_read_result){.success = false};
+    const struct paging_file_page_header header = *paging_page_header(page);
+    paging_page_unpin(pager, page_number, false);
+
+    const struct paging_extent extent = {
+        .first_page_number = page_number,
+        .pages_count = header.last_page_number - page_number + 1};
+    size_t index;
+    if (!paging_extents_insert(pager->free_extents, extent, &index)) {
+      warn("Free extent insert error");
+      return false;
     }
 
-    current_page_number = next_page_number;
-    next_page_number = header.next_page_number;
-    next_continuation = header.next_continuation == 1;
-    pages_read += 1;
+    page_number = header.next_page_number;
   }
 
-  return (struct paging_read_result){
-      .success = true,
-      .info = {.current_first_page_number = page_number,
-               .current_last_page_number = current_page_number,
-               .next_first_page_number = next_page_number}};
+  return true;
+}
+
+// Allocates pages from the start of the free extent at index
+static bool paging_pages_take(struct paging_pager *pager, size_t index,
+                              uint64_t pages_count,
+                              uint64_t *first_page_number) {
+  *first_page_number =
+      paging_extents_get(pager->free_extents, index).first_page_number;
+  pager->stats->stats.free_pages_reused_count += pages_count;
+  paging_extents_take(pager->free_extents, index, pages_count);
+  return paging_free_extents_write(pager, index);
+}
+
+static bool paging_pages_allocate(struct paging_pager *pager,
+                                  uint64_t pages_count,
+                                  uint64_t *first_page_number) {
+  const size_t index =
+      paging_extents_find_best_fit(pager->free_extents, pages_count);
+  if (index < paging_extents_count(pager->free_extents)) {
+    return paging_pages_take(pager, index, pages_count, first_page_number);
+  }
+
+  if (!paging_file_reserve(pager, pager->pages_count + pages_count)) {
+    return false;
+  }
+
+  *first_page_number = pager->pages_count;
+  pager->stats->stats.pages_appended_count += pages_count;
+  pager->pages_count += pages_count;
+  pager->is_header_dirty = true;
+  return true;
+}
+
+static bool paging_pages_free(struct paging_pager *pager,
+                              uint64_t first_page_number,
+                              uint64_t pages_count) {
+  const struct paging_extent extent = {.first_page_number = first_page_number,
+                                       .pages_count = pages_count};
+  size_t index;
+  if (!paging_extents_insert(pager->free_extents, extent, &index)) {
+    warn("Free extent insert error");
+    return false;
+  }
+  pager->stats->stats.pages_freed_count += pages_count;
+
+  // Free pages at the end of the file are given back to the unused tail
+  const struct paging_extent merged_extent =
+      paging_extents_get(pager->free_extents, index);
+  if (merged_extent.first_page_number + merged_extent.pages_count ==
+      pager->pages_count) {
+    pager->pages_count = merged_extent.first_page_number;
+    pager->is_header_dirty = true;
+    paging_extents_remove(pager->free_extents, index);
+  }
+
+  return paging_free_extents_write(pager, index);
+}
+
+static void *paging_page_allocate(struct paging_pager *pager,
+                                  uint64_t *page_number) {
+  if (!paging_pages_allocate(pager, 1, page_number)) {
+    return NULL;
+  }
+
+  // Free pages hold nothing worth reading
+  void *page = paging_page_pin_new(pager, *page_number);
+  if (page == NULL) {
+    warn("New page pin error");
+    return NULL;
+  }
+
+  return page;
+}
+
+// Frees the page and returns its previous header.
+static bool paging_page_free(struct paging_pager *pager, uint64_t page_number,
+                             struct paging_file_page_header *header) {
+  void *page = paging_page_pin(pager, page_number);
+  if (page == NULL) {
+    warn("Read page %" PRIu64 " header error", page_number);
+    return false;
+  }
+
+  *header = *paging_page_header(page);
+  paging_page_unpin(pager, page_number, false);
+
+  return paging_pages_free(pager, page_number, 1);
+}
+
+static bool paging_page_link(struct paging_pager *pager, uint64_t page_number,
+                             uint64_t next_page_number) {
+  void *page = paging_page_pin(pager, page_number);
+  if (page == NULL) {
+    warn("Read page %" PRIu64 " header error", page_number);
+    return false;
+  }
+
+  paging_page_header(page)->next_page_number = next_page_number;
+  paging_page_unpin(pager, page_number, true);
+  return true;
+}
+
+static uint64_t paging_overflow_pages_count(const struct paging_pager *pager,
+                                            uint64_t size) {
+  return DIV_ROUND_UP(size, pager->page_size);
+}
+
+static bool paging_overflow_free(struct paging_pager *pager,
+                                 struct paging_file_overflow overflow) {
+  return paging_pages_free(pager, overflow.first_page_number,
+                           paging_overflow_pages_count(pager, overflow.size));
+}
+
+// Stores a record that does not fit into a heap page in a contiguous extent
+// of pages without page headers, the heap page keeps only a
+// paging_file_overflow stub.
+static bool paging_overflow_write(struct paging_pager *pager, const void *data,
+                                  struct paging_file_overflow *overflow) {
+  const uint64_t pages_count =
+      paging_overflow_pages_count(pager, overflow->size);
+  if (!paging_pages_allocate(pager, pages_count,
+                             &overflow->first_page_number)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < pages_count; i++) {
+    const uint64_t page_number = overflow->first_page_number + i;
+    void *page = paging_page_pin_new(pager, page_number);
+    if (page == NULL) {
+      warn("New page pin error");
+      paging_overflow_free(pager, *overflow);
+      return false;
+    }
+
+    const size_t page_data_offset = pager->page_size * i;
+    memcpy(page, (const char *)data + page_data_offset,
+           MIN(pager->page_size, overflow->size - page_data_offset));
+    paging_page_unpin(pager, page_number, true);
+  }
+
+  return true;
+}
+
+static bool paging_overflow_read(const struct paging_pager *pager,
+                                 struct paging_file_overflow overflow,
+                                 void *data) {
+  const uint64_t pages_count =
+      paging_overflow_pages_count(pager, overflow.size);
+  for (uint64_t i = 0; i < pages_count; i++) {
+    const uint64_t page_number = overflow.first_page_number + i;
+    if (i % PAGING_BUFFER_POOL_RUN_MAX == 0) {
+      paging_pages_load(pager, page_number,
+                        MIN(pages_count - i, PAGING_BUFFER_POOL_RUN_MAX));
+    }
+
+    void *page = paging_page_pin(pager, page_number);
+    if (page == NULL) {
+      warn("Read page %" PRIu64 " error", page_number);
+      return false;
+    }
+
+    const size_t page_data_offset = pager->page_size * i;
+    memcpy((char *)data + page_data_offset, page,
+           MIN(pager->page_size, overflow.size - page_data_offset));
+    paging_page_unpin(pager, page_number, false);
+  }
+
+  return true;
+}
+
+struct paging_chain paging_root_chain(const struct paging_pager *pager) {
+  return (struct paging_chain){.root_page_number =
+                                   pager->root_chain_page_number};
+}
+
+struct paging_chain_create_result
+paging_chain_create(struct paging_pager *pager) {
+  if (pager == NULL) {
+    return (struct paging_chain_create_result){.success = false};
+  }
+
+  uint64_t page_number;
+  void *page = paging_page_allocate(pager, &page_number);
+  if (page == NULL) {
+    return (struct paging_chain_create_result){.success = false};
+  }
+
+  paging_page_init(pager, page, PAGING_INVALID_PAGE_NUMBER);
+  paging_page_header(page)->last_page_number = page_number;
+  paging_page_unpin(pager, page_number, true);
+
+  return (struct paging_chain_create_result){
+      .success = true, .chain = {.root_page_number = page_number}};
+}
+
+struct paging_chain_remove_result
+paging_chain_remove(struct paging_pager *pager, struct paging_chain chain) {
+  if (pager == NULL ||
+      chain.root_page_number == PAGING_INVALID_PAGE_NUMBER ||
+      chain.root_page_number == pager->root_chain_page_number) {
+    return (struct paging_chain_remove_result){.success = false};
+  }
+
+  paging_fsm_forget_chain(pager->fsm, chain.root_page_number);
+
+  uint64_t page_number = chain.root_page_number;
+  while (page_number != PAGING_INVALID_PAGE_NUMBER) {
+    for (uint16_t slot_number = 0;; slot_number++) {
+      void *page = paging_page_pin(pager, page_number);
+      if (page == NULL) {
+        warn("Read page %" PRIu64 " error", page_number);
+        return (struct paging_chain_remove_result){.success = false};
+      }
+
+      if (slot_number >= paging_page_header(page)->slots_count) {
+        paging_page_unpin(pager, page_number, false);
+        break;
+      }
+
+      const struct paging_file_slot slot =
+          paging_page_slots(page)[slot_number];
+      struct paging_file_overflow overflow;
+      if (slot.offset != 0 && (slot.flags & PAGING_SLOT_FLAG_OVERFLOW)) {
+        memcpy(&overflow, (char *)paging_page_data(page) + slot.offset,
+               sizeof(overflow));
+      }
+      paging_page_unpin(pager, page_number, false);
+
+      if (slot.offset != 0 && (slot.flags & PAGING_SLOT_FLAG_OVERFLOW) &&
+          !paging_overflow_free(pager, overflow)) {
+        return (struct paging_chain_remove_result){.success = false};
+      }
+    }
+
+    struct paging_file_page_header header;
+    if (!paging_page_free(pager, page_number, &header)) {
+      return (struct paging_chain_remove_result){.success = false};
+    }
+
+    page_number = header.next_page_number;
+  }
+
+  return (struct paging_chain_remove_result){.success = true};
+}
+
+// Inserts the record into a page of the chain when it fits there
+static bool paging_chain_page_insert(struct paging_pager *pager,
+                                     struct paging_chain chain,
+                                     uint64_t page_number, const void *record,
+                                     size_t record_size, uint16_t flags,
+                                     uint16_t *slot_number,
+                                     bool *is_inserted) {
+  void *page = paging_page_pin(pager, page_number);
+  if (page == NULL) {
+    warn("Read page %" PRIu64 " error", page_number);
+    return false;
+  }
+
+  *is_inserted =
+      paging_page_insert(pager, page, record, record_size, flags, slot_number);
+  paging_page_fsm_update(pager, chain, page_number, page);
+  paging_page_unpin(pager, page_number, *is_inserted);
+  return true;
+}
+
+// Frees a new last page that is not linked to its chain, together with the
+// overflow pages of the record written to it
+static void paging_write_page_free(struct paging_pager *pager,
+                                   struct paging_chain chain,
+                                   uint64_t page_number, uint16_t flags,
+                                   struct paging_file_overflow overflow) {
+  paging_fsm_set(pager->fsm, chain.root_page_number, page_number, 0);
+  paging_pages_free(pager, page_number, 1);
+  if (flags & PAGING_SLOT_FLAG_OVERFLOW) {
+    paging_overflow_free(pager, overflow);
+  }
+}
+
+struct paging_write_result paging_write(struct paging_pager *pager,
+                                        struct paging_chain chain,
+                                        const void *data, size_t data_size) {
+  if (pager == NULL || data == NULL || data_size == 0) {
+    return (struct paging_write_result){.success = false};
+  }
+
+  const void *record = data;
+  size_t record_size = data_size;
+  uint16_t flags = 0;
+
+  struct paging_file_overflow overflow = {.size = data_size};
+  if (data_size > paging_inline_record_max_size(pager)) {
+    if (!paging_overflow_write(pager, data, &overflow)) {
+      warn("Overflow pages write error");
+      return (struct paging_write_result){.success = false};
+    }
+
+    record = &overflow;
+    record_size = sizeof(overflow);
+    flags = PAGING_SLOT_FLAG_OVERFLOW;
+  }
+
+  void *root_page = paging_page_pin(pager, chain.root_page_number);
+  if (root_page == NULL) {
+    warn("Read chain root page %" PRIu64 " error", chain.root_page_number);
+    if (flags & PAGING_SLOT_FLAG_OVERFLOW) {
+      paging_overflow_free(pager, overflow);
+    }
+    return (struct paging_write_result){.success = false};
+  }
+
+  const uint64_t last_page_number =
+      paging_page_header(root_page)->last_page_number;
+  paging_page_unpin(pager, chain.root_page_number, false);
+
+  // New records go to a page of the chain with enough free space, then to
+  // the last page of the chain, a new last page is linked when it is full
+  uint64_t page_number;
+  uint16_t slot_number;
+  bool is_inserted = false;
+  if (paging_fsm_find(pager->fsm, chain.root_page_number,
+                      ROUND_UP(record_size, PAGING_RECORD_ALIGNMENT),
+                      &page_number) &&
+      !paging_chain_page_insert(pager, chain, page_number, record,
+                                record_size, flags, &slot_number,
+                                &is_inserted)) {
+    if (flags & PAGING_SLOT_FLAG_OVERFLOW) {
+      paging_overflow_free(pager, overflow);
+    }
+    return (struct paging_write_result){.success = false};
+  }
+
+  if (!is_inserted) {
+    page_number = last_page_number;
+    if (!paging_chain_page_insert(pager, chain, page_number, record,
+                                  record_size, flags, &slot_number,
+                                  &is_inserted)) {
+      if (flags & PAGING_SLOT_FLAG_OVERFLOW) {
+        paging_overflow_free(pager, overflow);
+      }
+      return (struct paging_write_result){.success = false};
+    }
+  }
+
+  if (!is_inserted) {
+    void *page = paging_page_allocate(pager, &page_number);
+    if (page == NULL) {
+      if (flags & PAGING_SLOT_FLAG_OVERFLOW) {
+        paging_overflow_free(pager, overflow);
+      }
+      return (struct paging_write_result){.success = false};
+    }
+
+    paging_page_init(pager, page, last_page_number);
+    paging_page_insert(pager, page, record, record_size, flags, &slot_number);
+    paging_page_fsm_update(pager, chain, page_number, page);
+    paging_page_unpin(pager, page_number, true);
+
+    if (!paging_page_link(pager, last_page_number, page_number)) {
+      paging_write_page_free(pager, chain, page_number, flags, overflow);
+      return (struct paging_write_result){.success = false};
+    }
+
+    root_page = paging_page_pin(pager, chain.root_page_number);
+    if (root_page == NULL) {
+      warn("Read chain root page %" PRIu64 " error", chain.root_page_number);
+      if (paging_page_link(pager, last_page_number,
+                           PAGING_INVALID_PAGE_NUMBER)) {
+        paging_write_page_free(pager, chain, page_number, flags, overflow);
+      }
+      return (struct paging_write_result){.success = false};
+    }
+
+    paging_page_header(root_page)->last_page_number = page_number;
+    paging_page_unpin(pager, chain.root_page_number, true);
+  }
+
+  return (struct paging_write_result){
+      .success = true,
+      .info = {.chain = chain,
+               .record_id = {.page_number = page_number,
+                             .slot_number = slot_number}}};
+}
+
+// Puts a record of the given size into an existing slot. Does not check
+// that the record fits, see paging_page_replace_space.
+static void paging_page_replace(struct paging_pager *pager, void *page,
+                                uint16_t slot_number, const void *record,
+                                size_t size, uint16_t flags) {
+  struct paging_file_page_header *header = paging_page_header(page);
+  struct paging_file_slot *slot = &paging_page_slots(page)[slot_number];
+  char *page_data = paging_page_data(page);
+
+  const size_t old_record_size = ROUND_UP(slot->size, PAGING_RECORD_ALIGNMENT);
+  const size_t record_size = ROUND_UP(size, PAGING_RECORD_ALIGNMENT);
+  if (record_size <= old_record_size) {
+    memcpy(page_data + slot->offset, record, size);
+    header->fragmented_size += old_record_size - record_size;
+    *slot = (struct paging_file_slot){
+        .offset = slot->offset, .size = (uint16_t)size, .flags = flags};
+    return;
+  }
+
+  if (slot->offset == header->free_space_end) {
+    header->free_space_end += old_record_size;
+  } else {
+    header->fragmented_size += old_record_size;
+  }
+  *slot = (struct paging_file_slot){0};
+
+  const size_t slots_size =
+      sizeof(struct paging_file_slot) * header->slots_count;
+  if (slots_size + record_size > header->free_space_end) {
+    paging_page_compact(pager, page);
+  }
+
+  header->free_space_end -= record_size;
+  memcpy(page_data + header->free_space_end, record, size);
+  *slot = (struct paging_file_slot){
+      .offset = header->free_space_end, .size = (uint16_t)size, .flags = flags};
+}
+
+// Space a record put into the slot by paging_page_replace may take
+static size_t paging_page_replace_space(void *page, uint16_t slot_number) {
+  const struct paging_file_page_header *header = paging_page_header(page);
+  const struct paging_file_slot slot = paging_page_slots(page)[slot_number];
+  const size_t slots_size =
+      sizeof(struct paging_file_slot) * header->slots_count;
+  return header->free_space_end + header->fragmented_size +
+         ROUND_UP(slot.size, PAGING_RECORD_ALIGNMENT) - slots_size;
+}
+
+// Pins the page of the record and checks that the slot holds a record
+static void *paging_record_pin(const struct paging_pager *pager,
+                               struct paging_record_id record_id) {
+  if (record_id.page_number == PAGING_INVALID_PAGE_NUMBER) {
+    return NULL;
+  }
+
+  void *page = paging_page_pin(pager, record_id.page_number);
+  if (page == NULL) {
+    warn("Read page %" PRIu64 " error", record_id.page_number);
+    return NULL;
+  }
+
+  if (record_id.slot_number >= paging_page_header(page)->slots_count ||
+      paging_page_slots(page)[record_id.slot_number].offset == 0) {
+    warn("No record in slot %" PRIu16 " of page %" PRIu64,
+         record_id.slot_number, record_id.page_number);
+    paging_page_unpin(pager, record_id.page_number, false);
+    return NULL;
+  }
+
+  return page;
+}
+
+struct paging_update_result paging_update(struct paging_pager *pager,
+                                          struct paging_info info,
+                                          const void *data, size_t data_size) {
+  if (pager == NULL || data == NULL || data_size == 0) {
+    return (struct paging_update_result){.success = false};
+  }
+
+  const uint64_t page_number = info.record_id.page_number;
+  const uint16_t slot_number = info.record_id.slot_number;
+  void *page = paging_record_pin(pager, info.record_id);
+  if (page == NULL) {
+    return (struct paging_update_result){.success = false};
+  }
+
+  const struct paging_file_slot old_slot =
+      paging_page_slots(page)[slot_number];
+  struct paging_file_overflow old_overflow;
+  if (old_slot.flags & PAGING_SLOT_FLAG_OVERFLOW) {
+    memcpy(&old_overflow, (char *)paging_page_data(page) + old_slot.offset,
+           sizeof(old_overflow));
+  }
+  const size_t space = paging_page_replace_space(page, slot_number);
+  paging_page_unpin(pager, page_number, false);
+
+  const void *record = data;
+  size_t record_size = data_size;
+  uint16_t flags = 0;
+
+  // Data that does not fit into the page any more goes to overflow pages,
+  // so that the record does not have to move to another page
+  struct paging_file_overflow overflow = {.size = data_size};
+  if (data_size > paging_inline_record_max_size(pager) ||
+      ROUND_UP(data_size, PAGING_RECORD_ALIGNMENT) > space) {
+    if (ROUND_UP(sizeof(overflow), PAGING_RECORD_ALIGNMENT) > space) {
+      warn("Record in slot %" PRIu16 " of page %" PRIu64 " can not grow",
+           slot_number, page_number);
+      return (struct paging_update_result){.success = false};
+    }
+    if (!paging_overflow_write(pager, data, &overflow)) {
+      warn("Overflow pages write error");
+      return (struct paging_update_result){.success = false};
+    }
+
+    record = &overflow;
+    record_size = sizeof(overflow);
+    flags = PAGING_SLOT_FLAG_OVERFLOW;
+  }
+
+  page = paging_page_pin(pager, page_number);
+  if (page == NULL) {
+    warn("Read page %" PRIu64 " error", page_number);
+    if (flags & PAGING_SLOT_FLAG_OVERFLOW) {
+      paging_overflow_free(pager, overflow);
+    }
+    return (struct paging_update_result){.success = false};
+  }
+
+  paging_page_replace(pager, page, slot_number, record, record_size, flags);
+  paging_page_fsm_update(pager, info.chain, page_number, page);
+  paging_page_unpin(pager, page_number, true);
+
+  if ((old_slot.flags & PAGING_SLOT_FLAG_OVERFLOW) &&
+      !paging_overflow_free(pager, old_overflow)) {
+    return (struct paging_update_result){.success = false};
+  }
+
+  return (struct paging_update_result){.success = true};
+}
+
+// Takes an empty page out of its chain and frees it.
+static bool paging_page_unlink(struct paging_pager *pager,
+                               struct paging_chain chain, uint64_t page_number,
+                               struct paging_file_page_header header) {
+  if (!paging_page_link(pager, header.previous_page_number,
+                        header.next_page_number)) {
+    return false;
+  }
+
+  if (header.next_page_number != PAGING_INVALID_PAGE_NUMBER) {
+    void *page = paging_page_pin(pager, header.next_page_number);
+    if (page == NULL) {
+      warn("Read page %" PRIu64 " error", header.next_page_number);
+      return false;
+    }
+
+    paging_page_header(page)->previous_page_number =
+        header.previous_page_number;
+    paging_page_unpin(pager, header.next_page_number, true);
+  } else {
+    void *root_page = paging_page_pin(pager, chain.root_page_number);
+    if (root_page == NULL) {
+      warn("Read chain root page %" PRIu64 " error", chain.root_page_number);
+      return false;
+    }
+
+    paging_page_header(root_page)->last_page_number =
+        header.previous_page_number;
+    paging_page_unpin(pager, chain.root_page_number, true);
+  }
+
+  struct paging_file_page_header free_header;
+  return paging_page_free(pager, page_number, &free_header);
+}
+
+struct paging_remove_result paging_remove(struct paging_pager *pager,
+                                          struct paging_info info) {
+  if (pager == NULL ||
+      info.record_id.page_number == PAGING_INVALID_PAGE_NUMBER) {
+    return (struct paging_remove_result){.success = false};
+  }
+
+  const uint64_t page_number = info.record_id.page_number;
+  const uint16_t slot_number = info.record_id.slot_number;
+  void *page = paging_record_pin(pager, info.record_id);
+  if (page == NULL) {
+    return (struct paging_remove_result){.success = false};
+  }
+
+  const struct paging_file_slot slot = paging_page_slots(page)[slot_number];
+  struct paging_file_overflow overflow;
+  if (slot.flags & PAGING_SLOT_FLAG_OVERFLOW) {
+    memcpy(&overflow, (char *)paging_page_data(page) + slot.offset,
+           sizeof(overflow));
+  }
+
+  paging_page_remove(pager, page, slot_number);
+  const struct paging_file_page_header header = *paging_page_header(page);
+  paging_page_fsm_update(pager, info.chain, page_number, page);
+  paging_page_unpin(pager, page_number, true);
+
+  if ((slot.flags & PAGING_SLOT_FLAG_OVERFLOW) &&
+      !paging_overflow_free(pager, overflow)) {
+    return (struct paging_remove_result){.success = false};
+  }
+
+  if (header.slots_count == 0 && page_number != info.chain.root_page_number) {
+    paging_fsm_set(pager->fsm, info.chain.root_page_number, page_number, 0);
+    if (!paging_page_unlink(pager, info.chain, page_number, header)) {
+      return (struct paging_remove_result){.success = false};
+    }
+  }
+
+  return (struct paging_remove_result){.success = true};
+}
+
+// Reads an overflow extent, zero-copy for the mmap backend
+static struct paging_read_result
+paging_overflow_read_data(const struct paging_pager *pager,
+                          struct paging_file_overflow overflow, void **data) {
+  // Overflow extents are contiguous in the file, so they are contiguous in
+  // the mapping as well
+  if (pager->backend == PAGING_BACKEND_MMAP) {
+    *data = paging_mmap_get(
+        pager->mmap, paging_page_position(pager, overflow.first_page_number),
+        overflow.size);
+    return (struct paging_read_result){.success = *data != NULL,
+                                       .is_data_owned = false,
+                                       .size = overflow.size};
+  }
+
+  *data = malloc(overflow.size);
+  if (*data == NULL) {
+    warn("Alloc data error");
+    return (struct paging_read_result){.success = false};
+  }
+
+  if (!paging_overflow_read(pager, overflow, *data)) {
+    free(*data);
+    return (struct paging_read_result){.success = false};
+  }
+
+  return (struct paging_read_result){
+      .success = true, .is_data_owned = true, .size = overflow.size};
+}
+
+static struct paging_read_result
+paging_read_record(const struct paging_pager *pager, uint64_t page_number,
+                   void *page, struct paging_file_slot slot, void **data) {
+  const void *record = (char *)paging_page_data(page) + slot.offset;
+
+  if (slot.flags & PAGING_SLOT_FLAG_OVERFLOW) {
+    struct paging_file_overflow overflow;
+    memcpy(&overflow, record, sizeof(overflow));
+    paging_page_unpin(pager, page_number, false);
+    return paging_overflow_read_data(pager, overflow, data);
+  }
+
+  if (pager->backend == PAGING_BACKEND_MMAP) {
+    *data = (void *)record;
+    return (struct paging_read_result){
+        .success = true, .is_data_owned = false, .size = slot.size};
+  }
+
+  *data = malloc(slot.size);
+  if (*data == NULL) {
+    warn("Alloc data error");
+    paging_page_unpin(pager, page_number, false);
+    return (struct paging_read_result){.success = false};
+  }
+
+  memcpy(*data, record, slot.size);
+  paging_page_unpin(pager, page_number, false);
+  return (struct paging_read_result){
+      .success = true, .is_data_owned = true, .size = slot.size};
+}
+
+// Reads the next page number from the page header when it can be done
+// without waiting for the disk
+static bool paging_page_next_peek(const struct paging_pager *pager,
+                                  uint64_t page_number,
+                                  uint64_t *next_page_number) {
+  struct paging_file_page_header header;
+  const long position = paging_page_position(pager, page_number);
+  switch (pager->backend) {
+  case PAGING_BACKEND_BUFFERED: {
+    const void *page = paging_buffer_pool_peek(pager->buffer_pool, page_number);
+    if (page != NULL) {
+      memcpy(&header, page, sizeof(header));
+      break;
+    }
+    // The file has a stale version of pages that have images in the log
+    if (pager->wal != NULL && paging_wal_contains(pager->wal, page_number)) {
+      return false;
+    }
+    if (pager->compression == PAGING_COMPRESSION_NONE) {
+      if (!paging_io_read_cached(pager->fd, &header, sizeof(header),
+                                 position)) {
+        return false;
+      }
+      break;
+    }
+
+    // The header of a compressed page is at the start of its first block
+    char block[PAGING_LZ_BLOCK_SIZE];
+    if (!paging_io_read_cached(pager->fd, block, sizeof(block), position)) {
+      return false;
+    }
+    if (!paging_lz_page_decode_prefix(block, &header, sizeof(header))) {
+      memcpy(&header, block, sizeof(header));
+    }
+  } break;
+  case PAGING_BACKEND_MMAP:
+    if (!paging_mmap_is_resident(pager->mmap, position, sizeof(header))) {
+      return false;
+    }
+    memcpy(&header, paging_mmap_get(pager->mmap, position, sizeof(header)),
+           sizeof(header));
+    break;
+  }
+
+  *next_page_number = header.next_page_number;
+  return true;
+}
+
+static void paging_page_prefetch(const struct paging_pager *pager,
+                                 uint64_t page_number) {
+  const long position = paging_page_position(pager, page_number);
+  switch (pager->backend) {
+  case PAGING_BACKEND_BUFFERED:
+    if (paging_buffer_pool_peek(pager->buffer_pool, page_number) == NULL &&
+        (pager->wal == NULL || !paging_wal_contains(pager->wal, page_number))) {
+      paging_io_prefetch(pager->fd, pager->page_size, position);
+    }
+    break;
+  case PAGING_BACKEND_MMAP:
+    paging_mmap_prefetch(pager->mmap, position, pager->page_size);
+    break;
+  }
+}
+
+// Called when a scan enters a page. Keeps the following pages of the chain
+// prefetched: the window moves one page forward with the scan and is
+// extended through pages whose headers are already in memory, so the walk
+// never waits for the disk itself.
+static void paging_readahead_advance(const struct paging_pager *pager,
+                                     uint64_t page_number,
+                                     uint64_t next_page_number) {
+  struct paging_readahead *readahead = pager->readahead;
+  if (readahead == NULL || readahead->current_page_number == page_number) {
+    return;
+  }
+
+  readahead->current_page_number = page_number;
+  if (readahead->count > 0 &&
+      readahead->page_numbers[readahead->head] == page_number) {
+    readahead->head = (readahead->head + 1) % readahead->capacity;
+    readahead->count -= 1;
+  } else {
+    // Another chain or another place of the chain
+    readahead->count = 0;
+  }
+
+  if (readahead->count > 0) {
+    const uint64_t last_page_number =
+        readahead->page_numbers[(readahead->head + readahead->count - 1) %
+                                readahead->capacity];
+    if (!paging_page_next_peek(pager, last_page_number, &next_page_number)) {
+      return;
+    }
+  }
+
+  while (next_page_number != PAGING_INVALID_PAGE_NUMBER &&
+         readahead->count < readahead->capacity) {
+    paging_page_prefetch(pager, next_page_number);
+    readahead->page_numbers[(readahead->head + readahead->count) %
+                            readahead->capacity] = next_page_number;
+    readahead->count += 1;
+
+    if (!paging_page_next_peek(pager, next_page_number, &next_page_number)) {
+      return;
+    }
+  }
+}
+
+// Reads the first record at or after the given slot.
+static struct paging_read_result
+paging_read(const struct paging_pager *pager, struct paging_chain chain,
+            uint64_t page_number, uint16_t slot_number, void **data) {
+  while (page_number != PAGING_INVALID_PAGE_NUMBER) {
+    void *page = paging_page_pin(pager, page_number);
+    if (page == NULL) {
+      warn("Read page %" PRIu64 " error", page_number);
+      return (struct paging_read_result){.success = false};
+    }
+
+    const struct paging_file_page_header header = *paging_page_header(page);
+    paging_readahead_advance(pager, page_number, header.next_page_number);
+    if (slot_number == 0) {
+      pager->stats->stats.scanned_pages_count++;
+      paging_page_fsm_update(pager, chain, page_number, page);
+    }
+    for (; slot_number < header.slots_count; slot_number++) {
+      const struct paging_file_slot slot =
+          paging_page_slots(page)[slot_number];
+      if (slot.offset == 0) {
+        continue;
+      }
+
+      struct paging_read_result result =
+          paging_read_record(pager, page_number, page, slot, data);
+      result.info = (struct paging_info){
+          .chain = chain,
+          .record_id = {.page_number = page_number,
+                        .slot_number = slot_number}};
+      return result;
+    }
+
+    paging_page_unpin(pager, page_number, false);
+    page_number = header.next_page_number;
+    slot_number = 0;
+  }
+
+  return (struct paging_read_result){.success = false};
+}
+
+struct paging_read_result paging_fetch(const struct paging_pager *pager,
+                                       struct paging_info info, void **data) {
+  if (pager == NULL) {
+    return (struct paging_read_result){.success = false};
+  }
+
+  void *page = paging_record_pin(pager, info.record_id);
+  if (page == NULL) {
+    return (struct paging_read_result){.success = false};
+  }
+
+  const struct paging_file_slot slot =
+      paging_page_slots(page)[info.record_id.slot_number];
+  struct paging_read_result result = paging_read_record(
+      pager, info.record_id.page_number, page, slot, data);
+  result.info = info;
+  return result;
 }
 
 struct paging_read_result paging_read_first(const struct paging_pager *pager,
-                                            enum paging_type type,
+                                            struct paging_chain chain,
                                             void **data) {
-  const uint64_t page_number = paging_first_page_number(pager, type);
-  struct paging_read_result result = paging_read(pager, page_number, data);
-  result.info.previous_last_page_number = PAGING_INVALID_PAGE_NUMBER;
-  result.info.type = type;
-  return result;
+  if (pager == NULL) {
+    return (struct paging_read_result){.success = false};
+  }
+
+  pager->stats->stats.scans_count++;
+  return paging_read(pager, chain, chain.root_page_number, 0, data);
 }
 
 struct paging_read_result paging_read_next(const struct paging_pager *pager,
                                            struct paging_info info,
                                            void **data) {
-  const uint64_t page_number = info.next_first_page_number;
-  struct paging_read_result result = paging_read(pager, page_number, data);
-  result.info.previous_last_page_number = info.current_last_page_number;
-  result.info.type = info.type;
-  return result;
-}
\ No newline at end of file
+  return paging_read(pager, info.chain, info.record_id.page_number,
+                     info.record_id.slot_number + 1, data);
+}
+
+struct paging_blob_write_result
+paging_blob_write(struct paging_pager *pager, const void *data, size_t size) {
+  if (pager == NULL || data == NULL || size == 0) {
+    return (struct paging_blob_write_result){.success = false};
+  }
+
+  struct paging_file_overflow overflow = {.size = size};
+  if (!paging_overflow_write(pager, data, &overflow)) {
+    warn("Blob pages write error");
+    return (struct paging_blob_write_result){.success = false};
+  }
+
+  return (struct paging_blob_write_result){
+      .success = true,
+      .blob = {.first_page_number = overflow.first_page_number,
+               .size = overflow.size}};
+}
+
+struct paging_blob_read_result
+paging_blob_read(const struct paging_pager *pager, struct paging_blob blob,
+                 void **data) {
+  if (pager == NULL || blob.size == 0) {
+    return (struct paging_blob_read_result){.success = false};
+  }
+
+  const struct paging_file_overflow overflow = {
+      .size = blob.size, .first_page_number = blob.first_page_number};
+  const struct paging_read_result result =
+      paging_overflow_read_data(pager, overflow, data);
+  return (struct paging_blob_read_result){
+      .success = result.success, .is_data_owned = result.is_data_owned};
+}
+
+struct paging_blob_remove_result paging_blob_remove(struct paging_pager *pager,
+                                                    struct paging_blob blob) {
+  if (pager == NULL || blob.size == 0) {
+    return (struct paging_blob_remove_result){.success = false};
+  }
+
+  const struct paging_file_overflow overflow = {
+      .size = blob.size, .first_page_number = blob.first_page_number};
+  return (struct paging_blob_remove_result){
+      .success = paging_overflow_free(pager, overflow)};
+}
+
+struct paging_usage paging_usage(const struct paging_pager *pager) {
+  uint64_t free_pages_count = 0;
+  for (size_t i = 0; i < paging_extents_count(pager->free_extents); i++) {
+    free_pages_count += paging_extents_get(pager->free_extents, i).pages_count;
+  }
+
+  return (struct paging_usage){.pages_count = pager->pages_count,
+                               .free_pages_count = free_pages_count};
+}
+
+size_t paging_record_size_max(const struct paging_pager *pager) {
+  return paging_inline_record_max_size(pager);
+}
+
+// Moves the extent to the free pages with the lowest numbers when they lie
+// before it
+static bool paging_overflow_relocate(struct paging_pager *pager,
+                                     struct paging_file_overflow *overflow) {
+  const uint64_t pages_count =
+      paging_overflow_pages_count(pager, overflow->size);
+  const size_t index =
+      paging_extents_find_first_fit(pager->free_extents, pages_count);
+  if (index == paging_extents_count(pager->free_extents) ||
+      paging_extents_get(pager->free_extents, index).first_page_number >
+          overflow->first_page_number) {
+    return true;
+  }
+
+  uint64_t first_page_number;
+  if (!paging_pages_take(pager, index, pages_count, &first_page_number)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < pages_count; i++) {
+    const uint64_t page_number = overflow->first_page_number + i;
+    if (i % PAGING_BUFFER_POOL_RUN_MAX == 0) {
+      paging_pages_load(pager, page_number,
+                        MIN(pages_count - i, PAGING_BUFFER_POOL_RUN_MAX));
+    }
+
+    const void *page = paging_page_pin(pager, page_number);
+    if (page == NULL) {
+      warn("Read page %" PRIu64 " error", page_number);
+      return false;
+    }
+    memcpy(pager->page_buffer, page, pager->page_size);
+    paging_page_unpin(pager, page_number, false);
+
+    void *new_page = paging_page_pin_new(pager, first_page_number + i);
+    if (new_page == NULL) {
+      warn("New page pin error");
+      return false;
+    }
+    memcpy(new_page, pager->page_buffer, pager->page_size);
+    paging_page_unpin(pager, first_page_number + i, true);
+  }
+
+  const struct paging_file_overflow old_overflow = *overflow;
+  overflow->first_page_number = first_page_number;
+  return paging_overflow_free(pager, old_overflow);
+}
+
+// Makes the page the new last page of the chain being vacuumed
+static bool paging_vacuum_link(struct paging_pager *pager,
+                               uint64_t *last_page_number,
+                               uint64_t page_number) {
+  if (!paging_page_link(pager, *last_page_number, page_number)) {
+    return false;
+  }
+
+  *last_page_number = page_number;
+  return true;
+}
+
+// Moves the records of a page to the last page of the chain being vacuumed
+// while they fit. The rest goes to a free page before the page when there is
+// one, otherwise the page is kept with the rest only.
+static bool paging_vacuum_page(struct paging_pager *pager,
+                               struct paging_chain chain,
+                               uint64_t *last_page_number, uint64_t page_number,
+                               void *old_page) {
+  const struct paging_file_page_header *old_header =
+      paging_page_header(old_page);
+  struct paging_file_slot *old_slots = paging_page_slots(old_page);
+
+  bool is_left = false;
+  for (uint16_t i = 0; i < old_header->slots_count; i++) {
+    struct paging_file_slot *slot = &old_slots[i];
+    if (slot->offset == 0) {
+      continue;
+    }
+
+    void *record = (char *)paging_page_data(old_page) + slot->offset;
+    if (slot->flags & PAGING_SLOT_FLAG_OVERFLOW) {
+      struct paging_file_overflow overflow;
+      memcpy(&overflow, record, sizeof(overflow));
+      if (!paging_overflow_relocate(pager, &overflow)) {
+        return false;
+      }
+      memcpy(record, &overflow, sizeof(overflow));
+    }
+
+    uint16_t slot_number;
+    bool is_inserted;
+    if (!paging_chain_page_insert(pager, chain, *last_page_number, record,
+                                  slot->size, slot->flags, &slot_number,
+                                  &is_inserted)) {
+      return false;
+    }
+
+    if (is_inserted) {
+      slot->offset = 0;
+    } else {
+      is_left = true;
+    }
+  }
+
+  if (!is_left) {
+    return paging_pages_free(pager, page_number, 1);
+  }
+
+  const size_t index = paging_extents_find_first_fit(pager->free_extents, 1);
+  const bool is_moved =
+      index < paging_extents_count(pager->free_extents) &&
+      paging_extents_get(pager->free_extents, index).first_page_number <
+          page_number;
+  uint64_t new_page_number = page_number;
+  if (is_moved && !paging_pages_take(pager, index, 1, &new_page_number)) {
+    return false;
+  }
+
+  void *page = is_moved ? paging_page_pin_new(pager, new_page_number)
+                        : paging_page_pin(pager, page_number);
+  if (page == NULL) {
+    warn("Vacuum page %" PRIu64 " pin error", new_page_number);
+    return false;
+  }
+
+  // The records left come from one page, so they fit into an empty one
+  paging_page_init(pager, page, *last_page_number);
+  for (uint16_t i = 0; i < old_header->slots_count; i++) {
+    const struct paging_file_slot slot = old_slots[i];
+    uint16_t slot_number;
+    if (slot.offset != 0) {
+      paging_page_insert(pager, page,
+                         (char *)paging_page_data(old_page) + slot.offset,
+                         slot.size, slot.flags, &slot_number);
+    }
+  }
+  paging_page_fsm_update(pager, chain, new_page_number, page);
+  paging_page_unpin(pager, new_page_number, true);
+
+  return paging_vacuum_link(pager, last_page_number, new_page_number) &&
+         (!is_moved || paging_pages_free(pager, page_number, 1));
+}
+
+struct paging_vacuum_result paging_chain_vacuum(struct paging_pager *pager,
+                                                struct paging_chain chain) {
+  if (pager == NULL ||
+      chain.root_page_number == PAGING_INVALID_PAGE_NUMBER) {
+    return (struct paging_vacuum_result){.success = false};
+  }
+
+  void *old_page = malloc(pager->page_size);
+  void *root_page = paging_page_pin(pager, chain.root_page_number);
+  if (old_page == NULL || root_page == NULL) {
+    warn("Vacuum of chain %" PRIu64 " start error", chain.root_page_number);
+    if (root_page != NULL) {
+      paging_page_unpin(pager, chain.root_page_number, false);
+    }
+    free(old_page);
+    return (struct paging_vacuum_result){.success = false};
+  }
+
+  // The root page keeps its records and its place, the records of the pages
+  // after it are packed behind them
+  memcpy(old_page, root_page, pager->page_size);
+  paging_page_unpin(pager, chain.root_page_number, false);
+  paging_fsm_forget_chain(pager->fsm, chain.root_page_number);
+
+  bool success = true;
+  const struct paging_file_slot *root_slots = paging_page_slots(old_page);
+  for (uint16_t i = 0;
+       success && i < paging_page_header(old_page)->slots_count; i++) {
+    const struct paging_file_slot slot = root_slots[i];
+    if (slot.offset == 0 || !(slot.flags & PAGING_SLOT_FLAG_OVERFLOW)) {
+      continue;
+    }
+
+    struct paging_file_overflow overflow;
+    memcpy(&overflow, (char *)paging_page_data(old_page) + slot.offset,
+           sizeof(overflow));
+    const uint64_t first_page_number = overflow.first_page_number;
+    success = paging_overflow_relocate(pager, &overflow);
+    if (success && overflow.first_page_number != first_page_number) {
+      root_page = paging_page_pin(pager, chain.root_page_number);
+      success = root_page != NULL;
+      if (success) {
+        memcpy((char *)paging_page_data(root_page) + slot.offset, &overflow,
+               sizeof(overflow));
+        paging_page_unpin(pager, chain.root_page_number, true);
+      }
+    }
+  }
+
+  uint64_t page_number = paging_page_header(old_page)->next_page_number;
+  uint64_t last_page_number = chain.root_page_number;
+  while (success && page_number != PAGING_INVALID_PAGE_NUMBER) {
+    void *page = paging_page_pin(pager, page_number);
+    if (page == NULL) {
+      warn("Read page %" PRIu64 " error", page_number);
+      success = false;
+      break;
+    }
+    memcpy(old_page, page, pager->page_size);
+    paging_page_unpin(pager, page_number, false);
+
+    success = paging_vacuum_page(pager, chain, &last_page_number, page_number,
+                                 old_page);
+    page_number = paging_page_header(old_page)->next_page_number;
+  }
+  free(old_page);
+
+  success = success &&
+            paging_page_link(pager, last_page_number,
+                             PAGING_INVALID_PAGE_NUMBER);
+  if (success) {
+    root_page = paging_page_pin(pager, chain.root_page_number);
+    success = root_page != NULL;
+  }
+  if (success) {
+    paging_page_header(root_page)->last_page_number = last_page_number;
+    paging_page_unpin(pager, chain.root_page_number, true);
+  }
+
+  if (!success) {
+    warn("Vacuum of chain %" PRIu64 " error", chain.root_page_number);
+  }
+  return (struct paging_vacuum_result){.success = success};
+}
+
+struct paging_truncate_result paging_truncate(struct paging_pager *pager) {
+  if (pager == NULL || !paging_commit(pager).success ||
+      (pager->wal != NULL &&
+       !paging_wal_checkpoint(pager->wal, pager->file))) {
+    return (struct paging_truncate_result){.success = false};
+  }
+
+  // The mmap backend truncates the file when the mapping is destroyed
+  if (pager->backend != PAGING_BACKEND_BUFFERED ||
+      pager->allocated_pages_count <= pager->pages_count) {
+    return (struct paging_truncate_result){.success = true};
+  }
+
+  if (ftruncate(pager->fd,
+                (off_t)paging_page_position(pager, pager->pages_count)) != 0) {
+    warn("File truncate error. Errno: %d", errno);
+    return (struct paging_truncate_result){.success = false};
+  }
+
+  pager->allocated_pages_count = pager->pages_count;
+  return (struct paging_truncate_result){.success = true};
+}
+
+struct paging_blob_relocate_result
+paging_blob_relocate(struct paging_pager *pager, struct paging_blob blob) {
+  if (pager == NULL || blob.size == 0) {
+    return (struct paging_blob_relocate_result){.success = false};
+  }
+
+  struct paging_file_overflow overflow = {
+      .size = blob.size, .first_page_number = blob.first_page_number};
+  if (!paging_overflow_relocate(pager, &overflow)) {
+    warn("Blob relocation error");
+    return (struct paging_blob_relocate_result){.success = false};
+  }
+
+  return (struct paging_blob_relocate_result){
+      .success = true,
+      .blob = {.first_page_number = overflow.first_page_number,
+               .size = overflow.size}};
+}
+
+struct paging_stats paging_stats_snapshot(const struct paging_pager *pager) {
+  if (pager == NULL) {
+    return (struct paging_stats){0};
+  }
+
+  return pager->stats->stats;
+}
+
+void paging_stats_reset(struct paging_pager *pager) {
+  if (pager == NULL) {
+    return;
+  }
+
+  pager->stats->stats = (struct paging_stats){0};
+}
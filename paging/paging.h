@@ -5,52 +5,278 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#define PAGING_OPTIONS_DEFAULT                                                 \
+  ((struct paging_options){.backend = PAGING_BACKEND_BUFFERED,                 \
+                           .buffer_pool_frames_count = 256,                    \
+                           .page_size = 4096,                                  \
+                           .wal_file = NULL,                                   \
+                           .wal_checkpoint_size = 4 << 20,                     \
+                           .wal_checkpoint_interval_ms = 1000,                 \
+                           .readahead_pages_count = 16,                        \
+                           .io_engine = PAGING_IO_ENGINE_SYNC,                 \
+                           .compression = PAGING_COMPRESSION_NONE})
+
 struct paging_pager;
 
-enum paging_type {
-  PAGING_TYPE_FREE,
-  PAGING_TYPE_1,
-  PAGING_TYPE_2,
-  PAGING_TYPE_3,
+enum paging_backend {
+  PAGING_BACKEND_BUFFERED,
+  PAGING_BACKEND_MMAP,
+};
+
+enum paging_io_engine {
+  PAGING_IO_ENGINE_SYNC,
+  // Falls back to synchronous I/O when io_uring is unavailable
+  PAGING_IO_ENGINE_IO_URING,
+};
+
+enum paging_compression {
+  PAGING_COMPRESSION_NONE,
+  PAGING_COMPRESSION_LZ,
+};
+
+struct paging_options {
+  enum paging_backend backend;
+  size_t buffer_pool_frames_count;
+  // Power of two from 4 KiB to 64 KiB. Only used when a file is created, an
+  // existing file keeps the page size stored in its header.
+  size_t page_size;
+  // Write-ahead log, changes are written to the file only by checkpoints.
+  // Not supported by the mmap backend, which writes pages in place.
+  FILE *wal_file;
+  // The log is checkpointed by the first commit that finds it this large
+  uint64_t wal_checkpoint_size;
+  // A background thread copies committed pages from the log to the file
+  // this often and when the log reaches the checkpoint size, so commits
+  // checkpoint themselves only when the thread falls behind. 0 turns the
+  // thread off.
+  uint64_t wal_checkpoint_interval_ms;
+  // Pages of a chain prefetched ahead of a scan, 0 turns readahead off
+  size_t readahead_pages_count;
+  // Used by the buffered backend only
+  enum paging_io_engine io_engine;
+  // Only used when a file is created, like the page size. Compressed pages
+  // take only the file system blocks they need, so pages must be at least
+  // 8 KiB. Not supported by the mmap backend.
+  enum paging_compression compression;
+};
+
+#define PAGING_STATS_HISTOGRAM_BUCKETS 32
+
+// Bucket i counts the calls that took from 2^i to 2^(i+1) nanoseconds, the
+// last bucket also counts all longer calls
+struct paging_stats_histogram {
+  uint64_t buckets[PAGING_STATS_HISTOGRAM_BUCKETS];
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+};
+
+// Counted by the thread that uses the pager, checkpoints of the background
+// writer are not counted
+struct paging_stats {
+  // Pins of the buffered backend that did not find their page in the pool
+  // are followed by reads
+  uint64_t page_pins_count;
+  // Transfers of pages between the buffer pool and the file or the log.
+  // Bytes are counted before compression.
+  uint64_t page_reads_count;
+  uint64_t read_calls_count;
+  uint64_t bytes_read;
+  uint64_t page_writes_count;
+  uint64_t write_calls_count;
+  uint64_t bytes_written;
+  // Transfers to or from the file that do not start where the previous one
+  // ended
+  uint64_t seeks_count;
+  uint64_t header_writes_count;
+  uint64_t commits_count;
+  // Checkpoints done by commits themselves
+  uint64_t checkpoints_count;
+  // Pages allocated from free extents and at the end of the file
+  uint64_t free_pages_reused_count;
+  uint64_t pages_appended_count;
+  uint64_t pages_freed_count;
+  uint64_t file_extensions_count;
+  // Chains scanned from their first page and pages entered by scans, so
+  // the ratio is the average length of a scanned chain
+  uint64_t scans_count;
+  uint64_t scanned_pages_count;
+  struct paging_stats_histogram read_latency;
+  // Queued io_uring writes complete in later calls, so only the time to
+  // queue them is counted
+  struct paging_stats_histogram write_latency;
+};
+
+// A chain is a linked list of heap pages identified by its first page. The
+// first page is never freed, so it stays valid while records come and go.
+struct paging_chain {
+  uint64_t root_page_number;
+};
+
+// Records are addressed by their heap page and the slot in that page. A
+// record id does not change while the record exists.
+struct paging_record_id {
+  uint64_t page_number;
+  uint16_t slot_number;
 };
 
 struct paging_info {
-  enum paging_type type;
-  uint64_t previous_last_page_number;
-  uint64_t current_first_page_number;
-  uint64_t current_last_page_number;
-  uint64_t next_first_page_number;
+  struct paging_chain chain;
+  struct paging_record_id record_id;
+};
+
+// A value stored apart from any chain in contiguous pages, for values that
+// should not be read together with the record that refers to them.
+struct paging_blob {
+  uint64_t first_page_number;
+  uint64_t size;
+};
+
+struct paging_blob_write_result {
+  bool success;
+  struct paging_blob blob;
+};
+
+struct paging_blob_read_result {
+  bool success;
+  bool is_data_owned;
+};
+
+struct paging_blob_remove_result {
+  bool success;
+};
+
+struct paging_chain_create_result {
+  bool success;
+  struct paging_chain chain;
+};
+
+struct paging_chain_remove_result {
+  bool success;
 };
 
 struct paging_write_result {
   bool success;
+  struct paging_info info;
+};
+
+struct paging_update_result {
+  bool success;
 };
 
 struct paging_remove_result {
   bool success;
 };
 
+struct paging_commit_result {
+  bool success;
+};
+
 struct paging_read_result {
   bool success;
+  bool is_data_owned;
   struct paging_info info;
+  size_t size;
+};
+
+struct paging_vacuum_result {
+  bool success;
+};
+
+struct paging_truncate_result {
+  bool success;
+};
+
+struct paging_blob_relocate_result {
+  bool success;
+  struct paging_blob blob;
+};
+
+struct paging_usage {
+  uint64_t pages_count;
+  uint64_t free_pages_count;
 };
 
-struct paging_pager *paging_pager_create_and_init(FILE *file);
-struct paging_pager *paging_pager_init(FILE *file);
+struct paging_pager *
+paging_pager_create_and_init(FILE *file, struct paging_options options);
+struct paging_pager *paging_pager_init(FILE *file,
+                                       struct paging_options options);
 
+// Commits pending changes, so the pager must not be destroyed in the middle
+// of a statement.
 void paging_pager_destroy(struct paging_pager *pager);
 
+// Makes all changes since the previous commit durable as one unit when a
+// write-ahead log is used, and writes them to the file otherwise.
+struct paging_commit_result paging_commit(struct paging_pager *pager);
+
+// The chain created together with the file, used to find all other chains.
+struct paging_chain paging_root_chain(const struct paging_pager *pager);
+
+struct paging_chain_create_result
+paging_chain_create(struct paging_pager *pager);
+
+struct paging_chain_remove_result
+paging_chain_remove(struct paging_pager *pager, struct paging_chain chain);
+
 struct paging_write_result paging_write(struct paging_pager *pager,
-                                        enum paging_type type, const void *data,
-                                        size_t size);
+                                        struct paging_chain chain,
+                                        const void *data, size_t size);
+
+// Replaces the record. The record keeps its id even when the new data does
+// not fit into its page, then the data is moved to overflow pages.
+struct paging_update_result paging_update(struct paging_pager *pager,
+                                          struct paging_info info,
+                                          const void *data, size_t size);
 
 struct paging_remove_result paging_remove(struct paging_pager *pager,
                                           struct paging_info info);
 
+// Reads the record with the given id without walking its chain
+struct paging_read_result paging_fetch(const struct paging_pager *pager,
+                                       struct paging_info info, void **data);
+
 struct paging_read_result paging_read_first(const struct paging_pager *pager,
-                                            enum paging_type type, void **data);
+                                            struct paging_chain chain,
+                                            void **data);
 struct paging_read_result paging_read_next(const struct paging_pager *pager,
                                            struct paging_info info,
                                            void **data);
 
+struct paging_blob_write_result
+paging_blob_write(struct paging_pager *pager, const void *data, size_t size);
+
+struct paging_blob_read_result
+paging_blob_read(const struct paging_pager *pager, struct paging_blob blob,
+                 void **data);
+
+struct paging_blob_remove_result paging_blob_remove(struct paging_pager *pager,
+                                                    struct paging_blob blob);
+
+// Moves the blob to free pages before it when there are such pages
+struct paging_blob_relocate_result
+paging_blob_relocate(struct paging_pager *pager, struct paging_blob blob);
+
+// Pages of the file, free pages among them included
+struct paging_usage paging_usage(const struct paging_pager *pager);
+
+// Larger records are moved to overflow pages. A record of this size takes
+// a heap page of its own, so it is updated in place whatever it holds.
+size_t paging_record_size_max(const struct paging_pager *pager);
+
+struct paging_stats paging_stats_snapshot(const struct paging_pager *pager);
+
+void paging_stats_reset(struct paging_pager *pager);
+
+// Packs the records of the chain into as few pages as possible and moves
+// them and their overflow pages to free pages nearer to the start of the
+// file. The chain keeps its root page, but the ids of its other records
+// change, so no record ids of the chain may be held across the call.
+struct paging_vacuum_result paging_chain_vacuum(struct paging_pager *pager,
+                                                struct paging_chain chain);
+
+// Commits and gives the free pages at the end of the file back to the file
+// system.
+struct paging_truncate_result paging_truncate(struct paging_pager *pager);
+
 #endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_H
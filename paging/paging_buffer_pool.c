@@ -0,0 +1,425 @@
+#include "paging_buffer_pool.h"
+#include "logger.h"
+#include "math_utils.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGING_BUFFER_POOL_NO_FRAME SIZE_MAX
+
+struct paging_buffer_pool_frame {
+  uint64_t page_number;
+  size_t pin_count;
+  bool is_used;
+  bool is_dirty;
+  bool is_referenced;
+  size_t hash_next;
+};
+
+struct paging_buffer_pool_dirty {
+  uint64_t page_number;
+  size_t frame_index;
+};
+
+struct paging_buffer_pool {
+  struct paging_buffer_pool_io io;
+  size_t page_size;
+  size_t frames_count;
+  struct paging_buffer_pool_frame *frames;
+  char *pages;
+  size_t buckets_count;
+  size_t *buckets;
+  size_t clock_hand;
+  struct paging_buffer_pool_dirty *flush_order;
+};
+
+struct paging_buffer_pool *
+paging_buffer_pool_create(struct paging_buffer_pool_io io, size_t frames_count,
+                          size_t page_size) {
+  if (io.read_pages == NULL || io.write_pages == NULL || frames_count == 0 ||
+      page_size == 0) {
+    return NULL;
+  }
+
+  struct paging_buffer_pool *pool = malloc(sizeof(struct paging_buffer_pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+
+  size_t buckets_count = 1;
+  while (buckets_count < frames_count * 2) {
+    buckets_count *= 2;
+  }
+
+  pool->io = io;
+  pool->page_size = page_size;
+  pool->frames_count = frames_count;
+  pool->buckets_count = buckets_count;
+  pool->clock_hand = 0;
+  pool->frames = calloc(frames_count, sizeof(struct paging_buffer_pool_frame));
+  // Frames are aligned like the pages in the file
+  pool->pages = aligned_alloc(page_size, frames_count * page_size);
+  pool->buckets = malloc(buckets_count * sizeof(size_t));
+  pool->flush_order =
+      malloc(frames_count * sizeof(struct paging_buffer_pool_dirty));
+  if (pool->frames == NULL || pool->pages == NULL || pool->buckets == NULL ||
+      pool->flush_order == NULL) {
+    free(pool->frames);
+    free(pool->pages);
+    free(pool->buckets);
+    free(pool->flush_order);
+    free(pool);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < buckets_count; i++) {
+    pool->buckets[i] = PAGING_BUFFER_POOL_NO_FRAME;
+  }
+
+  return pool;
+}
+
+void paging_buffer_pool_destroy(struct paging_buffer_pool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  if (!paging_buffer_pool_flush(pool)) {
+    warn("Buffer pool flush error");
+  }
+
+  free(pool->frames);
+  free(pool->pages);
+  free(pool->buckets);
+  free(pool->flush_order);
+  free(pool);
+}
+
+static size_t paging_buffer_pool_bucket(const struct paging_buffer_pool *pool,
+                                        uint64_t page_number) {
+  const uint64_t hash = page_number * UINT64_C(0x9E3779B97F4A7C15);
+  return (size_t)(hash >> 32) & (pool->buckets_count - 1);
+}
+
+static void *
+paging_buffer_pool_frame_page(const struct paging_buffer_pool *pool,
+                              size_t frame_index) {
+  return pool->pages + frame_index * pool->page_size;
+}
+
+static size_t paging_buffer_pool_find(const struct paging_buffer_pool *pool,
+                                      uint64_t page_number) {
+  size_t frame_index =
+      pool->buckets[paging_buffer_pool_bucket(pool, page_number)];
+  while (frame_index != PAGING_BUFFER_POOL_NO_FRAME) {
+    if (pool->frames[frame_index].page_number == page_number) {
+      return frame_index;
+    }
+    frame_index = pool->frames[frame_index].hash_next;
+  }
+  return PAGING_BUFFER_POOL_NO_FRAME;
+}
+
+static void paging_buffer_pool_hash_insert(struct paging_buffer_pool *pool,
+                                           size_t frame_index) {
+  const size_t bucket =
+      paging_buffer_pool_bucket(pool, pool->frames[frame_index].page_number);
+  pool->frames[frame_index].hash_next = pool->buckets[bucket];
+  pool->buckets[bucket] = frame_index;
+}
+
+static void paging_buffer_pool_hash_remove(struct paging_buffer_pool *pool,
+                                           size_t frame_index) {
+  size_t *link = &pool->buckets[paging_buffer_pool_bucket(
+      pool, pool->frames[frame_index].page_number)];
+  while (*link != frame_index) {
+    link = &pool->frames[*link].hash_next;
+  }
+  *link = pool->frames[frame_index].hash_next;
+}
+
+static bool paging_buffer_pool_write_run(struct paging_buffer_pool *pool,
+                                         const size_t *frame_indexes,
+                                         size_t count) {
+  const void *pages[PAGING_BUFFER_POOL_RUN_MAX];
+  for (size_t i = 0; i < count; i++) {
+    pages[i] = paging_buffer_pool_frame_page(pool, frame_indexes[i]);
+  }
+
+  const uint64_t first_page_number = pool->frames[frame_indexes[0]].page_number;
+  if (!pool->io.write_pages(pool->io.context, first_page_number, pages,
+                            count)) {
+    warn("Pages %" PRIu64 "-%" PRIu64 " write error", first_page_number,
+         first_page_number + count - 1);
+    return false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    pool->frames[frame_indexes[i]].is_dirty = false;
+  }
+  return true;
+}
+
+static bool paging_buffer_pool_read_run(struct paging_buffer_pool *pool,
+                                        const size_t *frame_indexes,
+                                        size_t count) {
+  void *pages[PAGING_BUFFER_POOL_RUN_MAX];
+  for (size_t i = 0; i < count; i++) {
+    pages[i] = paging_buffer_pool_frame_page(pool, frame_indexes[i]);
+  }
+
+  const uint64_t first_page_number = pool->frames[frame_indexes[0]].page_number;
+  if (!pool->io.read_pages(pool->io.context, first_page_number, pages, count)) {
+    warn("Pages %" PRIu64 "-%" PRIu64 " read error", first_page_number,
+         first_page_number + count - 1);
+    return false;
+  }
+
+  return true;
+}
+
+static bool paging_buffer_pool_wait(struct paging_buffer_pool *pool) {
+  if (pool->io.wait != NULL && !pool->io.wait(pool->io.context)) {
+    warn("Page write wait error");
+    return false;
+  }
+  return true;
+}
+
+static size_t paging_buffer_pool_victim(struct paging_buffer_pool *pool) {
+  // CLOCK: a referenced frame gets a second chance, so two full turns of
+  // the hand are enough to find any unpinned frame.
+  for (size_t step = 0; step < pool->frames_count * 2; step++) {
+    const size_t frame_index = pool->clock_hand;
+    pool->clock_hand = (pool->clock_hand + 1) % pool->frames_count;
+
+    struct paging_buffer_pool_frame *frame = &pool->frames[frame_index];
+    if (!frame->is_used) {
+      return frame_index;
+    }
+    if (frame->pin_count > 0) {
+      continue;
+    }
+    if (frame->is_referenced) {
+      frame->is_referenced = false;
+      continue;
+    }
+    return frame_index;
+  }
+
+  return PAGING_BUFFER_POOL_NO_FRAME;
+}
+
+// Takes a frame for the page and pins it. The frame content is not read.
+static size_t paging_buffer_pool_acquire(struct paging_buffer_pool *pool,
+                                         uint64_t page_number) {
+  const size_t frame_index = paging_buffer_pool_victim(pool);
+  if (frame_index == PAGING_BUFFER_POOL_NO_FRAME) {
+    return PAGING_BUFFER_POOL_NO_FRAME;
+  }
+
+  struct paging_buffer_pool_frame *frame = &pool->frames[frame_index];
+  if (frame->is_used) {
+    if (frame->is_dirty &&
+        (!paging_buffer_pool_write_run(pool, &frame_index, 1) ||
+         !paging_buffer_pool_wait(pool))) {
+      return PAGING_BUFFER_POOL_NO_FRAME;
+    }
+    paging_buffer_pool_hash_remove(pool, frame_index);
+  }
+
+  frame->page_number = page_number;
+  frame->is_used = true;
+  frame->is_dirty = false;
+  frame->is_referenced = true;
+  frame->pin_count = 1;
+  paging_buffer_pool_hash_insert(pool, frame_index);
+  return frame_index;
+}
+
+static void paging_buffer_pool_release(struct paging_buffer_pool *pool,
+                                       size_t frame_index) {
+  paging_buffer_pool_hash_remove(pool, frame_index);
+  pool->frames[frame_index].is_used = false;
+  pool->frames[frame_index].pin_count = 0;
+}
+
+static void *paging_buffer_pool_pin_internal(struct paging_buffer_pool *pool,
+                                             uint64_t page_number,
+                                             bool is_new) {
+  if (pool == NULL) {
+    return NULL;
+  }
+
+  size_t frame_index = paging_buffer_pool_find(pool, page_number);
+  if (frame_index != PAGING_BUFFER_POOL_NO_FRAME) {
+    struct paging_buffer_pool_frame *frame = &pool->frames[frame_index];
+    frame->pin_count += 1;
+    frame->is_referenced = true;
+    void *page = paging_buffer_pool_frame_page(pool, frame_index);
+    if (is_new) {
+      memset(page, 0, pool->page_size);
+    }
+    return page;
+  }
+
+  frame_index = paging_buffer_pool_acquire(pool, page_number);
+  if (frame_index == PAGING_BUFFER_POOL_NO_FRAME) {
+    warn("No buffer pool frame for page %" PRIu64, page_number);
+    return NULL;
+  }
+
+  void *page = paging_buffer_pool_frame_page(pool, frame_index);
+  if (is_new) {
+    memset(page, 0, pool->page_size);
+  } else if (!paging_buffer_pool_read_run(pool, &frame_index, 1)) {
+    paging_buffer_pool_release(pool, frame_index);
+    return NULL;
+  }
+
+  return page;
+}
+
+void *paging_buffer_pool_pin(struct paging_buffer_pool *pool,
+                             uint64_t page_number) {
+  return paging_buffer_pool_pin_internal(pool, page_number, false);
+}
+
+void *paging_buffer_pool_pin_new(struct paging_buffer_pool *pool,
+                                 uint64_t page_number) {
+  return paging_buffer_pool_pin_internal(pool, page_number, true);
+}
+
+const void *paging_buffer_pool_peek(const struct paging_buffer_pool *pool,
+                                    uint64_t page_number) {
+  if (pool == NULL) {
+    return NULL;
+  }
+
+  const size_t frame_index = paging_buffer_pool_find(pool, page_number);
+  if (frame_index == PAGING_BUFFER_POOL_NO_FRAME) {
+    return NULL;
+  }
+  return paging_buffer_pool_frame_page(pool, frame_index);
+}
+
+void paging_buffer_pool_unpin(struct paging_buffer_pool *pool,
+                              uint64_t page_number, bool is_dirty) {
+  if (pool == NULL) {
+    return;
+  }
+
+  const size_t frame_index = paging_buffer_pool_find(pool, page_number);
+  if (frame_index == PAGING_BUFFER_POOL_NO_FRAME ||
+      pool->frames[frame_index].pin_count == 0) {
+    warn("Unpin of page %" PRIu64 " that is not pinned", page_number);
+    return;
+  }
+
+  struct paging_buffer_pool_frame *frame = &pool->frames[frame_index];
+  frame->pin_count -= 1;
+  frame->is_dirty = frame->is_dirty || is_dirty;
+}
+
+bool paging_buffer_pool_load(struct paging_buffer_pool *pool,
+                             uint64_t first_page_number, uint64_t pages_count) {
+  if (pool == NULL) {
+    return false;
+  }
+
+  // Frames of a run stay pinned until the run is read, so a run must leave
+  // frames for the pages pinned by the caller.
+  size_t run_max = MIN(pool->frames_count / 2, PAGING_BUFFER_POOL_RUN_MAX);
+  run_max = MAX(run_max, 1);
+
+  const uint64_t end_page_number = first_page_number + pages_count;
+  uint64_t page_number = first_page_number;
+  while (page_number < end_page_number) {
+    if (paging_buffer_pool_find(pool, page_number) !=
+        PAGING_BUFFER_POOL_NO_FRAME) {
+      page_number += 1;
+      continue;
+    }
+
+    size_t run[PAGING_BUFFER_POOL_RUN_MAX];
+    size_t count = 0;
+    bool is_exhausted = false;
+    while (count < run_max && page_number < end_page_number &&
+           paging_buffer_pool_find(pool, page_number) ==
+               PAGING_BUFFER_POOL_NO_FRAME) {
+      const size_t frame_index = paging_buffer_pool_acquire(pool, page_number);
+      if (frame_index == PAGING_BUFFER_POOL_NO_FRAME) {
+        is_exhausted = true;
+        break;
+      }
+      run[count++] = frame_index;
+      page_number += 1;
+    }
+
+    const bool is_read =
+        count == 0 || paging_buffer_pool_read_run(pool, run, count);
+    for (size_t i = 0; i < count; i++) {
+      if (is_read) {
+        pool->frames[run[i]].pin_count = 0;
+      } else {
+        paging_buffer_pool_release(pool, run[i]);
+      }
+    }
+    if (!is_read) {
+      return false;
+    }
+    // Loading is only a hint, pages that did not fit are read on pin
+    if (is_exhausted) {
+      return true;
+    }
+  }
+
+  return true;
+}
+
+static int paging_buffer_pool_compare_dirty(const void *lhs, const void *rhs) {
+  const uint64_t lhs_page_number =
+      ((const struct paging_buffer_pool_dirty *)lhs)->page_number;
+  const uint64_t rhs_page_number =
+      ((const struct paging_buffer_pool_dirty *)rhs)->page_number;
+  return (lhs_page_number > rhs_page_number) -
+         (lhs_page_number < rhs_page_number);
+}
+
+bool paging_buffer_pool_flush(struct paging_buffer_pool *pool) {
+  if (pool == NULL) {
+    return false;
+  }
+
+  struct paging_buffer_pool_dirty *dirty = pool->flush_order;
+  size_t dirty_count = 0;
+  for (size_t i = 0; i < pool->frames_count; i++) {
+    if (pool->frames[i].is_used && pool->frames[i].is_dirty) {
+      dirty[dirty_count].page_number = pool->frames[i].page_number;
+      dirty[dirty_count].frame_index = i;
+      dirty_count += 1;
+    }
+  }
+  qsort(dirty, dirty_count, sizeof(struct paging_buffer_pool_dirty),
+        paging_buffer_pool_compare_dirty);
+
+  size_t run[PAGING_BUFFER_POOL_RUN_MAX];
+  size_t run_count = 0;
+  bool success = true;
+  for (size_t i = 0; success && i < dirty_count; i++) {
+    const bool is_continued =
+        run_count > 0 && run_count < PAGING_BUFFER_POOL_RUN_MAX &&
+        dirty[i].page_number == dirty[i - 1].page_number + 1;
+    if (run_count > 0 && !is_continued) {
+      success = paging_buffer_pool_write_run(pool, run, run_count);
+      run_count = 0;
+    }
+    run[run_count++] = dirty[i].frame_index;
+  }
+
+  success = success && (run_count == 0 ||
+                        paging_buffer_pool_write_run(pool, run, run_count));
+  // Runs written so far must be complete even if a later run failed
+  return paging_buffer_pool_wait(pool) && success;
+}
@@ -0,0 +1,63 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_BUFFER_POOL_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_BUFFER_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct paging_buffer_pool;
+
+// Where pages are read from and written back to. Both callbacks transfer a
+// run of pages with consecutive numbers starting at the first page number,
+// so a run can be moved with a single vectored call.
+//
+// Writes may be asynchronous when wait is given: written frames are left
+// untouched until wait returns, which the pool calls before reusing a frame
+// and at the end of a flush.
+struct paging_buffer_pool_io {
+  void *context;
+  bool (*read_pages)(void *context, uint64_t first_page_number,
+                     void *const *pages, size_t count);
+  bool (*write_pages)(void *context, uint64_t first_page_number,
+                      const void *const *pages, size_t count);
+  bool (*wait)(void *context);
+};
+
+// The longest run passed to the io callbacks
+#define PAGING_BUFFER_POOL_RUN_MAX 64
+
+// Page size must be a power of two, frames are aligned to it
+struct paging_buffer_pool *
+paging_buffer_pool_create(struct paging_buffer_pool_io io, size_t frames_count,
+                          size_t page_size);
+
+void paging_buffer_pool_destroy(struct paging_buffer_pool *pool);
+
+// Returns page bytes (page header followed by page data) pinned in memory.
+// The page stays in its frame until every pin is released with unpin.
+void *paging_buffer_pool_pin(struct paging_buffer_pool *pool,
+                             uint64_t page_number);
+
+// Same as pin, but the page is past the end of the file, so it is not read
+// and its frame is zero filled.
+void *paging_buffer_pool_pin_new(struct paging_buffer_pool *pool,
+                                 uint64_t page_number);
+
+// Returns the page if it is in the pool without pinning it, so the page may
+// be evicted by the next pin.
+const void *paging_buffer_pool_peek(const struct paging_buffer_pool *pool,
+                                    uint64_t page_number);
+
+void paging_buffer_pool_unpin(struct paging_buffer_pool *pool,
+                              uint64_t page_number, bool is_dirty);
+
+// Reads the pages of the range that are not in the pool yet without pinning
+// them. Missing pages next to each other are read as one run.
+bool paging_buffer_pool_load(struct paging_buffer_pool *pool,
+                             uint64_t first_page_number, uint64_t pages_count);
+
+// Writes dirty pages back in order of page numbers, so that dirty pages next
+// to each other in the file are written as one run.
+bool paging_buffer_pool_flush(struct paging_buffer_pool *pool);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_BUFFER_POOL_H
@@ -0,0 +1,156 @@
+#include "paging_extents.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct paging_extents {
+  size_t count;
+  size_t capacity;
+  struct paging_extent *items;
+};
+
+struct paging_extents *paging_extents_create(void) {
+  struct paging_extents *extents = malloc(sizeof(struct paging_extents));
+  if (extents == NULL) {
+    return NULL;
+  }
+
+  extents->count = 0;
+  extents->capacity = 0;
+  extents->items = NULL;
+  return extents;
+}
+
+void paging_extents_destroy(struct paging_extents *extents) {
+  if (extents == NULL) {
+    return;
+  }
+
+  free(extents->items);
+  free(extents);
+}
+
+size_t paging_extents_count(const struct paging_extents *extents) {
+  return extents->count;
+}
+
+struct paging_extent paging_extents_get(const struct paging_extents *extents,
+                                        size_t index) {
+  return extents->items[index];
+}
+
+size_t paging_extents_find_best_fit(const struct paging_extents *extents,
+                                    uint64_t pages_count) {
+  size_t best_index = extents->count;
+  for (size_t i = 0; i < extents->count; i++) {
+    const uint64_t extent_pages_count = extents->items[i].pages_count;
+    if (extent_pages_count < pages_count) {
+      continue;
+    }
+    if (extent_pages_count == pages_count) {
+      return i;
+    }
+    if (best_index == extents->count ||
+        extent_pages_count < extents->items[best_index].pages_count) {
+      best_index = i;
+    }
+  }
+  return best_index;
+}
+
+size_t paging_extents_find_first_fit(const struct paging_extents *extents,
+                                     uint64_t pages_count) {
+  for (size_t i = 0; i < extents->count; i++) {
+    if (extents->items[i].pages_count >= pages_count) {
+      return i;
+    }
+  }
+  return extents->count;
+}
+
+// Index of the first extent that starts after the page
+static size_t paging_extents_upper_bound(const struct paging_extents *extents,
+                                         uint64_t page_number) {
+  size_t low = 0;
+  size_t high = extents->count;
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if (extents->items[middle].first_page_number <= page_number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool paging_extents_insert(struct paging_extents *extents,
+                           struct paging_extent extent, size_t *index) {
+  size_t position =
+      paging_extents_upper_bound(extents, extent.first_page_number);
+
+  const bool is_merged_with_previous =
+      position > 0 && extents->items[position - 1].first_page_number +
+                              extents->items[position - 1].pages_count ==
+                          extent.first_page_number;
+  const bool is_merged_with_next =
+      position < extents->count &&
+      extent.first_page_number + extent.pages_count ==
+          extents->items[position].first_page_number;
+
+  if (is_merged_with_previous) {
+    position -= 1;
+    extents->items[position].pages_count += extent.pages_count;
+    if (is_merged_with_next) {
+      extents->items[position].pages_count +=
+          extents->items[position + 1].pages_count;
+      paging_extents_remove(extents, position + 1);
+    }
+    *index = position;
+    return true;
+  }
+
+  if (is_merged_with_next) {
+    extents->items[position].first_page_number = extent.first_page_number;
+    extents->items[position].pages_count += extent.pages_count;
+    *index = position;
+    return true;
+  }
+
+  if (extents->count == extents->capacity) {
+    const size_t capacity = extents->capacity == 0 ? 16 : extents->capacity * 2;
+    struct paging_extent *items =
+        realloc(extents->items, capacity * sizeof(struct paging_extent));
+    if (items == NULL) {
+      return false;
+    }
+
+    extents->items = items;
+    extents->capacity = capacity;
+  }
+
+  memmove(&extents->items[position + 1], &extents->items[position],
+          (extents->count - position) * sizeof(struct paging_extent));
+  extents->items[position] = extent;
+  extents->count += 1;
+  *index = position;
+  return true;
+}
+
+void paging_extents_take(struct paging_extents *extents, size_t index,
+                         uint64_t pages_count) {
+  struct paging_extent *extent = &extents->items[index];
+  if (extent->pages_count <= pages_count) {
+    paging_extents_remove(extents, index);
+    return;
+  }
+
+  extent->first_page_number += pages_count;
+  extent->pages_count -= pages_count;
+}
+
+void paging_extents_remove(struct paging_extents *extents, size_t index) {
+  memmove(&extents->items[index], &extents->items[index + 1],
+          (extents->count - index - 1) * sizeof(struct paging_extent));
+  extents->count -= 1;
+}
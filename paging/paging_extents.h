@@ -0,0 +1,47 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_EXTENTS_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_EXTENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct paging_extent {
+  uint64_t first_page_number;
+  uint64_t pages_count;
+};
+
+// Set of non-overlapping extents sorted by first page number. Adjacent
+// extents are merged on insert.
+struct paging_extents;
+
+struct paging_extents *paging_extents_create(void);
+
+void paging_extents_destroy(struct paging_extents *extents);
+
+size_t paging_extents_count(const struct paging_extents *extents);
+
+struct paging_extent paging_extents_get(const struct paging_extents *extents,
+                                        size_t index);
+
+// Returns the index of the smallest extent with at least pages_count pages,
+// or the extents count when there is no such extent.
+size_t paging_extents_find_best_fit(const struct paging_extents *extents,
+                                    uint64_t pages_count);
+
+// Returns the index of the extent with the lowest page numbers that has at
+// least pages_count pages, or the extents count when there is no such extent.
+size_t paging_extents_find_first_fit(const struct paging_extents *extents,
+                                     uint64_t pages_count);
+
+// Inserts the extent and stores the index of the extent it ended up in.
+bool paging_extents_insert(struct paging_extents *extents,
+                           struct paging_extent extent, size_t *index);
+
+// Removes pages_count pages from the start of the extent at index, the
+// extent is removed when no pages are left.
+void paging_extents_take(struct paging_extents *extents, size_t index,
+                         uint64_t pages_count);
+
+void paging_extents_remove(struct paging_extents *extents, size_t index);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_EXTENTS_H
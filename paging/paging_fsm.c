@@ -0,0 +1,183 @@
+#include "paging_fsm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct paging_fsm_page {
+  uint64_t page_number;
+  size_t free_size;
+};
+
+// Pages of a chain sorted by page number
+struct paging_fsm_chain {
+  uint64_t root_page_number;
+  size_t count;
+  size_t capacity;
+  struct paging_fsm_page *pages;
+};
+
+struct paging_fsm {
+  size_t free_size_min;
+  size_t chains_count;
+  size_t chains_capacity;
+  struct paging_fsm_chain *chains;
+};
+
+struct paging_fsm *paging_fsm_create(size_t free_size_min) {
+  struct paging_fsm *fsm = malloc(sizeof(struct paging_fsm));
+  if (fsm == NULL) {
+    return NULL;
+  }
+
+  fsm->free_size_min = free_size_min;
+  fsm->chains_count = 0;
+  fsm->chains_capacity = 0;
+  fsm->chains = NULL;
+  return fsm;
+}
+
+void paging_fsm_destroy(struct paging_fsm *fsm) {
+  if (fsm == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < fsm->chains_count; i++) {
+    free(fsm->chains[i].pages);
+  }
+  free(fsm->chains);
+  free(fsm);
+}
+
+static struct paging_fsm_chain *
+paging_fsm_chain_find(const struct paging_fsm *fsm,
+                      uint64_t root_page_number) {
+  for (size_t i = 0; i < fsm->chains_count; i++) {
+    if (fsm->chains[i].root_page_number == root_page_number) {
+      return &fsm->chains[i];
+    }
+  }
+  return NULL;
+}
+
+static struct paging_fsm_chain *
+paging_fsm_chain_add(struct paging_fsm *fsm, uint64_t root_page_number) {
+  if (fsm->chains_count == fsm->chains_capacity) {
+    const size_t capacity =
+        fsm->chains_capacity == 0 ? 8 : fsm->chains_capacity * 2;
+    struct paging_fsm_chain *chains =
+        realloc(fsm->chains, capacity * sizeof(struct paging_fsm_chain));
+    if (chains == NULL) {
+      return NULL;
+    }
+
+    fsm->chains = chains;
+    fsm->chains_capacity = capacity;
+  }
+
+  struct paging_fsm_chain *chain = &fsm->chains[fsm->chains_count++];
+  *chain = (struct paging_fsm_chain){.root_page_number = root_page_number,
+                                     .count = 0,
+                                     .capacity = 0,
+                                     .pages = NULL};
+  return chain;
+}
+
+// Index of the first page of the chain with a number not less than the given
+static size_t paging_fsm_lower_bound(const struct paging_fsm_chain *chain,
+                                     uint64_t page_number) {
+  size_t low = 0;
+  size_t high = chain->count;
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if (chain->pages[middle].page_number < page_number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+void paging_fsm_set(struct paging_fsm *fsm, uint64_t root_page_number,
+                    uint64_t page_number, size_t free_size) {
+  const bool is_tracked = free_size >= fsm->free_size_min;
+  struct paging_fsm_chain *chain =
+      paging_fsm_chain_find(fsm, root_page_number);
+  if (chain == NULL) {
+    if (!is_tracked) {
+      return;
+    }
+
+    chain = paging_fsm_chain_add(fsm, root_page_number);
+    if (chain == NULL) {
+      return;
+    }
+  }
+
+  const size_t index = paging_fsm_lower_bound(chain, page_number);
+  const bool is_found =
+      index < chain->count && chain->pages[index].page_number == page_number;
+  if (is_found && is_tracked) {
+    chain->pages[index].free_size = free_size;
+    return;
+  }
+
+  if (is_found) {
+    memmove(&chain->pages[index], &chain->pages[index + 1],
+            (chain->count - index - 1) * sizeof(struct paging_fsm_page));
+    chain->count -= 1;
+    return;
+  }
+
+  if (!is_tracked) {
+    return;
+  }
+
+  if (chain->count == chain->capacity) {
+    const size_t capacity = chain->capacity == 0 ? 16 : chain->capacity * 2;
+    struct paging_fsm_page *pages =
+        realloc(chain->pages, capacity * sizeof(struct paging_fsm_page));
+    if (pages == NULL) {
+      return;
+    }
+
+    chain->pages = pages;
+    chain->capacity = capacity;
+  }
+
+  memmove(&chain->pages[index + 1], &chain->pages[index],
+          (chain->count - index) * sizeof(struct paging_fsm_page));
+  chain->pages[index] = (struct paging_fsm_page){.page_number = page_number,
+                                                 .free_size = free_size};
+  chain->count += 1;
+}
+
+bool paging_fsm_find(const struct paging_fsm *fsm, uint64_t root_page_number,
+                     size_t size, uint64_t *page_number) {
+  const struct paging_fsm_chain *chain =
+      paging_fsm_chain_find(fsm, root_page_number);
+  if (chain == NULL) {
+    return false;
+  }
+
+  for (size_t i = 0; i < chain->count; i++) {
+    if (chain->pages[i].free_size >= size) {
+      *page_number = chain->pages[i].page_number;
+      return true;
+    }
+  }
+  return false;
+}
+
+void paging_fsm_forget_chain(struct paging_fsm *fsm,
+                             uint64_t root_page_number) {
+  struct paging_fsm_chain *chain =
+      paging_fsm_chain_find(fsm, root_page_number);
+  if (chain == NULL) {
+    return;
+  }
+
+  free(chain->pages);
+  *chain = fsm->chains[fsm->chains_count - 1];
+  fsm->chains_count -= 1;
+}
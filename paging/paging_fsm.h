@@ -0,0 +1,33 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_FSM_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_FSM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Free-space map: heap pages of every chain that have room for more records,
+// with the number of bytes a new record may take in each. Pages with less
+// free space than the minimum given at creation are not tracked.
+//
+// The map lives only in memory. It is filled by changes of the pages and by
+// scans, so pages are found again after the file is reopened.
+struct paging_fsm;
+
+struct paging_fsm *paging_fsm_create(size_t free_size_min);
+
+void paging_fsm_destroy(struct paging_fsm *fsm);
+
+// Records the free space of the page, a page without enough free space is
+// forgotten. The page is left untracked when memory runs out.
+void paging_fsm_set(struct paging_fsm *fsm, uint64_t root_page_number,
+                    uint64_t page_number, size_t free_size);
+
+// Finds the page of the chain with the lowest number that has at least size
+// bytes free, so that new records fill the front of the file first.
+bool paging_fsm_find(const struct paging_fsm *fsm, uint64_t root_page_number,
+                     size_t size, uint64_t *page_number);
+
+void paging_fsm_forget_chain(struct paging_fsm *fsm,
+                             uint64_t root_page_number);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_FSM_H
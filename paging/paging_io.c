@@ -0,0 +1,107 @@
+// preadv2, RWF_NOWAIT and FALLOC_FL_PUNCH_HOLE
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "paging_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool paging_io_read(int fd, void *data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    const ssize_t result = pread(fd, data, size, (off_t)offset);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+
+    data = (char *)data + result;
+    size -= (size_t)result;
+    offset += (uint64_t)result;
+  }
+  return true;
+}
+
+bool paging_io_write(int fd, const void *data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    const ssize_t result = pwrite(fd, data, size, (off_t)offset);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+
+    data = (const char *)data + result;
+    size -= (size_t)result;
+    offset += (uint64_t)result;
+  }
+  return true;
+}
+
+bool paging_io_read_cached(int fd, void *data, size_t size, uint64_t offset) {
+#ifdef RWF_NOWAIT
+  struct iovec vector = {.iov_base = data, .iov_len = size};
+  const ssize_t result = preadv2(fd, &vector, 1, (off_t)offset, RWF_NOWAIT);
+  return result == (ssize_t)size;
+#else
+  return false;
+#endif
+}
+
+void paging_io_prefetch(int fd, size_t size, uint64_t offset) {
+  posix_fadvise(fd, (off_t)offset, (off_t)size, POSIX_FADV_WILLNEED);
+}
+
+void paging_io_punch_hole(int fd, size_t size, uint64_t offset) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+  if (size > 0) {
+    fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)offset,
+              (off_t)size);
+  }
+#endif
+}
+
+static bool paging_io_transfer(int fd, struct iovec *vectors, int count,
+                               uint64_t offset, bool is_write) {
+  while (count > 0) {
+    const ssize_t result = is_write
+                               ? pwritev(fd, vectors, count, (off_t)offset)
+                               : preadv(fd, vectors, count, (off_t)offset);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+
+    offset += (uint64_t)result;
+
+    // Skip the vectors that are done and cut the partially done one
+    size_t done = (size_t)result;
+    while (count > 0 && done >= vectors->iov_len) {
+      done -= vectors->iov_len;
+      vectors++;
+      count--;
+    }
+    if (count > 0) {
+      vectors->iov_base = (char *)vectors->iov_base + done;
+      vectors->iov_len -= done;
+    }
+  }
+  return true;
+}
+
+bool paging_io_readv(int fd, struct iovec *vectors, int count,
+                     uint64_t offset) {
+  return paging_io_transfer(fd, vectors, count, offset, false);
+}
+
+bool paging_io_writev(int fd, struct iovec *vectors, int count,
+                      uint64_t offset) {
+  return paging_io_transfer(fd, vectors, count, offset, true);
+}
@@ -0,0 +1,35 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_IO_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Positioned I/O on a raw file descriptor. Interrupted and partial transfers
+// are continued, reaching the end of the file while reading is an error.
+
+bool paging_io_read(int fd, void *data, size_t size, uint64_t offset);
+
+bool paging_io_write(int fd, const void *data, size_t size, uint64_t offset);
+
+// Reads only if the bytes are in the page cache, so it never waits for the
+// disk. Fails when they are not or when the kernel cannot tell.
+bool paging_io_read_cached(int fd, void *data, size_t size, uint64_t offset);
+
+// Asks the kernel to start reading the bytes into the page cache
+void paging_io_prefetch(int fd, size_t size, uint64_t offset);
+
+// Gives the blocks of the range back to the file system without changing the
+// file size, they read as zeros then. Does nothing when the file system
+// cannot do that.
+void paging_io_punch_hole(int fd, size_t size, uint64_t offset);
+
+// The vectors are modified while the transfer progresses
+bool paging_io_readv(int fd, struct iovec *vectors, int count,
+                     uint64_t offset);
+
+bool paging_io_writev(int fd, struct iovec *vectors, int count,
+                      uint64_t offset);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_IO_H
@@ -0,0 +1,287 @@
+#include "paging_lz.h"
+#include "math_utils.h"
+#include "paging_io.h"
+
+#include <string.h>
+
+// "LAB3LZPG" in little endian
+#define PAGING_LZ_FRAME_MAGIC UINT64_C(0x47505A4C3342414C)
+
+#define PAGING_LZ_MATCH_MIN 4
+#define PAGING_LZ_OFFSET_MAX UINT16_MAX
+#define PAGING_LZ_HASH_BITS 12
+
+// Literal and match lengths of a sequence share its token byte, a length
+// that does not fit into its half continues in the following bytes
+#define PAGING_LZ_TOKEN_LENGTH_MAX 15
+
+// The compressed data is a list of sequences: a token, the literals copied
+// as they are and the offset back to the match. The last sequence has
+// literals only.
+struct paging_lz_frame_header {
+  uint64_t magic;
+  uint64_t compressed_size;
+  // Of the page, tells the frame from a page that starts like one
+  uint64_t checksum;
+};
+
+static uint64_t paging_lz_checksum(const void *data, size_t size) {
+  // FNV-1a
+  uint64_t hash = UINT64_C(0xCBF29CE484222325);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ ((const unsigned char *)data)[i]) * UINT64_C(0x100000001B3);
+  }
+  return hash;
+}
+
+static uint32_t paging_lz_hash(const unsigned char *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return (value * UINT32_C(2654435761)) >> (32 - PAGING_LZ_HASH_BITS);
+}
+
+static bool paging_lz_length_write(unsigned char **out,
+                                   const unsigned char *end, size_t length) {
+  for (; length >= UINT8_MAX; length -= UINT8_MAX) {
+    if (*out == end) {
+      return false;
+    }
+    *(*out)++ = UINT8_MAX;
+  }
+
+  if (*out == end) {
+    return false;
+  }
+  *(*out)++ = (unsigned char)length;
+  return true;
+}
+
+static bool paging_lz_length_read(const unsigned char **in,
+                                  const unsigned char *end, size_t *length) {
+  unsigned char byte;
+  do {
+    if (*in == end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == UINT8_MAX);
+  return true;
+}
+
+// Writes the literals and then the match unless match length is 0
+static bool paging_lz_sequence_write(unsigned char **out,
+                                     const unsigned char *end,
+                                     const unsigned char *literals,
+                                     size_t literals_size, size_t offset,
+                                     size_t match_length) {
+  if (*out == end) {
+    return false;
+  }
+
+  const size_t match_token_length =
+      match_length == 0 ? 0 : match_length - PAGING_LZ_MATCH_MIN;
+  unsigned char *token = (*out)++;
+  *token = (unsigned char)(MIN(literals_size, PAGING_LZ_TOKEN_LENGTH_MAX) << 4 |
+                           MIN(match_token_length, PAGING_LZ_TOKEN_LENGTH_MAX));
+
+  if (literals_size >= PAGING_LZ_TOKEN_LENGTH_MAX &&
+      !paging_lz_length_write(out, end,
+                              literals_size - PAGING_LZ_TOKEN_LENGTH_MAX)) {
+    return false;
+  }
+  if ((size_t)(end - *out) < literals_size) {
+    return false;
+  }
+  memcpy(*out, literals, literals_size);
+  *out += literals_size;
+
+  if (match_length == 0) {
+    return true;
+  }
+
+  if (end - *out < 2) {
+    return false;
+  }
+  *(*out)++ = (unsigned char)(offset & 0xFF);
+  *(*out)++ = (unsigned char)(offset >> 8);
+  return match_token_length < PAGING_LZ_TOKEN_LENGTH_MAX ||
+         paging_lz_length_write(out, end,
+                                match_token_length -
+                                    PAGING_LZ_TOKEN_LENGTH_MAX);
+}
+
+size_t paging_lz_compress(const void *data, size_t size, void *compressed,
+                          size_t capacity) {
+  const unsigned char *in = data;
+  unsigned char *out = compressed;
+  const unsigned char *out_end = out + capacity;
+
+  // Positions of the last four bytes seen with every hash, plus one so that
+  // zero means none
+  uint32_t table[1 << PAGING_LZ_HASH_BITS] = {0};
+
+  size_t literals_start = 0;
+  size_t position = 0;
+  while (position + PAGING_LZ_MATCH_MIN <= size) {
+    const uint32_t hash = paging_lz_hash(in + position);
+    const size_t candidate = table[hash];
+    table[hash] = (uint32_t)(position + 1);
+
+    if (candidate == 0 || position - (candidate - 1) > PAGING_LZ_OFFSET_MAX ||
+        memcmp(in + candidate - 1, in + position, PAGING_LZ_MATCH_MIN) != 0) {
+      position++;
+      continue;
+    }
+
+    const size_t match_start = candidate - 1;
+    size_t match_length = PAGING_LZ_MATCH_MIN;
+    while (position + match_length < size &&
+           in[match_start + match_length] == in[position + match_length]) {
+      match_length++;
+    }
+
+    if (!paging_lz_sequence_write(&out, out_end, in + literals_start,
+                                  position - literals_start,
+                                  position - match_start, match_length)) {
+      return 0;
+    }
+
+    position += match_length;
+    literals_start = position;
+  }
+
+  if (!paging_lz_sequence_write(&out, out_end, in + literals_start,
+                                size - literals_start, 0, 0)) {
+    return 0;
+  }
+  return (size_t)(out - (unsigned char *)compressed);
+}
+
+bool paging_lz_decompress(const void *compressed, size_t compressed_size,
+                          void *data, size_t size, size_t *decompressed_size) {
+  const unsigned char *in = compressed;
+  const unsigned char *in_end = in + compressed_size;
+  unsigned char *out = data;
+  size_t position = 0;
+
+  while (in < in_end && position < size) {
+    const unsigned char token = *in++;
+
+    size_t literals_size = token >> 4;
+    if (literals_size == PAGING_LZ_TOKEN_LENGTH_MAX &&
+        !paging_lz_length_read(&in, in_end, &literals_size)) {
+      return false;
+    }
+
+    // Literals past the end of the data may be cut off with the input
+    const size_t literals_copied = MIN(literals_size, size - position);
+    if ((size_t)(in_end - in) < literals_copied) {
+      return false;
+    }
+    memcpy(out + position, in, literals_copied);
+    position += literals_copied;
+    if (position == size) {
+      break;
+    }
+    in += literals_size;
+    if (in == in_end) {
+      break;
+    }
+
+    if (in_end - in < 2) {
+      return false;
+    }
+    const size_t offset = (size_t)in[0] | (size_t)in[1] << 8;
+    in += 2;
+    size_t match_length = token & PAGING_LZ_TOKEN_LENGTH_MAX;
+    if (match_length == PAGING_LZ_TOKEN_LENGTH_MAX &&
+        !paging_lz_length_read(&in, in_end, &match_length)) {
+      return false;
+    }
+    match_length += PAGING_LZ_MATCH_MIN;
+    if (offset == 0 || offset > position) {
+      return false;
+    }
+
+    // The match may overlap the bytes it produces
+    const size_t match_end = MIN(position + match_length, size);
+    for (; position < match_end; position++) {
+      out[position] = out[position - offset];
+    }
+  }
+
+  *decompressed_size = position;
+  return true;
+}
+
+size_t paging_lz_page_encode(const void *page, size_t page_size, void *frame) {
+  // Compression pays off only when the frame leaves a block free
+  const size_t header_size = sizeof(struct paging_lz_frame_header);
+  if (page_size < header_size + PAGING_LZ_BLOCK_SIZE) {
+    return 0;
+  }
+
+  const size_t compressed_size =
+      paging_lz_compress(page, page_size, (char *)frame + header_size,
+                         page_size - PAGING_LZ_BLOCK_SIZE - header_size);
+  if (compressed_size == 0) {
+    return 0;
+  }
+
+  const struct paging_lz_frame_header header = {
+      .magic = PAGING_LZ_FRAME_MAGIC,
+      .compressed_size = compressed_size,
+      .checksum = paging_lz_checksum(page, page_size)};
+  memcpy(frame, &header, header_size);
+  return header_size + compressed_size;
+}
+
+bool paging_lz_page_decode(const void *frame, void *page, size_t page_size) {
+  struct paging_lz_frame_header header;
+  memcpy(&header, frame, sizeof(header));
+  if (header.magic != PAGING_LZ_FRAME_MAGIC ||
+      header.compressed_size > page_size - sizeof(header)) {
+    return false;
+  }
+
+  size_t decompressed_size;
+  return paging_lz_decompress((const char *)frame + sizeof(header),
+                              header.compressed_size, page, page_size,
+                              &decompressed_size) &&
+         decompressed_size == page_size &&
+         paging_lz_checksum(page, page_size) == header.checksum;
+}
+
+bool paging_lz_page_decode_prefix(const void *block, void *data, size_t size) {
+  struct paging_lz_frame_header header;
+  memcpy(&header, block, sizeof(header));
+  if (header.magic != PAGING_LZ_FRAME_MAGIC) {
+    return false;
+  }
+
+  size_t decompressed_size;
+  return paging_lz_decompress(
+             (const char *)block + sizeof(header),
+             MIN(header.compressed_size, PAGING_LZ_BLOCK_SIZE - sizeof(header)),
+             data, size, &decompressed_size) &&
+         decompressed_size == size;
+}
+
+bool paging_lz_page_write(int fd, const void *page, size_t page_size,
+                          uint64_t offset, void *buffer) {
+  const size_t frame_size = paging_lz_page_encode(page, page_size, buffer);
+  if (frame_size == 0) {
+    return paging_io_write(fd, page, page_size, offset);
+  }
+
+  // Stale bytes after the frame are cleared up to the end of its last block
+  const size_t blocks_size = ROUND_UP(frame_size, PAGING_LZ_BLOCK_SIZE);
+  memset((char *)buffer + frame_size, 0, blocks_size - frame_size);
+  if (!paging_io_write(fd, buffer, blocks_size, offset)) {
+    return false;
+  }
+
+  paging_io_punch_hole(fd, page_size - blocks_size, offset + blocks_size);
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_LZ_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Page compression with a byte oriented LZ77 codec. A compressed page is
+// stored as a frame at the start of its place in the file and the blocks
+// after the frame are punched out of the file, so a page takes only the
+// blocks its frame needs. Pages that would not save a block are stored as
+// they are.
+
+// Granularity of the space given back to the file system
+#define PAGING_LZ_BLOCK_SIZE 4096
+
+// Returns the size of the compressed data, 0 when it does not fit into the
+// capacity
+size_t paging_lz_compress(const void *data, size_t size, void *compressed,
+                          size_t capacity);
+
+// Stops when the data is full, so a prefix of the data may be decompressed.
+// Fails on malformed input.
+bool paging_lz_decompress(const void *compressed, size_t compressed_size,
+                          void *data, size_t size, size_t *decompressed_size);
+
+// Returns the size of the frame of the page, 0 when the page should be
+// stored as it is. The frame holds up to page size bytes.
+size_t paging_lz_page_encode(const void *page, size_t page_size, void *frame);
+
+// Returns false when the bytes are not a frame of a page of this size, then
+// they are the page itself. At least page size bytes are read.
+bool paging_lz_page_decode(const void *frame, void *page, size_t page_size);
+
+// Same as decode, but only the first bytes of the page are decompressed and
+// they must come from the first block of the frame
+bool paging_lz_page_decode_prefix(const void *block, void *data, size_t size);
+
+// Writes the page at the offset as a frame when that saves blocks, then the
+// rest of its place is punched out of the file. The buffer holds a page.
+bool paging_lz_page_write(int fd, const void *page, size_t page_size,
+                          uint64_t offset, void *buffer);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_LZ_H
@@ -0,0 +1,164 @@
+#include "paging_mmap.h"
+#include "logger.h"
+#include "math_utils.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PAGING_MMAP_RESERVE_SIZE ((size_t)1 << 36)
+
+#define PAGING_MMAP_GROW_SIZE ((size_t)1 << 24)
+
+// Longest range checked by paging_mmap_is_resident, in system pages
+#define PAGING_MMAP_RESIDENCY_MAX 32
+
+struct paging_mmap {
+  int fd;
+  char *address;
+  size_t mapped_size;
+};
+
+struct paging_mmap *paging_mmap_create(FILE *file) {
+  if (file == NULL) {
+    return NULL;
+  }
+
+  struct paging_mmap *map = malloc(sizeof(struct paging_mmap));
+  if (map == NULL) {
+    return NULL;
+  }
+
+  // Reserve the whole address range once, so that growing the mapping never
+  // moves pages that were already handed out.
+  void *address = mmap(NULL, PAGING_MMAP_RESERVE_SIZE, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (address == MAP_FAILED) {
+    warn("Address range reservation error. Errno: %d", errno);
+    free(map);
+    return NULL;
+  }
+
+  fflush(file);
+  map->fd = fileno(file);
+  map->address = address;
+  map->mapped_size = 0;
+  return map;
+}
+
+void paging_mmap_destroy(struct paging_mmap *map, long size) {
+  if (map == NULL) {
+    return;
+  }
+
+  if (map->mapped_size > 0 &&
+      msync(map->address, map->mapped_size, MS_SYNC) != 0) {
+    warn("Mapping sync error. Errno: %d", errno);
+  }
+
+  munmap(map->address, PAGING_MMAP_RESERVE_SIZE);
+
+  if (ftruncate(map->fd, size) != 0) {
+    warn("File truncate error. Errno: %d", errno);
+  }
+
+  free(map);
+}
+
+static bool paging_mmap_grow(struct paging_mmap *map, size_t required_size) {
+  const size_t new_size = DIV_ROUND_UP(required_size, PAGING_MMAP_GROW_SIZE) *
+                          PAGING_MMAP_GROW_SIZE;
+  if (new_size > PAGING_MMAP_RESERVE_SIZE) {
+    warn("File does not fit into reserved address range");
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(map->fd, &file_stat) != 0) {
+    warn("File stat error. Errno: %d", errno);
+    return false;
+  }
+
+  if ((size_t)file_stat.st_size < new_size &&
+      ftruncate(map->fd, (off_t)new_size) != 0) {
+    warn("File extend error. Errno: %d", errno);
+    return false;
+  }
+
+  void *address =
+      mmap(map->address + map->mapped_size, new_size - map->mapped_size,
+           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, map->fd,
+           (off_t)map->mapped_size);
+  if (address == MAP_FAILED) {
+    warn("File map error. Errno: %d", errno);
+    return false;
+  }
+
+  map->mapped_size = new_size;
+  return true;
+}
+
+// Page aligned range of the mapping that covers the file bytes
+static bool paging_mmap_range(const struct paging_mmap *map, long position,
+                              size_t size, char **address, size_t *length) {
+  if (map == NULL || position < 0 ||
+      (size_t)position + size > map->mapped_size) {
+    return false;
+  }
+
+  const size_t system_page_size = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t start = (size_t)position / system_page_size * system_page_size;
+  *address = map->address + start;
+  *length = (size_t)position + size - start;
+  return true;
+}
+
+bool paging_mmap_is_resident(const struct paging_mmap *map, long position,
+                             size_t size) {
+  char *address;
+  size_t length;
+  if (!paging_mmap_range(map, position, size, &address, &length)) {
+    return false;
+  }
+
+  const size_t system_page_size = (size_t)sysconf(_SC_PAGESIZE);
+  unsigned char residency[PAGING_MMAP_RESIDENCY_MAX];
+  const size_t pages_count = DIV_ROUND_UP(length, system_page_size);
+  if (pages_count > PAGING_MMAP_RESIDENCY_MAX ||
+      mincore(address, length, residency) != 0) {
+    return false;
+  }
+
+  for (size_t i = 0; i < pages_count; i++) {
+    if ((residency[i] & 1) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void paging_mmap_prefetch(const struct paging_mmap *map, long position,
+                          size_t size) {
+  char *address;
+  size_t length;
+  if (paging_mmap_range(map, position, size, &address, &length)) {
+    madvise(address, length, MADV_WILLNEED);
+  }
+}
+
+void *paging_mmap_get(struct paging_mmap *map, long position, size_t size) {
+  if (map == NULL || position < 0) {
+    return NULL;
+  }
+
+  const size_t required_size = (size_t)position + size;
+  if (required_size > map->mapped_size &&
+      !paging_mmap_grow(map, required_size)) {
+    return NULL;
+  }
+
+  return map->address + position;
+}
@@ -0,0 +1,30 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_MMAP_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_MMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct paging_mmap;
+
+struct paging_mmap *paging_mmap_create(FILE *file);
+
+// Unmaps the file and truncates it back to size, dropping the preallocated
+// tail that was added while growing the mapping.
+void paging_mmap_destroy(struct paging_mmap *map, long size);
+
+// Returns the address of the file bytes [position, position + size). The
+// file and the mapping are grown when needed. Returned addresses stay valid
+// until the mapping is destroyed.
+void *paging_mmap_get(struct paging_mmap *map, long position, size_t size);
+
+// Reports whether the file bytes are mapped and in memory, so that reading
+// them does not wait for the disk.
+bool paging_mmap_is_resident(const struct paging_mmap *map, long position,
+                             size_t size);
+
+// Asks the kernel to start reading mapped file bytes in the background
+void paging_mmap_prefetch(const struct paging_mmap *map, long position,
+                          size_t size);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_MMAP_H
@@ -0,0 +1,318 @@
+#include "paging_uring.h"
+#include "logger.h"
+#include "paging_io.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PAGING_URING_IS_SUPPORTED
+#endif
+#endif
+
+#ifdef PAGING_URING_IS_SUPPORTED
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct paging_uring_request {
+  bool is_used;
+  bool is_write;
+  int vectors_count;
+  size_t size;
+  uint64_t offset;
+  // The kernel reads the vectors while the request is in flight
+  struct iovec vectors[PAGING_URING_VECTORS_MAX];
+};
+
+struct paging_uring {
+  int ring_fd;
+  int fd;
+  unsigned entries;
+  unsigned in_flight_count;
+  bool is_failed;
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  struct paging_uring_request *requests;
+};
+
+static int paging_uring_enter(const struct paging_uring *ring,
+                              unsigned submit_count, unsigned complete_count) {
+  const unsigned flags = complete_count > 0 ? IORING_ENTER_GETEVENTS : 0;
+  while (true) {
+    const long result = syscall(__NR_io_uring_enter, ring->ring_fd,
+                                submit_count, complete_count, flags, NULL, 0);
+    if (result >= 0 || errno != EINTR) {
+      return (int)result;
+    }
+  }
+}
+
+static void paging_uring_unmap(struct paging_uring *ring) {
+  if (ring->sqes != NULL) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sq_ring != NULL) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+}
+
+static bool paging_uring_map(struct paging_uring *ring,
+                             const struct io_uring_params *params) {
+  ring->sq_ring_size =
+      params->sq_off.array + params->sq_entries * sizeof(unsigned);
+  ring->cq_ring_size =
+      params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+
+  // Both rings live in one mapping on kernels that support it
+  const bool is_single_mmap = (params->features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (is_single_mmap && ring->cq_ring_size > ring->sq_ring_size) {
+    ring->sq_ring_size = ring->cq_ring_size;
+  }
+
+  void *sq_ring =
+      mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return false;
+  }
+  ring->sq_ring = sq_ring;
+
+  if (is_single_mmap) {
+    ring->cq_ring = sq_ring;
+  } else {
+    void *cq_ring =
+        mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return false;
+    }
+    ring->cq_ring = cq_ring;
+  }
+
+  void *sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  ring->sqes = sqes;
+
+  char *sq = ring->sq_ring;
+  char *cq = ring->cq_ring;
+  ring->sq_tail = (unsigned *)(sq + params->sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + params->sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + params->sq_off.array);
+  ring->cq_head = (unsigned *)(cq + params->cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + params->cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + params->cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+  return true;
+}
+
+struct paging_uring *paging_uring_create(int fd, unsigned entries) {
+  struct paging_uring *ring = calloc(1, sizeof(struct paging_uring));
+  if (ring == NULL) {
+    return NULL;
+  }
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const long ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd < 0) {
+    free(ring);
+    return NULL;
+  }
+
+  ring->ring_fd = (int)ring_fd;
+  ring->fd = fd;
+  ring->entries = params.sq_entries;
+  ring->requests =
+      calloc(params.sq_entries, sizeof(struct paging_uring_request));
+  if (ring->requests == NULL || !paging_uring_map(ring, &params)) {
+    paging_uring_unmap(ring);
+    close(ring->ring_fd);
+    free(ring->requests);
+    free(ring);
+    return NULL;
+  }
+
+  return ring;
+}
+
+void paging_uring_destroy(struct paging_uring *ring) {
+  if (ring == NULL) {
+    return;
+  }
+
+  if (!paging_uring_wait(ring)) {
+    warn("Asynchronous I/O error");
+  }
+
+  paging_uring_unmap(ring);
+  close(ring->ring_fd);
+  free(ring->requests);
+  free(ring);
+}
+
+static void paging_uring_complete(struct paging_uring *ring,
+                                  const struct io_uring_cqe *cqe) {
+  struct paging_uring_request *request = &ring->requests[cqe->user_data];
+  if (cqe->res < 0) {
+    warn("Asynchronous I/O error. Errno: %d", -cqe->res);
+    ring->is_failed = true;
+  } else if ((size_t)cqe->res < request->size) {
+    // Finish a short transfer synchronously
+    struct iovec *vectors = request->vectors;
+    int count = request->vectors_count;
+    size_t done = (size_t)cqe->res;
+    while (done >= vectors->iov_len) {
+      done -= vectors->iov_len;
+      vectors++;
+      count--;
+    }
+    vectors->iov_base = (char *)vectors->iov_base + done;
+    vectors->iov_len -= done;
+
+    const uint64_t offset = request->offset + (uint64_t)cqe->res;
+    const bool success =
+        request->is_write ? paging_io_writev(ring->fd, vectors, count, offset)
+                          : paging_io_readv(ring->fd, vectors, count, offset);
+    ring->is_failed = ring->is_failed || !success;
+  }
+
+  request->is_used = false;
+  ring->in_flight_count -= 1;
+}
+
+// Completes finished requests, waiting for at least complete_count of them
+static bool paging_uring_reap(struct paging_uring *ring,
+                              unsigned complete_count) {
+  if (complete_count > 0 && paging_uring_enter(ring, 0, complete_count) < 0) {
+    warn("Asynchronous I/O wait error. Errno: %d", errno);
+    return false;
+  }
+
+  unsigned head = *ring->cq_head;
+  const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    paging_uring_complete(ring, &ring->cqes[head & *ring->cq_mask]);
+    head += 1;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  return true;
+}
+
+static bool paging_uring_submit(struct paging_uring *ring, bool is_write,
+                                const struct iovec *vectors, int count,
+                                uint64_t offset) {
+  if (ring == NULL || count <= 0 || count > PAGING_URING_VECTORS_MAX) {
+    return false;
+  }
+
+  while (ring->in_flight_count == ring->entries) {
+    if (!paging_uring_reap(ring, 1)) {
+      return false;
+    }
+  }
+
+  unsigned index = 0;
+  while (ring->requests[index].is_used) {
+    index += 1;
+  }
+
+  struct paging_uring_request *request = &ring->requests[index];
+  request->is_write = is_write;
+  request->vectors_count = count;
+  request->offset = offset;
+  request->size = 0;
+  for (int i = 0; i < count; i++) {
+    request->vectors[i] = vectors[i];
+    request->size += vectors[i].iov_len;
+  }
+
+  const unsigned tail = *ring->sq_tail;
+  const unsigned sqe_index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[sqe_index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = ring->fd;
+  sqe->addr = (uint64_t)(uintptr_t)request->vectors;
+  sqe->len = (unsigned)count;
+  sqe->off = offset;
+  sqe->user_data = index;
+  ring->sq_array[sqe_index] = sqe_index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  if (paging_uring_enter(ring, 1, 0) != 1) {
+    warn("Asynchronous I/O submit error. Errno: %d", errno);
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    return false;
+  }
+
+  request->is_used = true;
+  ring->in_flight_count += 1;
+  return true;
+}
+
+bool paging_uring_wait(struct paging_uring *ring) {
+  if (ring == NULL) {
+    return false;
+  }
+
+  bool success = true;
+  while (success && ring->in_flight_count > 0) {
+    success = paging_uring_reap(ring, 1);
+  }
+
+  success = success && !ring->is_failed;
+  ring->is_failed = false;
+  return success;
+}
+
+#else
+
+struct paging_uring *paging_uring_create(int fd, unsigned entries) {
+  return NULL;
+}
+
+void paging_uring_destroy(struct paging_uring *ring) {}
+
+static bool paging_uring_submit(struct paging_uring *ring, bool is_write,
+                                const struct iovec *vectors, int count,
+                                uint64_t offset) {
+  return false;
+}
+
+bool paging_uring_wait(struct paging_uring *ring) { return false; }
+
+#endif
+
+bool paging_uring_readv(struct paging_uring *ring, const struct iovec *vectors,
+                        int count, uint64_t offset) {
+  return paging_uring_submit(ring, false, vectors, count, offset);
+}
+
+bool paging_uring_writev(struct paging_uring *ring,
+                         const struct iovec *vectors, int count,
+                         uint64_t offset) {
+  return paging_uring_submit(ring, true, vectors, count, offset);
+}
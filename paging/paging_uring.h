@@ -0,0 +1,35 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_URING_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_URING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Asynchronous positioned I/O on one file through io_uring. Requests are
+// submitted as soon as they are queued and are completed by wait, so several
+// requests are in flight at once.
+struct paging_uring;
+
+// The longest vector list of one request
+#define PAGING_URING_VECTORS_MAX 64
+
+// Returns NULL when io_uring is not supported by the kernel or the build
+struct paging_uring *paging_uring_create(int fd, unsigned entries);
+
+// Waits for the requests in flight
+void paging_uring_destroy(struct paging_uring *ring);
+
+// The vectors are copied, but the memory they point to must stay untouched
+// until the request is completed by wait
+bool paging_uring_readv(struct paging_uring *ring, const struct iovec *vectors,
+                        int count, uint64_t offset);
+
+bool paging_uring_writev(struct paging_uring *ring,
+                         const struct iovec *vectors, int count,
+                         uint64_t offset);
+
+// Waits until every queued request is completed. Fails if any of them
+// failed since the previous wait.
+bool paging_uring_wait(struct paging_uring *ring);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_URING_H
@@ -0,0 +1,600 @@
+#include "paging_wal.h"
+#include "logger.h"
+#include "math_utils.h"
+#include "paging_io.h"
+#include "paging_lz.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PAGING_WAL_NO_OFFSET UINT64_MAX
+
+enum paging_wal_record_type {
+  PAGING_WAL_RECORD_PAGE = 1,
+  PAGING_WAL_RECORD_COMMIT = 2,
+};
+
+struct paging_wal_record_header {
+  uint64_t type;
+  uint64_t page_number;
+  uint64_t size;
+  // Covers the fields above and the record data, so that a torn record at
+  // the end of the log is detected
+  uint64_t checksum;
+};
+
+struct paging_wal_index_entry {
+  uint64_t page_number;
+  uint64_t offset;
+  uint64_t size;
+  // The record is already copied to the database file
+  bool is_copied;
+};
+
+struct paging_wal {
+  int fd;
+  size_t page_size;
+  // Pages are compressed when they are copied to the database file
+  bool is_compressed;
+  pthread_mutex_t mutex;
+  // Held by checkpoints for their whole run, the mutex above is released
+  // while incremental checkpoints copy pages
+  pthread_mutex_t checkpoint_mutex;
+  pthread_cond_t sync_done;
+  bool is_syncing;
+  uint64_t size;
+  uint64_t synced_size;
+  // The end of the last commit record, there is nothing to commit while the
+  // log ends there
+  uint64_t committed_size;
+  // Offset of the latest record of every page in the log
+  size_t entries_count;
+  size_t entries_capacity;
+  struct paging_wal_index_entry *entries;
+};
+
+static uint64_t paging_wal_checksum(struct paging_wal_record_header header,
+                                    const void *data) {
+  const uint64_t fields[] = {header.type, header.page_number, header.size};
+
+  // FNV-1a
+  uint64_t hash = UINT64_C(0xCBF29CE484222325);
+  for (size_t i = 0; i < sizeof(fields); i++) {
+    hash = (hash ^ ((const unsigned char *)fields)[i]) *
+           UINT64_C(0x100000001B3);
+  }
+  for (size_t i = 0; i < header.size; i++) {
+    hash = (hash ^ ((const unsigned char *)data)[i]) * UINT64_C(0x100000001B3);
+  }
+  return hash;
+}
+
+static size_t paging_wal_index_slot(const struct paging_wal *wal,
+                                    uint64_t page_number) {
+  const uint64_t hash = page_number * UINT64_C(0x9E3779B97F4A7C15);
+  size_t slot = (size_t)(hash >> 32) & (wal->entries_capacity - 1);
+  while (wal->entries[slot].offset != PAGING_WAL_NO_OFFSET &&
+         wal->entries[slot].page_number != page_number) {
+    slot = (slot + 1) & (wal->entries_capacity - 1);
+  }
+  return slot;
+}
+
+static void paging_wal_index_clear(struct paging_wal *wal) {
+  for (size_t i = 0; i < wal->entries_capacity; i++) {
+    wal->entries[i].offset = PAGING_WAL_NO_OFFSET;
+  }
+  wal->entries_count = 0;
+}
+
+static bool paging_wal_index_put(struct paging_wal *wal,
+                                 struct paging_wal_index_entry entry) {
+  if ((wal->entries_count + 1) * 2 > wal->entries_capacity) {
+    struct paging_wal_index_entry *old_entries = wal->entries;
+    const size_t old_capacity = wal->entries_capacity;
+
+    const size_t capacity = old_capacity * 2;
+    struct paging_wal_index_entry *entries =
+        malloc(capacity * sizeof(struct paging_wal_index_entry));
+    if (entries == NULL) {
+      return false;
+    }
+
+    wal->entries = entries;
+    wal->entries_capacity = capacity;
+    paging_wal_index_clear(wal);
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (old_entries[i].offset != PAGING_WAL_NO_OFFSET) {
+        wal->entries[paging_wal_index_slot(wal, old_entries[i].page_number)] =
+            old_entries[i];
+        wal->entries_count += 1;
+      }
+    }
+    free(old_entries);
+  }
+
+  const size_t slot = paging_wal_index_slot(wal, entry.page_number);
+  if (wal->entries[slot].offset == PAGING_WAL_NO_OFFSET) {
+    wal->entries_count += 1;
+  }
+  wal->entries[slot] = entry;
+  wal->entries[slot].is_copied = false;
+  return true;
+}
+
+static bool paging_wal_truncate(struct paging_wal *wal, uint64_t size) {
+  if (ftruncate(wal->fd, (off_t)size) != 0 || fsync(wal->fd) != 0) {
+    warn("Log truncate error. Errno: %d", errno);
+    return false;
+  }
+
+  wal->size = size;
+  wal->synced_size = size;
+  wal->committed_size = size;
+  return true;
+}
+
+static bool paging_wal_recover(struct paging_wal *wal) {
+  void *data = malloc(wal->page_size);
+  struct paging_wal_index_entry *pending =
+      malloc(sizeof(struct paging_wal_index_entry));
+  size_t pending_count = 0;
+  size_t pending_capacity = 1;
+  if (data == NULL || pending == NULL) {
+    free(data);
+    free(pending);
+    return false;
+  }
+
+  uint64_t offset = 0;
+  uint64_t committed_size = 0;
+  size_t commits_count = 0;
+  while (true) {
+    struct paging_wal_record_header header;
+    if (!paging_io_read(wal->fd, &header, sizeof(header), offset)) {
+      break;
+    }
+    if ((header.type != PAGING_WAL_RECORD_PAGE &&
+         header.type != PAGING_WAL_RECORD_COMMIT) ||
+        header.size > wal->page_size) {
+      break;
+    }
+    if (header.size > 0 && !paging_io_read(wal->fd, data, header.size,
+                                           offset + sizeof(header))) {
+      break;
+    }
+    if (paging_wal_checksum(header, data) != header.checksum) {
+      break;
+    }
+
+    if (header.type == PAGING_WAL_RECORD_PAGE) {
+      if (pending_count == pending_capacity) {
+        pending_capacity *= 2;
+        struct paging_wal_index_entry *new_pending = realloc(
+            pending, pending_capacity * sizeof(struct paging_wal_index_entry));
+        if (new_pending == NULL) {
+          free(data);
+          free(pending);
+          return false;
+        }
+        pending = new_pending;
+      }
+      pending[pending_count++] =
+          (struct paging_wal_index_entry){.page_number = header.page_number,
+                                          .offset = offset,
+                                          .size = header.size};
+    }
+
+    offset += sizeof(header) + header.size;
+
+    if (header.type == PAGING_WAL_RECORD_COMMIT) {
+      for (size_t i = 0; i < pending_count; i++) {
+        if (!paging_wal_index_put(wal, pending[i])) {
+          free(data);
+          free(pending);
+          return false;
+        }
+      }
+      pending_count = 0;
+      committed_size = offset;
+      commits_count += 1;
+    }
+  }
+
+  free(data);
+  free(pending);
+
+  if (commits_count > 0) {
+    info("Recovered %zu commits from log", commits_count);
+  }
+  return paging_wal_truncate(wal, committed_size);
+}
+
+struct paging_wal *paging_wal_create(FILE *file, size_t page_size,
+                                     bool is_compressed) {
+  if (file == NULL) {
+    return NULL;
+  }
+
+  struct paging_wal *wal = malloc(sizeof(struct paging_wal));
+  if (wal == NULL) {
+    return NULL;
+  }
+
+  // Reads and writes go to the descriptor, nothing may stay in the stream
+  fflush(file);
+  wal->fd = fileno(file);
+  wal->page_size = page_size;
+  wal->is_compressed = is_compressed;
+  wal->is_syncing = false;
+  wal->size = 0;
+  wal->synced_size = 0;
+  wal->committed_size = 0;
+  wal->entries_capacity = 64;
+  wal->entries =
+      malloc(wal->entries_capacity * sizeof(struct paging_wal_index_entry));
+  if (wal->entries == NULL) {
+    free(wal);
+    return NULL;
+  }
+  paging_wal_index_clear(wal);
+
+  if (!paging_wal_recover(wal)) {
+    warn("Log recovery error");
+    free(wal->entries);
+    free(wal);
+    return NULL;
+  }
+
+  pthread_mutex_init(&wal->mutex, NULL);
+  pthread_mutex_init(&wal->checkpoint_mutex, NULL);
+  pthread_cond_init(&wal->sync_done, NULL);
+  return wal;
+}
+
+void paging_wal_destroy(struct paging_wal *wal) {
+  if (wal == NULL) {
+    return;
+  }
+
+  pthread_mutex_destroy(&wal->mutex);
+  pthread_mutex_destroy(&wal->checkpoint_mutex);
+  pthread_cond_destroy(&wal->sync_done);
+  free(wal->entries);
+  free(wal);
+}
+
+static struct paging_wal_record_header
+paging_wal_record_make(enum paging_wal_record_type type, uint64_t page_number,
+                       const void *data, size_t size) {
+  struct paging_wal_record_header header = {
+      .type = type, .page_number = page_number, .size = size};
+  header.checksum = paging_wal_checksum(header, data);
+  return header;
+}
+
+bool paging_wal_append(struct paging_wal *wal, uint64_t page_number,
+                       const void *data, size_t size) {
+  return paging_wal_append_pages(wal, page_number, &data, 1, size);
+}
+
+bool paging_wal_append_pages(struct paging_wal *wal,
+                             uint64_t first_page_number,
+                             const void *const *pages, size_t count,
+                             size_t size) {
+  if (wal == NULL || size > wal->page_size ||
+      count > PAGING_WAL_APPEND_PAGES_MAX) {
+    return false;
+  }
+
+  // Checksums are computed before taking the lock
+  struct paging_wal_record_header headers[PAGING_WAL_APPEND_PAGES_MAX];
+  struct iovec vectors[PAGING_WAL_APPEND_PAGES_MAX * 2];
+  for (size_t i = 0; i < count; i++) {
+    headers[i] = paging_wal_record_make(PAGING_WAL_RECORD_PAGE,
+                                        first_page_number + i, pages[i], size);
+    vectors[i * 2] = (struct iovec){.iov_base = &headers[i],
+                                    .iov_len = sizeof(headers[i])};
+    vectors[i * 2 + 1] =
+        (struct iovec){.iov_base = (void *)pages[i], .iov_len = size};
+  }
+
+  pthread_mutex_lock(&wal->mutex);
+  const uint64_t offset = wal->size;
+  bool success =
+      paging_io_writev(wal->fd, vectors, (int)(count * 2), wal->size);
+  if (success) {
+    wal->size += count * (sizeof(struct paging_wal_record_header) + size);
+  } else {
+    warn("Log write error. Errno: %d", errno);
+  }
+
+  for (size_t i = 0; success && i < count; i++) {
+    const struct paging_wal_index_entry entry = {
+        .page_number = first_page_number + i,
+        .offset = offset + i * (sizeof(struct paging_wal_record_header) + size),
+        .size = size};
+    success = paging_wal_index_put(wal, entry);
+  }
+  pthread_mutex_unlock(&wal->mutex);
+  return success;
+}
+
+// Reads the data of the record, the part of the buffer past the record data
+// is zero filled
+static bool paging_wal_record_read(struct paging_wal *wal,
+                                   struct paging_wal_index_entry entry,
+                                   void *data, size_t size) {
+  const size_t read_size = MIN(size, entry.size);
+  if (read_size > 0 &&
+      !paging_io_read(wal->fd, data, read_size,
+                      entry.offset + sizeof(struct paging_wal_record_header))) {
+    return false;
+  }
+
+  memset((char *)data + read_size, 0, size - read_size);
+  return true;
+}
+
+struct paging_wal_read_result paging_wal_read(struct paging_wal *wal,
+                                              uint64_t page_number,
+                                              void *data, size_t size) {
+  if (wal == NULL) {
+    return (struct paging_wal_read_result){.success = false};
+  }
+
+  pthread_mutex_lock(&wal->mutex);
+  const struct paging_wal_index_entry entry =
+      wal->entries[paging_wal_index_slot(wal, page_number)];
+  if (entry.offset == PAGING_WAL_NO_OFFSET) {
+    pthread_mutex_unlock(&wal->mutex);
+    return (struct paging_wal_read_result){.success = true,
+                                           .is_found = false};
+  }
+
+  const bool success = paging_wal_record_read(wal, entry, data, size);
+  pthread_mutex_unlock(&wal->mutex);
+  if (!success) {
+    warn("Log read of page %" PRIu64 " error", page_number);
+  }
+
+  return (struct paging_wal_read_result){.success = success,
+                                         .is_found = true};
+}
+
+bool paging_wal_contains(struct paging_wal *wal, uint64_t page_number) {
+  pthread_mutex_lock(&wal->mutex);
+  const bool is_found =
+      wal->entries[paging_wal_index_slot(wal, page_number)].offset !=
+      PAGING_WAL_NO_OFFSET;
+  pthread_mutex_unlock(&wal->mutex);
+  return is_found;
+}
+
+bool paging_wal_commit(struct paging_wal *wal) {
+  if (wal == NULL) {
+    return false;
+  }
+
+  pthread_mutex_lock(&wal->mutex);
+  // Without records since the last commit record there is nothing to write,
+  // but that record may still be waiting for its sync
+  if (wal->size != wal->committed_size) {
+    const struct paging_wal_record_header header =
+        paging_wal_record_make(PAGING_WAL_RECORD_COMMIT, 0, NULL, 0);
+    if (!paging_io_write(wal->fd, &header, sizeof(header), wal->size)) {
+      warn("Log write error. Errno: %d", errno);
+      pthread_mutex_unlock(&wal->mutex);
+      return false;
+    }
+    wal->size += sizeof(header);
+    wal->committed_size = wal->size;
+  }
+
+  // The first committer becomes the leader and syncs everything written so
+  // far, the others wait for a sync that covers their commit record.
+  const uint64_t commit_size = wal->size;
+  bool success = true;
+  while (success && wal->synced_size < commit_size) {
+    if (wal->is_syncing) {
+      pthread_cond_wait(&wal->sync_done, &wal->mutex);
+      continue;
+    }
+
+    wal->is_syncing = true;
+    const uint64_t sync_size = wal->size;
+    pthread_mutex_unlock(&wal->mutex);
+
+    success = fsync(wal->fd) == 0;
+    if (!success) {
+      warn("Log sync error. Errno: %d", errno);
+    }
+
+    pthread_mutex_lock(&wal->mutex);
+    wal->is_syncing = false;
+    if (success) {
+      wal->synced_size = MAX(wal->synced_size, sync_size);
+    }
+    pthread_cond_broadcast(&wal->sync_done);
+  }
+  pthread_mutex_unlock(&wal->mutex);
+
+  return success;
+}
+
+uint64_t paging_wal_size(struct paging_wal *wal) {
+  pthread_mutex_lock(&wal->mutex);
+  const uint64_t size = wal->size;
+  pthread_mutex_unlock(&wal->mutex);
+  return size;
+}
+
+// Records of whole pages are compressed when the database file is, the
+// buffer holds a page then
+static bool paging_wal_record_copy(const struct paging_wal *wal,
+                                   int database_fd,
+                                   struct paging_wal_index_entry entry,
+                                   const void *data, void *buffer) {
+  const uint64_t offset = entry.page_number * wal->page_size;
+  if (wal->is_compressed && entry.size == wal->page_size) {
+    return paging_lz_page_write(database_fd, data, wal->page_size, offset,
+                                buffer);
+  }
+
+  return paging_io_write(database_fd, data, entry.size, offset);
+}
+
+bool paging_wal_checkpoint(struct paging_wal *wal, FILE *database_file) {
+  if (wal == NULL || database_file == NULL) {
+    return false;
+  }
+
+  void *data = malloc(2 * wal->page_size);
+  if (data == NULL) {
+    return false;
+  }
+
+  fflush(database_file);
+  const int database_fd = fileno(database_file);
+
+  pthread_mutex_lock(&wal->checkpoint_mutex);
+  pthread_mutex_lock(&wal->mutex);
+  bool success = true;
+  for (size_t i = 0; success && i < wal->entries_capacity; i++) {
+    const struct paging_wal_index_entry entry = wal->entries[i];
+    if (entry.offset == PAGING_WAL_NO_OFFSET) {
+      continue;
+    }
+
+    success = paging_wal_record_read(wal, entry, data, entry.size) &&
+              paging_wal_record_copy(wal, database_fd, entry, data,
+                                     (char *)data + wal->page_size);
+  }
+
+  success = success && fsync(database_fd) == 0;
+  if (success) {
+    paging_wal_index_clear(wal);
+    success = paging_wal_truncate(wal, 0);
+  } else {
+    warn("Checkpoint error. Errno: %d", errno);
+  }
+  pthread_mutex_unlock(&wal->mutex);
+  pthread_mutex_unlock(&wal->checkpoint_mutex);
+
+  free(data);
+  return success;
+}
+
+static int paging_wal_index_entry_compare(const void *left,
+                                          const void *right) {
+  const uint64_t left_page_number =
+      ((const struct paging_wal_index_entry *)left)->page_number;
+  const uint64_t right_page_number =
+      ((const struct paging_wal_index_entry *)right)->page_number;
+  return (left_page_number > right_page_number) -
+         (left_page_number < right_page_number);
+}
+
+// Copies the records in one write when they are whole pages with consecutive
+// numbers, the buffer holds a page for every record and one more
+static bool paging_wal_records_copy(struct paging_wal *wal, int database_fd,
+                                    const struct paging_wal_index_entry *run,
+                                    size_t count, void *buffer) {
+  if (count == 1) {
+    return paging_wal_record_read(wal, run[0], buffer, run[0].size) &&
+           paging_wal_record_copy(wal, database_fd, run[0], buffer,
+                                  (char *)buffer + wal->page_size);
+  }
+
+  struct iovec vectors[PAGING_WAL_APPEND_PAGES_MAX];
+  for (size_t i = 0; i < count; i++) {
+    void *data = (char *)buffer + i * wal->page_size;
+    if (!paging_wal_record_read(wal, run[i], data, run[i].size)) {
+      return false;
+    }
+    vectors[i] = (struct iovec){.iov_base = data, .iov_len = run[i].size};
+  }
+
+  return paging_io_writev(database_fd, vectors, (int)count,
+                          run[0].page_number * wal->page_size);
+}
+
+bool paging_wal_checkpoint_incremental(struct paging_wal *wal,
+                                       int database_fd) {
+  if (wal == NULL) {
+    return false;
+  }
+
+  pthread_mutex_lock(&wal->checkpoint_mutex);
+
+  // Records after the last commit record must not reach the database file,
+  // pages whose latest record is one of them wait for the next checkpoint
+  pthread_mutex_lock(&wal->mutex);
+  struct paging_wal_index_entry *entries =
+      malloc(MAX(wal->entries_count, 1) * sizeof(*entries));
+  size_t entries_count = 0;
+  for (size_t i = 0; entries != NULL && i < wal->entries_capacity; i++) {
+    const struct paging_wal_index_entry entry = wal->entries[i];
+    if (entry.offset != PAGING_WAL_NO_OFFSET && !entry.is_copied &&
+        entry.offset < wal->committed_size) {
+      entries[entries_count++] = entry;
+    }
+  }
+  pthread_mutex_unlock(&wal->mutex);
+
+  void *buffer = malloc((PAGING_WAL_APPEND_PAGES_MAX + 1) * wal->page_size);
+  bool success = entries != NULL && buffer != NULL;
+  if (success) {
+    qsort(entries, entries_count, sizeof(*entries),
+          paging_wal_index_entry_compare);
+  }
+
+  // Records are only appended while the lock is released, so the copied
+  // ones stay in place. Compressed pages are written one by one.
+  size_t run_start = 0;
+  for (size_t i = 1; success && i <= entries_count; i++) {
+    const bool is_run_continued =
+        i < entries_count && !wal->is_compressed &&
+        i - run_start < PAGING_WAL_APPEND_PAGES_MAX &&
+        entries[i].page_number == entries[i - 1].page_number + 1 &&
+        entries[i - 1].size == wal->page_size;
+    if (!is_run_continued) {
+      success = paging_wal_records_copy(wal, database_fd, &entries[run_start],
+                                        i - run_start, buffer);
+      run_start = i;
+    }
+  }
+  success = success && (entries_count == 0 || fsync(database_fd) == 0);
+  free(buffer);
+
+  pthread_mutex_lock(&wal->mutex);
+  for (size_t i = 0; success && i < entries_count; i++) {
+    struct paging_wal_index_entry *entry =
+        &wal->entries[paging_wal_index_slot(wal, entries[i].page_number)];
+    entry->is_copied = entry->offset == entries[i].offset;
+  }
+
+  // The log is emptied once every record is copied and no commit is in
+  // progress
+  bool is_copied = success && wal->size == wal->committed_size &&
+                   wal->synced_size == wal->size && !wal->is_syncing;
+  for (size_t i = 0; is_copied && i < wal->entries_capacity; i++) {
+    is_copied = wal->entries[i].offset == PAGING_WAL_NO_OFFSET ||
+                wal->entries[i].is_copied;
+  }
+  if (is_copied && wal->size > 0) {
+    paging_wal_index_clear(wal);
+    success = paging_wal_truncate(wal, 0);
+  } else if (!success) {
+    warn("Incremental checkpoint error. Errno: %d", errno);
+  }
+  pthread_mutex_unlock(&wal->mutex);
+  pthread_mutex_unlock(&wal->checkpoint_mutex);
+
+  free(entries);
+  return success;
+}
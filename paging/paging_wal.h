@@ -0,0 +1,67 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_WAL_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_WAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Write-ahead log of page images. Pages are appended to the log instead of
+// being written to the database file, and are copied to the database file
+// only by a checkpoint. Records after the last commit record are ignored by
+// recovery.
+struct paging_wal;
+
+// The longest run of pages appended with one write
+#define PAGING_WAL_APPEND_PAGES_MAX 64
+
+struct paging_wal_read_result {
+  bool success;
+  bool is_found;
+};
+
+// Recovers the log: committed records are kept and the tail after the last
+// commit record is dropped. Checkpoints compress the pages they copy when
+// the database file is compressed.
+struct paging_wal *paging_wal_create(FILE *file, size_t page_size,
+                                     bool is_compressed);
+
+void paging_wal_destroy(struct paging_wal *wal);
+
+// Appends an image of the start of the page. The image is returned by reads
+// of the page from now on, but becomes durable only with the next commit.
+bool paging_wal_append(struct paging_wal *wal, uint64_t page_number,
+                       const void *data, size_t size);
+
+// Appends images of a run of pages with consecutive numbers in one write.
+// Every image is the start of its page of the given size.
+bool paging_wal_append_pages(struct paging_wal *wal,
+                             uint64_t first_page_number,
+                             const void *const *pages, size_t count,
+                             size_t size);
+
+// Reads the latest image of the page if the log has one.
+struct paging_wal_read_result paging_wal_read(struct paging_wal *wal,
+                                              uint64_t page_number,
+                                              void *data, size_t size);
+
+bool paging_wal_contains(struct paging_wal *wal, uint64_t page_number);
+
+// Appends a commit record and waits until it is on disk. Commits from
+// several threads that arrive while a sync is running share the next sync.
+// Does not append anything when no records follow the last commit record.
+bool paging_wal_commit(struct paging_wal *wal);
+
+uint64_t paging_wal_size(struct paging_wal *wal);
+
+// Copies the latest image of every page to the database file, syncs it and
+// empties the log. Must be called without uncommitted records in the log.
+bool paging_wal_checkpoint(struct paging_wal *wal, FILE *database_file);
+
+// Copies the committed images not copied yet without blocking appends and
+// commits for the time of the copy, and empties the log once it holds
+// nothing else. Safe to call from another thread.
+bool paging_wal_checkpoint_incremental(struct paging_wal *wal,
+                                       int database_fd);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_WAL_H
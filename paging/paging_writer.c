@@ -0,0 +1,107 @@
+#include "paging_writer.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct paging_writer {
+  struct paging_writer_step step;
+  uint64_t interval_ms;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  bool is_woken;
+  bool is_stopping;
+};
+
+static struct timespec paging_writer_deadline(uint64_t interval_ms) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += (time_t)(interval_ms / 1000);
+  deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000000000;
+  }
+  return deadline;
+}
+
+static void *paging_writer_run(void *argument) {
+  struct paging_writer *writer = argument;
+
+  pthread_mutex_lock(&writer->mutex);
+  while (!writer->is_stopping) {
+    const struct timespec deadline =
+        paging_writer_deadline(writer->interval_ms);
+    int error = 0;
+    while (!writer->is_woken && !writer->is_stopping && error != ETIMEDOUT) {
+      error = pthread_cond_timedwait(&writer->wake, &writer->mutex, &deadline);
+    }
+    if (writer->is_stopping) {
+      break;
+    }
+    writer->is_woken = false;
+    pthread_mutex_unlock(&writer->mutex);
+
+    if (!writer->step.run(writer->step.context)) {
+      warn("Background writer step error");
+    }
+
+    pthread_mutex_lock(&writer->mutex);
+  }
+  pthread_mutex_unlock(&writer->mutex);
+
+  return NULL;
+}
+
+struct paging_writer *paging_writer_create(struct paging_writer_step step,
+                                           uint64_t interval_ms) {
+  struct paging_writer *writer = malloc(sizeof(struct paging_writer));
+  if (writer == NULL) {
+    return NULL;
+  }
+
+  writer->step = step;
+  writer->interval_ms = interval_ms;
+  writer->is_woken = false;
+  writer->is_stopping = false;
+  pthread_mutex_init(&writer->mutex, NULL);
+  pthread_cond_init(&writer->wake, NULL);
+
+  const int error =
+      pthread_create(&writer->thread, NULL, paging_writer_run, writer);
+  if (error != 0) {
+    warn("Background writer thread creation error. Errno: %d", error);
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->wake);
+    free(writer);
+    return NULL;
+  }
+
+  return writer;
+}
+
+void paging_writer_destroy(struct paging_writer *writer) {
+  if (writer == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&writer->mutex);
+  writer->is_stopping = true;
+  pthread_cond_signal(&writer->wake);
+  pthread_mutex_unlock(&writer->mutex);
+  pthread_join(writer->thread, NULL);
+
+  pthread_mutex_destroy(&writer->mutex);
+  pthread_cond_destroy(&writer->wake);
+  free(writer);
+}
+
+void paging_writer_wake(struct paging_writer *writer) {
+  pthread_mutex_lock(&writer->mutex);
+  writer->is_woken = true;
+  pthread_cond_signal(&writer->wake);
+  pthread_mutex_unlock(&writer->mutex);
+}
@@ -0,0 +1,25 @@
+#ifndef LOW_LEVEL_PROGRAMMING_LAB3_PAGING_WRITER_H
+#define LOW_LEVEL_PROGRAMMING_LAB3_PAGING_WRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Background thread that runs a step of work every interval and whenever it
+// is woken, so that the work is kept off the thread that serves requests.
+struct paging_writer;
+
+struct paging_writer_step {
+  void *context;
+  bool (*run)(void *context);
+};
+
+struct paging_writer *paging_writer_create(struct paging_writer_step step,
+                                           uint64_t interval_ms);
+
+// Waits for the running step and stops the thread
+void paging_writer_destroy(struct paging_writer *writer);
+
+// Runs the next step without waiting for the rest of the interval
+void paging_writer_wake(struct paging_writer *writer);
+
+#endif // LOW_LEVEL_PROGRAMMING_LAB3_PAGING_WRITER_H
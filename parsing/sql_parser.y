@@ -27,6 +27,8 @@ void yyerror(struct parsing_result_value *result, const char* s);
     struct sql_statement statement_val;
     struct sql_create_statement create_statement_val;
     struct sql_drop_statement drop_statement_val;
+    struct sql_create_index_statement create_index_statement_val;
+    struct sql_drop_index_statement drop_index_statement_val;
     struct sql_insert_statement insert_statement_val;
     struct sql_select_statement select_statement_val;
     struct sql_delete_statement delete_statement_val;
@@ -34,6 +36,8 @@ void yyerror(struct parsing_result_value *result, const char* s);
     struct sql_column_with_type_list *column_with_type_list_val;
     struct sql_column_with_type column_with_type_val;
     enum sql_data_type data_type_val;
+    enum sql_index_method index_method_val;
+    enum sql_column_constraint column_constraint_val;
     struct sql_literal_list *literal_list_val;
     struct sql_literal literal_val;
     struct sql_operand operand_val;
@@ -53,11 +57,15 @@ void yyerror(struct parsing_result_value *result, const char* s);
 %token<text_val> TEXT_VAL
 %token<identifier_val> IDENTIFIER
 %token<comparison_operator_val> COMPARISON_OPERATOR
-%token CREATE DROP SELECT INSERT DELETE UPDATE TABLE FROM WHERE INTO INTEGER_TYPE FLOATING_TYPE BOOLEAN_TYPE TEXT_TYPE LEFT_BRACKET RIGHT_BRACKET SEMICOLON COMMA AND OR SET ASSIGN CONTAINS JOIN ON COMPARISON_OPERATOR_EQUAL EXIT
+%token CREATE DROP SELECT INSERT DELETE UPDATE TABLE INDEX USING BTREE HASH PRIMARY KEY UNIQUE FROM WHERE INTO INTEGER_TYPE FLOATING_TYPE BOOLEAN_TYPE TEXT_TYPE LEFT_BRACKET RIGHT_BRACKET SEMICOLON COMMA AND OR SET ASSIGN CONTAINS JOIN ON COMPARISON_OPERATOR_EQUAL EXIT
 
 %type<statement_val> statement
 %type<create_statement_val> create_statement
 %type<drop_statement_val> drop_statement
+%type<create_index_statement_val> create_index_statement
+%type<drop_index_statement_val> drop_index_statement
+%type<index_method_val> index_method
+%type<column_constraint_val> column_constraint
 %type<insert_statement_val> insert_statement
 %type<select_statement_val> select_statement
 %type<delete_statement_val> delete_statement
@@ -134,6 +142,18 @@ statement
             .value.delete = $1
         };
     }
+    | create_index_statement {
+        $$ = (struct sql_statement) {
+            .type = SQL_STATEMENT_TYPE_CREATE_INDEX,
+            .value.create_index = $1
+        };
+    }
+    | drop_index_statement {
+        $$ = (struct sql_statement) {
+            .type = SQL_STATEMENT_TYPE_DROP_INDEX,
+            .value.drop_index = $1
+        };
+    }
     ;
 
 create_statement
@@ -153,6 +173,42 @@ drop_statement
     }
     ;
 
+create_index_statement
+    : CREATE INDEX IDENTIFIER ON IDENTIFIER LEFT_BRACKET IDENTIFIER RIGHT_BRACKET {
+        $$ = (struct sql_create_index_statement) {
+            .index_name = $3,
+            .table_name = $5,
+            .column = $7,
+            .method = SQL_INDEX_METHOD_BTREE
+        };
+    }
+    | CREATE INDEX IDENTIFIER ON IDENTIFIER LEFT_BRACKET IDENTIFIER RIGHT_BRACKET USING index_method {
+        $$ = (struct sql_create_index_statement) {
+            .index_name = $3,
+            .table_name = $5,
+            .column = $7,
+            .method = $10
+        };
+    }
+    ;
+
+index_method
+    : BTREE {
+        $$ = SQL_INDEX_METHOD_BTREE;
+    }
+    | HASH {
+        $$ = SQL_INDEX_METHOD_HASH;
+    }
+    ;
+
+drop_index_statement
+    : DROP INDEX IDENTIFIER {
+        $$ = (struct sql_drop_index_statement) {
+            .index_name = $3
+        };
+    }
+    ;
+
 insert_statement
     : INSERT INTO IDENTIFIER literal_list {
         $$ = (struct sql_insert_statement) {
@@ -388,9 +444,22 @@ column_with_type
     : IDENTIFIER data_type {
         $$ = (struct sql_column_with_type) {
             .name = $1,
-            .type = $2
+            .type = $2,
+            .constraint = SQL_COLUMN_CONSTRAINT_NONE
         };
     }
+    | IDENTIFIER data_type column_constraint {
+        $$ = (struct sql_column_with_type) {
+            .name = $1,
+            .type = $2,
+            .constraint = $3
+        };
+    }
+    ;
+
+column_constraint
+    : PRIMARY KEY {$$ = SQL_COLUMN_CONSTRAINT_PRIMARY_KEY;}
+    | UNIQUE {$$ = SQL_COLUMN_CONSTRAINT_UNIQUE;}
     ;
 
 data_type
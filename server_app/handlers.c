@@ -17,6 +17,17 @@ static const enum database_attribute_type attribute_type_from_model[] = {
     [SQL_DATA_TYPE_TEXT] = DATABASE_ATTRIBUTE_STRING,
 };
 
+static const enum database_index_constraint index_constraint_from_model[] = {
+    [SQL_COLUMN_CONSTRAINT_NONE] = DATABASE_INDEX_CONSTRAINT_NONE,
+    [SQL_COLUMN_CONSTRAINT_UNIQUE] = DATABASE_INDEX_CONSTRAINT_UNIQUE,
+    [SQL_COLUMN_CONSTRAINT_PRIMARY_KEY] = DATABASE_INDEX_CONSTRAINT_PRIMARY_KEY,
+};
+
+static const enum database_index_method index_method_from_model[] = {
+    [SQL_INDEX_METHOD_BTREE] = DATABASE_INDEX_METHOD_BTREE,
+    [SQL_INDEX_METHOD_HASH] = DATABASE_INDEX_METHOD_HASH,
+};
+
 static const enum database_where_comparison_operator
     where_comparison_operator_from_model[] = {
         [SQL_COMPARISON_OPERATOR_EQUAL] =
@@ -70,6 +81,9 @@ char *handle_create_request(struct database *database,
        l = l->next) {
     const struct database_attribute attribute =
         database_attribute_make(l->item);
+    database_create_table_request_set_constraint(
+        create_request, column_index,
+        index_constraint_from_model[l->item.constraint]);
     database_create_table_request_set_attribute(create_request, column_index++,
                                                 attribute);
   }
@@ -149,6 +163,12 @@ char *handle_insert_request(struct database *database,
 
   const struct database_insert_row_result insert_row_result =
       database_insert_row(database, get_table_result.table, request);
+  if (insert_row_result.is_constraint_violated) {
+    database_table_destroy(get_table_result.table);
+    database_insert_row_request_destroy(request);
+    return serialize_common_response(
+        (struct sql_common_response){"Key constraint violated"});
+  }
   if (!insert_row_result.success) {
     database_table_destroy(get_table_result.table);
     database_insert_row_request_destroy(request);
@@ -185,15 +205,8 @@ database_where_contains_item_make(struct database_where_contains_item *item_ret,
   switch (operand.type) {
   case SQL_OPERAND_TYPE_COLUMN: {
     item_ret->type = DATABASE_WHERE_CONTAINS_ITEM_ATTRIBUTE;
-    item_ret->value.attribute.attribute_position = SIZE_MAX;
-    for (size_t i = 0; i < table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(table.attributes, i);
-      if (strcmp(attribute.name, operand.value.column) == 0) {
-        item_ret->value.attribute.attribute_position = i;
-        break;
-      }
-    }
+    item_ret->value.attribute.attribute_position =
+        database_table_attribute_position(table, operand.value.column);
     if (item_ret->value.attribute.attribute_position < SIZE_MAX) {
       return NULL;
     }
@@ -216,31 +229,20 @@ char *database_where_joined_contains_item_make(
   switch (operand.type) {
   case SQL_OPERAND_TYPE_COLUMN: {
     item_ret->type = DATABASE_WHERE_CONTAINS_ITEM_ATTRIBUTE;
-    item_ret->value.attribute.table_position = SIZE_MAX;
-
-    for (size_t i = 0; i < left_table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(left_table.attributes, i);
-      if (strcmp(attribute.name, operand.value.column) == 0) {
-        item_ret->value.attribute.table_position = 0;
-        item_ret->value.attribute.attribute_position = i;
-        break;
-      }
-    }
-    if (item_ret->value.attribute.table_position < SIZE_MAX) {
+
+    const size_t left_position =
+        database_table_attribute_position(left_table, operand.value.column);
+    if (left_position < SIZE_MAX) {
+      item_ret->value.attribute.table_position = 0;
+      item_ret->value.attribute.attribute_position = left_position;
       return NULL;
     }
 
-    for (size_t i = 0; i < right_table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(right_table.attributes, i);
-      if (strcmp(attribute.name, operand.value.column) == 0) {
-        item_ret->value.attribute.table_position = 1;
-        item_ret->value.attribute.attribute_position = i;
-        break;
-      }
-    }
-    if (item_ret->value.attribute.table_position < SIZE_MAX) {
+    const size_t right_position =
+        database_table_attribute_position(right_table, operand.value.column);
+    if (right_position < SIZE_MAX) {
+      item_ret->value.attribute.table_position = 1;
+      item_ret->value.attribute.attribute_position = right_position;
       return NULL;
     }
 
@@ -261,18 +263,13 @@ char *database_where_comparison_item_make(
   switch (operand.type) {
   case SQL_OPERAND_TYPE_COLUMN: {
     item_ret->type = DATABASE_WHERE_COMPARISON_ITEM_ATTRIBUTE;
-    item_ret->value.attribute.attribute_position = SIZE_MAX;
-
-    for (size_t i = 0; i < table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(table.attributes, i);
-      if (strcmp(attribute.name, operand.value.column) == 0) {
-        item_ret->data_type = attribute.type;
-        item_ret->value.attribute.attribute_position = i;
-        break;
-      }
-    }
-    if (item_ret->value.attribute.attribute_position < SIZE_MAX) {
+
+    const size_t position =
+        database_table_attribute_position(table, operand.value.column);
+    if (position < SIZE_MAX) {
+      item_ret->data_type =
+          database_attributes_get(table.attributes, position).type;
+      item_ret->value.attribute.attribute_position = position;
       return NULL;
     }
 
@@ -296,33 +293,24 @@ char *database_where_joined_comparison_item_make(
   switch (operand.type) {
   case SQL_OPERAND_TYPE_COLUMN: {
     item_ret->type = DATABASE_WHERE_COMPARISON_ITEM_ATTRIBUTE;
-    item_ret->value.attribute.table_position = SIZE_MAX;
-
-    for (size_t i = 0; i < left_table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(left_table.attributes, i);
-      if (strcmp(attribute.name, operand.value.column) == 0) {
-        item_ret->data_type = attribute.type;
-        item_ret->value.attribute.table_position = 0;
-        item_ret->value.attribute.attribute_position = i;
-        break;
-      }
-    }
-    if (item_ret->value.attribute.table_position < SIZE_MAX) {
+
+    const size_t left_position =
+        database_table_attribute_position(left_table, operand.value.column);
+    if (left_position < SIZE_MAX) {
+      item_ret->data_type =
+          database_attributes_get(left_table.attributes, left_position).type;
+      item_ret->value.attribute.table_position = 0;
+      item_ret->value.attribute.attribute_position = left_position;
       return NULL;
     }
 
-    for (size_t i = 0; i < right_table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(right_table.attributes, i);
-      if (strcmp(attribute.name, operand.value.column) == 0) {
-        item_ret->data_type = attribute.type;
-        item_ret->value.attribute.table_position = 1;
-        item_ret->value.attribute.attribute_position = i;
-        break;
-      }
-    }
-    if (item_ret->value.attribute.table_position < SIZE_MAX) {
+    const size_t right_position =
+        database_table_attribute_position(right_table, operand.value.column);
+    if (right_position < SIZE_MAX) {
+      item_ret->data_type =
+          database_attributes_get(right_table.attributes, right_position).type;
+      item_ret->value.attribute.table_position = 1;
+      item_ret->value.attribute.attribute_position = right_position;
       return NULL;
     }
 
@@ -500,6 +488,20 @@ sql_literal_make(struct database_attribute attribute,
   }
 }
 
+static struct sql_literal_list *
+select_response_row(struct database_table table, struct database_row row) {
+  struct sql_literal_list *literals = NULL;
+  for (size_t i = 0; i < table.attributes.count; i++) {
+    const struct database_attribute attribute =
+        database_attributes_get(table.attributes, i);
+    const union database_attribute_value value =
+        database_attribute_values_get(row.values, i);
+    literals =
+        sql_literal_list_create(sql_literal_make(attribute, value), literals);
+  }
+  return literals;
+}
+
 char *handle_select_request(struct database *database,
                             struct sql_select_statement statement) {
   const struct database_get_table_result get_table_result =
@@ -518,41 +520,26 @@ char *handle_select_request(struct database *database,
           (struct sql_common_response){"Joined table not found"});
     }
 
-    ssize_t left_attribute_position = -1;
-    for (size_t i = 0; i < get_table_result.table.attributes.count; i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(get_table_result.table.attributes, i);
-      if (strcmp(attribute.name, statement.join.value.table_column) == 0) {
-        left_attribute_position = (ssize_t)i;
-        break;
-      }
-    }
-    if (left_attribute_position < 0) {
+    const size_t left_attribute_position = database_table_attribute_position(
+        get_table_result.table, statement.join.value.table_column);
+    if (left_attribute_position == SIZE_MAX) {
       database_table_destroy(get_table_result.table);
       database_table_destroy(get_joined_table_result.table);
       return serialize_common_response(
           (struct sql_common_response){"Table attribute for join not found"});
     }
 
-    ssize_t right_attribute_position = -1;
-    for (size_t i = 0; i < get_joined_table_result.table.attributes.count;
-         i++) {
-      const struct database_attribute attribute =
-          database_attributes_get(get_joined_table_result.table.attributes, i);
-      if (strcmp(attribute.name, statement.join.value.join_table_column) == 0) {
-        right_attribute_position = (ssize_t)i;
-        break;
-      }
-    }
-    if (right_attribute_position < 0) {
+    const size_t right_attribute_position = database_table_attribute_position(
+        get_joined_table_result.table, statement.join.value.join_table_column);
+    if (right_attribute_position == SIZE_MAX) {
       database_table_destroy(get_table_result.table);
       database_table_destroy(get_joined_table_result.table);
       return serialize_common_response((struct sql_common_response){
           "Joined table attribute for join not found"});
     }
 
-    const struct database_join join = {(size_t)left_attribute_position,
-                                       (size_t)right_attribute_position};
+    const struct database_join join = {left_attribute_position,
+                                       right_attribute_position};
 
     struct database_where_joined where;
     char *where_res = database_where_joined_make(&where, get_table_result.table,
@@ -580,9 +567,11 @@ char *handle_select_request(struct database *database,
     }
 
     struct sql_literal_list_list *rows = NULL;
+    struct database_select_join *select_join;
     struct database_select_join_result select_result =
         database_select_join_first(database, get_table_result.table,
-                                   get_joined_table_result.table, join, where);
+                                   get_joined_table_result.table, join, where,
+                                   &select_join);
     while (select_result.success) {
       struct sql_literal_list *row = NULL;
       for (size_t i = 0; i < get_table_result.table.attributes.count; i++) {
@@ -602,10 +591,9 @@ char *handle_select_request(struct database *database,
       }
 
       rows = sql_literal_list_list_create(row, rows);
-      select_result = database_select_join_next(
-          database, get_table_result.table, get_joined_table_result.table, join,
-          where, select_result.left_row, select_result.right_row);
+      select_result = database_select_join_next(database, select_join);
     }
+    database_select_join_destroy(select_join);
 
     const struct sql_select_response response = {.header = header,
                                                  .rows = rows};
@@ -633,22 +621,39 @@ char *handle_select_request(struct database *database,
           database_attributes_get(get_table_result.table.attributes, i).name;
     }
 
+    const struct database_select_infos_result infos_result =
+        database_select_row_infos_with_index(database, get_table_result.table,
+                                             where);
+    if (!infos_result.success) {
+      sql_select_response_header_destroy(header);
+      database_table_destroy(get_table_result.table);
+      return serialize_common_response((struct sql_common_response){"Failed"});
+    }
+
     struct sql_literal_list_list *rows = NULL;
-    struct database_select_row_result select_result =
-        database_select_row_first(database, get_table_result.table, where);
-    while (select_result.success) {
-      struct sql_literal_list *row = NULL;
-      for (size_t i = 0; i < get_table_result.table.attributes.count; i++) {
-        const struct database_attribute attribute =
-            database_attributes_get(get_table_result.table.attributes, i);
-        const union database_attribute_value value =
-            database_attribute_values_get(select_result.row.values, i);
-        row = sql_literal_list_create(sql_literal_make(attribute, value), row);
+    if (infos_result.is_index_used) {
+      for (size_t i = 0; i < infos_result.count; i++) {
+        const struct database_select_row_result select_result =
+            database_select_row_with_info(database, get_table_result.table,
+                                          infos_result.infos[i], where);
+        if (select_result.success) {
+          rows = sql_literal_list_list_create(
+              select_response_row(get_table_result.table, select_result.row),
+              rows);
+          database_row_destroy(select_result.row);
+        }
+      }
+      free(infos_result.infos);
+    } else {
+      struct database_select_row_result select_result =
+          database_select_row_first(database, get_table_result.table, where);
+      while (select_result.success) {
+        rows = sql_literal_list_list_create(
+            select_response_row(get_table_result.table, select_result.row),
+            rows);
+        select_result = database_select_row_next(
+            database, get_table_result.table, where, select_result.row);
       }
-
-      rows = sql_literal_list_list_create(row, rows);
-      select_result = database_select_row_next(database, get_table_result.table,
-                                               where, select_result.row);
     }
 
     const struct sql_select_response response = {.header = header,
@@ -663,6 +668,64 @@ char *handle_select_request(struct database *database,
   }
 }
 
+// Rows are changed only after the scan is over, so that the scan never
+// steps onto a page that a change has freed or returns a changed row again
+static bool select_row_infos(struct database *database,
+                             struct database_table table,
+                             struct database_where where,
+                             struct paging_info **infos, size_t *count) {
+  const struct database_select_infos_result infos_result =
+      database_select_row_infos_with_index(database, table, where);
+  if (!infos_result.success) {
+    return false;
+  }
+
+  // Rows found by an index are checked against the whole condition
+  if (infos_result.is_index_used) {
+    *infos = infos_result.infos;
+    *count = 0;
+    for (size_t i = 0; i < infos_result.count; i++) {
+      const struct database_select_row_result select_result =
+          database_select_row_with_info(database, table, infos_result.infos[i],
+                                        where);
+      if (select_result.success) {
+        (*infos)[(*count)++] = infos_result.infos[i];
+        database_row_destroy(select_result.row);
+      }
+    }
+    return true;
+  }
+
+  size_t capacity = 16;
+  *count = 0;
+  *infos = malloc(capacity * sizeof(struct paging_info));
+  if (*infos == NULL) {
+    return false;
+  }
+
+  struct database_select_row_result select_result =
+      database_select_row_first(database, table, where);
+  while (select_result.success) {
+    if (*count == capacity) {
+      capacity *= 2;
+      struct paging_info *new_infos =
+          realloc(*infos, capacity * sizeof(struct paging_info));
+      if (new_infos == NULL) {
+        database_row_destroy(select_result.row);
+        free(*infos);
+        return false;
+      }
+      *infos = new_infos;
+    }
+
+    (*infos)[(*count)++] = select_result.row.paging_info;
+    select_result = database_select_row_next(database, table, where,
+                                             select_result.row);
+  }
+
+  return true;
+}
+
 char *handle_delete_request(struct database *database,
                             struct sql_delete_statement statement) {
   const struct database_get_table_result get_table_result =
@@ -680,18 +743,27 @@ char *handle_delete_request(struct database *database,
     return where_res;
   }
 
-  struct database_select_row_result select_result;
-  do {
-    select_result =
-        database_select_row_first(database, get_table_result.table, where);
+  struct paging_info *infos;
+  size_t infos_count;
+  if (!select_row_infos(database, get_table_result.table, where, &infos,
+                        &infos_count)) {
+    database_table_destroy(get_table_result.table);
+    return serialize_common_response((struct sql_common_response){"Failed"});
+  }
+
+  for (size_t i = 0; i < infos_count; i++) {
     const struct database_remove_row_result remove_result =
-        database_remove_row(database, select_result.row);
+        database_remove_row_with_info(database, get_table_result.table,
+                                      infos[i]);
     if (!remove_result.success) {
+      free(infos);
       database_table_destroy(get_table_result.table);
       return serialize_common_response((struct sql_common_response){"Failed"});
     }
-  } while (select_result.success);
+  }
 
+  free(infos);
+  database_table_destroy(get_table_result.table);
   return serialize_common_response((struct sql_common_response){"Success"});
 }
 
@@ -701,15 +773,16 @@ apply_sets(struct database_table table, struct database_attribute_values values,
   struct database_attribute_values result =
       database_attribute_values_create(table.attributes.count);
   for (size_t i = 0; i < table.attributes.count; i++) {
-    union database_attribute_value value =
-        database_attribute_values_get(values, i);
-    for (struct sql_column_with_literal_list *l = set; l != NULL; l = l->next) {
-      if (strcmp(database_attributes_get(table.attributes, i).name,
-                 l->item.name) == 0) {
-        value = attribute_value_from_literal(l->item.literal);
-      }
+    database_attribute_values_set(result, i,
+                                  database_attribute_values_get(values, i));
+  }
+  for (struct sql_column_with_literal_list *l = set; l != NULL; l = l->next) {
+    const size_t position =
+        database_table_attribute_position(table, l->item.name);
+    if (position < SIZE_MAX) {
+      database_attribute_values_set(
+          result, position, attribute_value_from_literal(l->item.literal));
     }
-    database_attribute_values_set(result, i, value);
   }
 
   return result;
@@ -732,32 +805,95 @@ char *handle_update_request(struct database *database,
     return where_res;
   }
 
-  struct database_select_row_result select_result =
-      database_select_row_first(database, get_table_result.table, where);
-  while (select_result.success) {
-    const struct database_attribute_values values = apply_sets(
-        get_table_result.table, select_result.row.values, statement.set);
-    const struct database_remove_row_result remove_result =
-        database_remove_row(database, select_result.row);
-    if (!remove_result.success) {
-      database_table_destroy(get_table_result.table);
-      return serialize_common_response((struct sql_common_response){"Failed"});
-    }
+  struct paging_info *infos;
+  size_t infos_count;
+  if (!select_row_infos(database, get_table_result.table, where, &infos,
+                        &infos_count)) {
+    database_table_destroy(get_table_result.table);
+    return serialize_common_response((struct sql_common_response){"Failed"});
+  }
+
+  struct database_row *rows = malloc(infos_count * sizeof(struct database_row));
+  struct database_attribute_values *values =
+      malloc(infos_count * sizeof(struct database_attribute_values));
+  size_t rows_count = 0;
+  bool success = infos_count == 0 || (rows != NULL && values != NULL);
+  while (success && rows_count < infos_count) {
+    const struct database_select_row_result select_result =
+        database_select_row_with_info(database, get_table_result.table,
+                                      infos[rows_count], DATABASE_WHERE_ALWAYS);
+    success = select_result.success;
+    if (success) {
+      rows[rows_count] = select_result.row;
+      values[rows_count] = apply_sets(get_table_result.table,
+                                      select_result.row.values, statement.set);
+      rows_count++;
+    }
+  }
+
+  bool is_constraint_violated = false;
+  if (success) {
+    const struct database_update_rows_result update_result =
+        database_update_rows(database, get_table_result.table, infos, values,
+                             infos_count);
+    success = update_result.success;
+    is_constraint_violated = update_result.is_constraint_violated;
+  }
+
+  for (size_t i = 0; i < rows_count; i++) {
+    database_attribute_values_destroy(values[i]);
+    database_row_destroy(rows[i]);
+  }
+  free(rows);
+  free(values);
+  free(infos);
+  database_table_destroy(get_table_result.table);
+  if (is_constraint_violated) {
+    return serialize_common_response(
+        (struct sql_common_response){"Key constraint violated"});
+  }
+  if (!success) {
+    return serialize_common_response((struct sql_common_response){"Failed"});
+  }
 
-    struct database_insert_row_request insert =
-        database_insert_row_request_create(get_table_result.table);
-    insert.values = values;
+  return serialize_common_response((struct sql_common_response){"Success"});
+}
 
-    struct database_insert_row_result insert_result =
-        database_insert_row(database, get_table_result.table, insert);
-    if (!insert_result.success) {
-      database_table_destroy(get_table_result.table);
-      return serialize_common_response((struct sql_common_response){"Failed"});
-    }
+char *handle_create_index_request(struct database *database,
+                                  struct sql_create_index_statement statement) {
+  const struct database_get_table_result get_table_result =
+      database_get_table_with_name(database, statement.table_name);
+  if (!get_table_result.success) {
+    return serialize_common_response(
+        (struct sql_common_response){"Table not found"});
+  }
 
-    select_result =
-        database_select_row_first(database, get_table_result.table, where);
+  const size_t attribute_position = database_table_attribute_position(
+      get_table_result.table, statement.column);
+  if (attribute_position == SIZE_MAX) {
+    database_table_destroy(get_table_result.table);
+    return serialize_common_response(
+        (struct sql_common_response){"Table attribute for index not found"});
+  }
+
+  const struct database_create_index_result create_index_result =
+      database_create_index(database, get_table_result.table,
+                            statement.index_name, attribute_position,
+                            index_method_from_model[statement.method]);
+  if (!create_index_result.success) {
+    return serialize_common_response((struct sql_common_response){"Failure"});
   }
 
   return serialize_common_response((struct sql_common_response){"Success"});
-}
\ No newline at end of file
+}
+
+char *handle_drop_index_request(struct database *database,
+                                struct sql_drop_index_statement statement) {
+  const struct database_drop_index_result drop_index_result =
+      database_drop_index(database, statement.index_name);
+  if (!drop_index_result.success) {
+    return serialize_common_response((struct sql_common_response){"Failure"});
+  }
+
+  return serialize_common_response((struct sql_common_response){"Success"});
+}
@@ -22,4 +22,10 @@ char *handle_delete_request(struct database *database,
 char *handle_update_request(struct database *database,
                             struct sql_update_statement statement);
 
+char *handle_create_index_request(struct database *database,
+                                  struct sql_create_index_statement statement);
+
+char *handle_drop_index_request(struct database *database,
+                                struct sql_drop_index_statement statement);
+
 #endif // LOW_LEVEL_PROGRAMMING_LAB3_HANDLERS_H
@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef WIN32
 #include <io.h>
@@ -15,6 +16,41 @@
 #include <unistd.h>
 #endif
 
+static FILE *file_open(const char *filename) {
+  if (access(filename, F_OK) != 0) {
+    fclose(fopen(filename, "ab+"));
+  }
+
+  FILE *file = fopen(filename, "rb+");
+  if (file == NULL) {
+    warn("File open failed. Errno: %d", errno);
+  }
+  return file;
+}
+
+static FILE *wal_file_open(const char *filename, bool is_file_exists) {
+  const char *wal_suffix = "-wal";
+  char *wal_filename = malloc(strlen(filename) + strlen(wal_suffix) + 1);
+  if (wal_filename == NULL) {
+    warn("Log file name allocation failed");
+    return NULL;
+  }
+  strcpy(wal_filename, filename);
+  strcat(wal_filename, wal_suffix);
+
+  // A log left without its database file belongs to another database
+  if (!is_file_exists || access(wal_filename, F_OK) != 0) {
+    fclose(fopen(wal_filename, "wb"));
+  }
+  FILE *wal_file = fopen(wal_filename, "rb+");
+  free(wal_filename);
+
+  if (wal_file == NULL) {
+    warn("Log file open failed. Errno: %d", errno);
+  }
+  return wal_file;
+}
+
 int main(int argc, char **argv) {
   debug("Server start");
 
@@ -32,27 +68,79 @@ int main(int argc, char **argv) {
 
   const char *filename = argv[1];
   const bool is_file_exists = access(filename, F_OK) == 0;
+  FILE *file = file_open(filename);
+  if (file == NULL) {
+    return EXIT_FAILURE;
+  }
 
-  FILE *file;
-  if (is_file_exists) {
-    file = fopen(filename, "rb+");
-  } else {
-    fclose(fopen(filename, "ab+"));
-    file = fopen(filename, "rb+");
+  struct paging_options options = PAGING_OPTIONS_DEFAULT;
+  if (argc > 3) {
+    options.buffer_pool_frames_count = strtoul(argv[3], NULL, 10);
+  }
+  if (argc > 4 && strcmp(argv[4], "mmap") == 0) {
+    options.backend = PAGING_BACKEND_MMAP;
+  }
+  if (argc > 4 && strcmp(argv[4], "io_uring") == 0) {
+    options.io_engine = PAGING_IO_ENGINE_IO_URING;
+  }
+  if (argc > 5) {
+    options.page_size = strtoul(argv[5], NULL, 10);
+  }
+  if (argc > 6 && strcmp(argv[6], "lz") == 0) {
+    options.compression = PAGING_COMPRESSION_LZ;
   }
 
-  if (file == NULL) {
-    warn("File open failed. Errno: %d", errno);
-    return EXIT_FAILURE;
+  size_t tablespaces_count = 0;
+  if (argc > 7) {
+    tablespaces_count = strtoul(argv[7], NULL, 10);
   }
 
-  struct database *database =
-      is_file_exists ? database_init(file) : database_create_and_init(file);
+  if (options.backend == PAGING_BACKEND_BUFFERED) {
+    options.wal_file = wal_file_open(filename, is_file_exists);
+    if (options.wal_file == NULL) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  struct database *database = is_file_exists
+                                  ? database_init(file, options)
+                                  : database_create_and_init(file, options);
   if (database == NULL) {
     warn("Database init error");
     return EXIT_FAILURE;
   }
 
+  // Tablespace i is stored in the file named after the database with the
+  // suffix .i
+  for (size_t i = 1; i <= tablespaces_count; i++) {
+    char *tablespace_filename = malloc(strlen(filename) + 32);
+    if (tablespace_filename == NULL) {
+      warn("Tablespace file name allocation failed");
+      return EXIT_FAILURE;
+    }
+    sprintf(tablespace_filename, "%s.%zu", filename, i);
+
+    const bool is_tablespace_file_exists =
+        access(tablespace_filename, F_OK) == 0;
+    FILE *tablespace_file = file_open(tablespace_filename);
+    struct paging_options tablespace_options = options;
+    if (tablespace_file != NULL &&
+        options.backend == PAGING_BACKEND_BUFFERED) {
+      tablespace_options.wal_file =
+          wal_file_open(tablespace_filename, is_tablespace_file_exists);
+    }
+    free(tablespace_filename);
+
+    if (tablespace_file == NULL ||
+        (options.backend == PAGING_BACKEND_BUFFERED &&
+         tablespace_options.wal_file == NULL) ||
+        !database_add_tablespace(database, tablespace_file, tablespace_options)
+             .success) {
+      warn("Tablespace %zu add failed", i);
+      return EXIT_FAILURE;
+    }
+  }
+
   printf("Server started at port %d\n", port);
 
   while (1) {
@@ -96,6 +184,20 @@ int main(int argc, char **argv) {
       response =
           handle_update_request(database, deserialization.value.value.update);
     } break;
+    case SQL_STATEMENT_TYPE_CREATE_INDEX: {
+      response = handle_create_index_request(
+          database, deserialization.value.value.create_index);
+    } break;
+    case SQL_STATEMENT_TYPE_DROP_INDEX: {
+      response = handle_drop_index_request(
+          database, deserialization.value.value.drop_index);
+    } break;
+    }
+
+    const struct database_commit_result commit_result =
+        database_commit(database);
+    if (!commit_result.success) {
+      warn("Commit failed");
     }
 
     if (response == NULL) {
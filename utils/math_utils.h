@@ -3,6 +3,8 @@
 
 #define DIV_ROUND_UP(n, d) (((n) + (d)-1) / (d))
 
+#define ROUND_UP(n, d) (DIV_ROUND_UP(n, d) * (d))
+
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))